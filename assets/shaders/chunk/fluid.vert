@@ -11,8 +11,14 @@ layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 world_pos;
 
-uniform mat4 proj_view;
-uniform float timer;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
+
+#define timer (time * .25) // the waves are tuned for a quarter of the speed
 
 out VS_OUT vs_out;
 
@@ -14,7 +14,12 @@ struct VS_OUT
 	vec2 tex_coord;
 };
 
-uniform mat4 proj_view;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
 uniform mat3 transform;
 
 out VS_OUT vs_out;
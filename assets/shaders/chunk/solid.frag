@@ -0,0 +1,35 @@
+#version 420 core
+
+struct VS_OUT
+{
+	vec3 normal;   // normal vector
+	vec3 frag_pos; // position of this pixel in world space
+	vec2 tex_coord;
+	vec2 light; // sky, block (0 - 1)
+};
+
+in VS_OUT vs_out;
+flat in vec4 ao_corners;
+in vec2 ao_uv;
+flat in float layer;
+flat in vec2 material; // metalness, roughness
+
+layout (location = 0) out vec4 frag_position;
+layout (location = 1) out vec4 frag_normal;
+layout (location = 2) out vec4 frag_albedo;
+
+layout (binding = 0) uniform sampler2DArray block_textures;
+
+void main()
+{
+	// each light level is 80% as bright as the one above it
+	float light = pow(.8, 15 * (1 - max(vs_out.light.x, vs_out.light.y)));
+
+	// bilinear across the face instead of per triangle, so it looks the same whichever way the quad is split
+	float ao = mix(mix(ao_corners.x, ao_corners.y, ao_uv.x), mix(ao_corners.z, ao_corners.w, ao_uv.x), ao_uv.y);
+	float occlusion = mix(.4, 1.0, ao);
+
+	frag_position = vec4(vs_out.frag_pos, material.x);  // metalness
+	frag_normal   = vec4(vs_out.normal  , material.y);  // roughness
+	frag_albedo   = vec4(texture(block_textures, vec3(vs_out.tex_coord, layer)).rgb, .2 * light * occlusion); // ambient occlusion, darkened by voxel light
+}
@@ -1,27 +1,66 @@
-#version 330 core
+#version 420 core
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 tex_coord;
 
 layout (location = 3) in vec3  world_position;
-layout (location = 4) in float tex_offset;
+layout (location = 4) in uint  block;
+layout (location = 5) in uvec2 face_light; // 8 bits per face : (sky << 4) | block
+layout (location = 6) in uvec2 corner_ao;  // 8 bits per face : 2 bits per corner
 
 struct VS_OUT
 {
 	vec3 normal;   // normal vector
 	vec3 frag_pos; // position of this pixel in world space
 	vec2 tex_coord;
+	vec2 light; // sky, block (0 - 1)
 };
 
-uniform mat4 proj_view;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
+layout (binding = 2) uniform usampler2D material_table; // [block][face] : layer, metalness, roughness
 
 out VS_OUT vs_out;
+flat out float layer;   // of the block texture array
+flat out vec2 material; // metalness, roughness (0 - 1)
+flat out vec4 ao_corners; // ao of the 4 corners of this face, interpolated in solid.frag
+out vec2 ao_uv;           // where on the face this vertex is
+
+// the axes along each face, corner (u, v) is at index (u + 2v) of ao_corners. must match init_ao_tables()
+const vec3 FACE_U[6] = vec3[6](vec3(0,0,1), vec3(0,0,1), vec3(1,0,0), vec3(1,0,0), vec3(1,0,0), vec3(1,0,0));
+const vec3 FACE_V[6] = vec3[6](vec3(0,1,0), vec3(0,1,0), vec3(0,1,0), vec3(0,1,0), vec3(0,0,1), vec3(0,0,1));
+
+uint get_face(vec3 n) // same order as the FACE_ defines in chunk.h
+{
+	if (n.x >  .5) return 0u;
+	if (n.x < -.5) return 1u;
+	if (n.z >  .5) return 2u;
+	if (n.z < -.5) return 3u;
+	if (n.y >  .5) return 4u;
+	return 5u;
+}
 
 void main()
 {
+	uint face  = get_face(normal);
+	uint light = (face < 4u) ? (face_light.x >> (face * 8u)) : (face_light.y >> ((face - 4u) * 8u));
+	uint ao    = (face < 4u) ? (corner_ao.x  >> (face * 8u)) : (corner_ao.y  >> ((face - 4u) * 8u));
+
 	vs_out.normal = normal;
 	vs_out.frag_pos = position + world_position;
-	vs_out.tex_coord = vec2(tex_coord.x + tex_offset, tex_coord.y);
+	uvec4 entry = texelFetch(material_table, ivec2(face, block), 0);
+	layer    = float(entry.r);
+	material = vec2(entry.gb) / 255.0;
+
+	vs_out.tex_coord = vec2(tex_coord.x * 16.0, tex_coord.y); // block.mesh_uv covers 1 tile of a 16 tile atlas
+	vs_out.light = vec2((light >> 4u) & 15u, light & 15u) / 15.0;
+
+	ao_corners = vec4(ao & 3u, (ao >> 2u) & 3u, (ao >> 4u) & 3u, (ao >> 6u) & 3u) / 3.0;
+	ao_uv = vec2(dot(position, FACE_U[face]), dot(position, FACE_V[face]));
 	gl_Position = proj_view * vec4(vs_out.frag_pos, 1.0);
 }
\ No newline at end of file
@@ -15,9 +15,23 @@ layout (binding = 2) uniform sampler2D albedo;
 
 layout (location = 0) out vec4 frag_color;
 
-// lights
-uniform vec3 light_positions[4];
-uniform vec3 light_colors[4];
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
+
+// point lights, binned into clusters on the cpu (Light_Clusters in renderer.h, keep these the same)
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+#define LIGHT_NEAR 1.0
+#define LIGHT_FAR  256.0
+
+layout (binding = 3) uniform samplerBuffer  lights; // 2 texels each : position & radius, color & intensity
+layout (binding = 4) uniform usamplerBuffer clusters; // offset & count into light_indices
+layout (binding = 5) uniform usamplerBuffer light_indices;
 
 const float PI = 3.14159265359;
 const float MINF = 0.00001;
@@ -94,13 +108,27 @@ void main()
 		Lo += 2 * BRDF * light_color * n_dot_l;
 	}
 
-	for(int i = 0; i < 4; ++i) // point lights
+	// the cluster this pixel is in
+	vec4 clip = proj_view * vec4(position, 1);
+	vec2 tile = ((clip.xy / clip.w) * .5 + .5) * vec2(LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y);
+	int slice = (clip.w < LIGHT_NEAR) ? 0 : 1 + int(log(clip.w / LIGHT_NEAR) / log(LIGHT_FAR / LIGHT_NEAR) * (LIGHT_CLUSTERS_Z - 1));
+
+	uvec2 list = uvec2(0); // offset, count
+	if (tile.x >= 0 && tile.y >= 0 && tile.x < LIGHT_CLUSTERS_X && tile.y < LIGHT_CLUSTERS_Y && slice < LIGHT_CLUSTERS_Z)
+		list = texelFetch(clusters, int(tile.x) + (int(tile.y) * LIGHT_CLUSTERS_X) + (slice * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y)).xy;
+
+	for(uint i = 0; i < list.y; ++i) // point lights
 	{
-		vec3 L = normalize(light_positions[i] - position); // world_pos -> light source
+		int light = int(texelFetch(light_indices, int(list.x + i)).r);
+		vec4 light_position = texelFetch(lights, light * 2); // w = radius
+		vec4 light_color    = texelFetch(lights, light * 2 + 1); // w = intensity
+
+		vec3 L = normalize(light_position.xyz - position); // world_pos -> light source
 		vec3 H = normalize(V + L);
-		float distance = length(light_positions[i] - position);
+		float distance = length(light_position.xyz - position);
 		float attenuation = 5 * ( (1 / distance) + 1.0 / (distance * distance) );
-		vec3 radiance = light_colors[i] * attenuation;
+		attenuation *= pow(clamp(1 - pow(distance / light_position.w, 4), 0, 1), 2); // fades out to 0 at its radius
+		vec3 radiance = light_color.rgb * light_color.w * attenuation;
 	
 		float n_dot_v = max(dot(N, V), MINF);
 		float n_dot_l = max(dot(N, L), MINF);
@@ -8,7 +8,12 @@ struct VS_OUT {
 layout (location = 0) in vec2 position;
 layout (location = 1) in vec2 tex_coords;
 
-uniform vec3 view_pos;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
 
 out VS_OUT vs_out;
 
@@ -12,7 +12,12 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 world_position;
 layout (location = 3) in vec3 color;
 
-uniform mat4 proj_view;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
 
 out VS_OUT vs_out;
 
@@ -14,7 +14,12 @@ layout (location = 3) in vec3 scale;
 layout (location = 4) in vec3 color;
 layout (location = 5) in mat3 rotation;
 
-uniform mat4 proj_view;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
 
 out VS_OUT vs_out;
 
@@ -22,7 +22,12 @@ layout (binding = 1, std140) uniform skeleton
 	uniform mat4 joint_transforms[MAX_JOINTS];
 };
 
-uniform mat4 proj_view;
+layout (std140) uniform Frame // Frame_Uniforms in renderer.h
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
 
 out VS_OUT vs_out;
 
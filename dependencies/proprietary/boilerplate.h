@@ -32,28 +32,261 @@
 
 struct bvec3 { union { struct { byte x, y, z; }; struct { byte r, g, b; }; }; };
 #include <proprietary/mathematics.h> // this is pretty much GLM for now
+#include <proprietary/file_io.h> // works on linux too
 
-byte* read_text_file_into_memory(const char* path)
+// ------------------- Asset Pack ------------------ //
+
+// every asset in one file that is mapped into memory once, so loaders can use them where they are. entries are
+// sorted by path, ASSET_ALIGNMENT aligned & followed by a 0 (so text works in place). built by pack_assets()
+
+#define ASSET_PACK_MAGIC	0x4B434150 // "PACK"
+#define ASSET_PACK_VERSION	1
+#define ASSET_ALIGNMENT	64
+#define MAX_ASSET_PATH		56
+
+struct Asset_Entry
 {
-	DWORD BytesRead;
-	HANDLE os_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	char path[MAX_ASSET_PATH]; // as the game asks for it, eg. "assets/meshes/block.mesh_uv"
+	uint32 offset, size; // from the start of the pack
+};
 
-	LARGE_INTEGER size;
-	GetFileSizeEx(os_file, &size);
+struct Asset_Pack_Header
+{
+	uint32 magic, version;
+	uint32 num_entries; // entries follow the header
+	uint32 size; // of the whole pack
+};
 
-	byte* memory = (byte*)calloc(size.QuadPart + 1, sizeof(byte));
-	ReadFile(os_file, memory, size.QuadPart, &BytesRead, NULL);
+struct Asset_Pack
+{
+	byte* memory; // NULL = no pack, everything is read from loose files
+	Asset_Pack_Header* header;
+	Asset_Entry* entries;
+	File_View view;
+};
 
-	CloseHandle(os_file);
+Asset_Pack asset_pack;
 
+bool open_asset_pack(const char* path) // false if there isn't a usable one
+{
+	File_View view;
+	if (!open_view(&view, path)) return false;
+
+	Asset_Pack_Header* header = (Asset_Pack_Header*)view.memory;
+	if (view.size < sizeof(Asset_Pack_Header) || header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION || header->size != view.size)
+	{
+		out("ERROR : '" << path << "' is not an asset pack");
+		close_view(&view);
+		return false;
+	}
+
+	asset_pack = { view.memory, header, (Asset_Entry*)(header + 1), view };
+	return true;
+}
+Asset_Entry* find_asset(const char* path) // NULL if it isn't packed
+{
+	if (!asset_pack.memory) return NULL;
+
+	int lo = 0, hi = (int)asset_pack.header->num_entries - 1;
+	while (lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		int order = strcmp(path, asset_pack.entries[mid].path);
+
+		if (order == 0) return asset_pack.entries + mid;
+		if (order < 0) hi = mid - 1; else lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+// the contents of an asset, followed by a 0. it comes straight out of the pack if it is in there, otherwise
+// it is read from its file. NULL if it can't be found. give it back with close_asset()
+byte* open_asset(const char* path, uint* size = NULL)
+{
+	Asset_Entry* entry = find_asset(path);
+	if (!entry) return read_file(path, size);
+
+	if (size) *size = entry->size;
+	return asset_pack.memory + entry->offset;
+}
+void close_asset(byte* asset)
+{
+	bool packed = asset_pack.memory && asset >= asset_pack.memory && asset < asset_pack.memory + asset_pack.header->size;
+	if (!packed) free(asset);
+}
+
+byte* read_text_file_into_memory(const char* path) // a copy that can be changed, free() it
+{
+	uint size = 0;
+	byte* asset = open_asset(path, &size);
+	if (!asset || !find_asset(path)) return asset; // loose files are copies already
+
+	byte* memory = (byte*)calloc(size + 1, sizeof(byte));
+	memcpy(memory, asset, size);
 	return memory;
 }
-void load_file_r32(const char* path, float* memory, uint n)
+
+int compare_paths(const void* a, const void* b) { return strcmp(*(const char**)a, *(const char**)b); }
+
+// packer : 'list_path' has 1 asset path per line, '#' starts a comment
+bool pack_assets(const char* list_path, const char* pack_path)
 {
-	DWORD BytesRead;
-	HANDLE os_file = CreateFileA(path, GENERIC_READ, NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-	ReadFile(os_file, (byte*)memory, n * n * sizeof(float), &BytesRead, NULL);
-	CloseHandle(os_file);
+	char* list = (char*)read_file(list_path);
+	if (!list) { out("ERROR : '" << list_path << "' NOT FOUND!"); return false; }
+
+	uint num_paths = 0;
+	char** paths = Alloc(char*, strlen(list) / 2 + 1);
+
+	for (char* line = strtok(list, "\r\n"); line; line = strtok(NULL, "\r\n"))
+	{
+		while (*line == ' ' || *line == '\t') line++;
+		if (*line == '#' || *line == 0) continue;
+
+		if (strlen(line) >= MAX_ASSET_PATH) { out("ERROR : '" << line << "' is too long to pack"); continue; }
+		paths[num_paths++] = line;
+	}
+
+	qsort(paths, num_paths, sizeof(char*), compare_paths); // find_asset() does a binary search
+
+	Asset_Entry* entries = Alloc(Asset_Entry, num_paths);
+	byte** contents = Alloc(byte*, num_paths);
+
+	uint num_entries = 0;
+	for (uint i = 0; i < num_paths; i++)
+	{
+		contents[num_entries] = read_file(paths[i], &entries[num_entries].size);
+		if (!contents[num_entries]) { out("ERROR : '" << paths[i] << "' NOT FOUND!"); continue; } // left out, so the game still looks for the file
+
+		strcpy(entries[num_entries++].path, paths[i]);
+	}
+
+	uint offset = sizeof(Asset_Pack_Header) + (num_entries * sizeof(Asset_Entry));
+	for (uint i = 0; i < num_entries; i++)
+	{
+		offset = (offset + ASSET_ALIGNMENT - 1) & ~(ASSET_ALIGNMENT - 1);
+		entries[i].offset = offset;
+		offset += entries[i].size + 1; // + the 0
+	}
+
+	Asset_Pack_Header header = { ASSET_PACK_MAGIC, ASSET_PACK_VERSION, num_entries, offset };
+
+	File_Writer pack;
+	if (!open_writer(&pack, pack_path)) { out("ERROR : can't write '" << pack_path << "'"); return false; }
+
+	write(&pack, &header, sizeof(header));
+	write(&pack, entries, num_entries * sizeof(Asset_Entry));
+
+	for (uint i = 0; i < num_entries; i++)
+	{
+		pad(&pack, ASSET_ALIGNMENT);
+		write(&pack, contents[i], entries[i].size + 1); // read_file() added the 0
+		free(contents[i]);
+	}
+
+	bool written = close_writer(&pack);
+	if (!written) out("ERROR : can't write '" << pack_path << "'");
+
+	free(contents);
+	free(entries);
+	free(paths);
+	free(list);
+
+	if (written) print("packed %u assets into %s (%u bytes)\n", num_entries, pack_path, header.size);
+	return written;
+}
+
+// ------------------- Hot Reload ------------------ //
+
+// loose asset files are watched, and once a changed file has stayed the same for HOT_RELOAD_DELAY its reload
+// function is called. a reload that fails must leave the old thing alone. the reload functions live next to
+// whatever they reload (see renderer.h), this part only deals with files & time so it doesn't need a gpu
+
+#define MAX_HOT_RELOADS      64
+#define MAX_RELOAD_FILES     2
+#define HOT_RELOAD_POLL_TIME 0.1f // seconds between checking the files
+#define HOT_RELOAD_DELAY     0.3f // editors often save a file in a few steps
+
+struct Hot_Reload;
+typedef bool reload_function(Hot_Reload* reload); // false = it failed & the old one is still there
+
+struct Hot_Reload
+{
+	reload_function* reload;
+	void* target; // what gets reloaded
+	uint64 param; // anything else the reload needs
+	File_Watch files[MAX_RELOAD_FILES];
+	uint num_files;
+	float delay; // > 0 while a change is settling
+};
+
+struct Hot_Reloader
+{
+	Hot_Reload reloads[MAX_HOT_RELOADS];
+	uint num_reloads;
+	float poll_timer;
+	uint num_reloaded, num_failed;
+};
+
+Hot_Reloader hot_reloader; // the loaders in renderer.h add themselves to this
+
+// NULL if all of the files are packed (those can't change) or there's no room
+Hot_Reload* watch(Hot_Reloader* reloader, reload_function* reload, void* target, uint64 param, const char* path, const char* path_2 = NULL)
+{
+	if (find_asset(path) && (!path_2 || find_asset(path_2))) return NULL;
+	if (reloader->num_reloads == MAX_HOT_RELOADS) { out("ERROR : can't hot reload '" << path << "', there are too many"); return NULL; }
+
+	Hot_Reload* hot_reload = reloader->reloads + reloader->num_reloads++;
+	*hot_reload = { reload, target, param };
+
+	watch(&hot_reload->files[hot_reload->num_files++], path);
+	if (path_2) watch(&hot_reload->files[hot_reload->num_files++], path_2);
+
+	return hot_reload;
+}
+void update(Hot_Reloader* reloader, float dt)
+{
+	reloader->poll_timer -= dt;
+	bool poll = reloader->poll_timer <= 0;
+	if (poll) reloader->poll_timer = HOT_RELOAD_POLL_TIME;
+
+	for (uint i = 0; i < reloader->num_reloads; i++)
+	{
+		Hot_Reload* hot_reload = reloader->reloads + i;
+
+		if (poll)
+		{
+			for (uint f = 0; f < hot_reload->num_files; f++)
+				if (changed(&hot_reload->files[f])) hot_reload->delay = HOT_RELOAD_DELAY; // starts over on every change
+		}
+
+		if (hot_reload->delay <= 0) continue;
+
+		hot_reload->delay -= dt;
+		if (hot_reload->delay > 0) continue;
+
+		const char* path = hot_reload->files[0].path;
+		if (hot_reload->reload(hot_reload))
+		{
+			reloader->num_reloaded++;
+			out("reloaded '" << path << "'");
+		}
+		else
+		{
+			reloader->num_failed++;
+			out("ERROR : couldn't reload '" << path << "', keeping the old one");
+		}
+	}
+}
+
+bool load_file_r32(const char* path, float* memory, uint n) // n * n floats
+{
+	File_Handle file = open_file(path);
+	if (file == NO_FILE) return false;
+
+	bool ok = read_all(file, memory, n * n * sizeof(float));
+	close_file(file);
+	return ok;
 }
 
 // --------------------- Timers -------------------- // // might be broken idk
@@ -85,7 +318,7 @@ int64 calculate_microseconds_elapsed(Timestamp start, Timestamp end)
 	QueryPerformanceFrequency(&win32_performance_frequency);
 
 	// i think (end - start) corresponds directly to cpu clock cycles but i'm not sure
-	return (1000000 * end - start) / win32_performance_frequency.QuadPart;
+	return (1000000 * (end - start)) / win32_performance_frequency.QuadPart;
 }
 
 void os_sleep(uint milliseconds)
@@ -120,16 +353,13 @@ Audio load_audio(const char* path)
 	uint format, size, sample_rate;
 	byte* audio_data = NULL;
 
-	FILE* file = fopen(path, "rb"); // rb = read binary
-	if (file == NULL) { print("ERROR : %s not found\n"); stop;  return 0; }
-
-	fread(&format     , sizeof(uint), 1, file);
-	fread(&sample_rate, sizeof(uint), 1, file);
-	fread(&size       , sizeof(uint), 1, file);
+	byte* file = open_asset(path);
+	if (file == NULL) { print("ERROR : %s not found\n", path); stop;  return 0; }
 
-	audio_data = Alloc(byte, size);
-	fread(audio_data, sizeof(byte), size, file);
-	fclose(file);
+	format      = ((uint*)file)[0];
+	sample_rate = ((uint*)file)[1];
+	size        = ((uint*)file)[2];
+	audio_data  = file + (3 * sizeof(uint));
 
 	ALuint buffer_id = NULL;
 	alGenBuffers(1, &buffer_id);
@@ -139,7 +369,7 @@ Audio load_audio(const char* path)
 	alGenSources(1, &source_id);
 	alSourcei(source_id, AL_BUFFER, buffer_id);
 
-	free(audio_data);
+	close_asset(file);
 	return source_id;
 }
 void play_audio(Audio source_id)
@@ -0,0 +1,399 @@
+// File I/O : the same calls on windows & linux, so the world code can run on a server
+//
+// read_file()  / write_file()  : whole files at once
+// File_View                    : a file mapped into memory (read only)
+// File_Writer                  : buffered writes
+// read_async() / write_async() : whole files, done on the file threads
+// File_Watch                   : tells you when a file has been changed
+//
+// nothing in here prints, everything returns NULL / false when it fails. it only needs mathematics.h & Alloc()
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define MAX_FILE_PATH          256
+#define FILE_WRITE_BUFFER_SIZE (64 * 1024)
+#define MAX_FILE_REQUESTS      256 // async reads & writes in flight
+#define NUM_FILE_THREADS       4
+
+// -------------------- Platform ------------------- //
+
+#ifdef _WIN32
+typedef HANDLE File_Handle;
+#define NO_FILE INVALID_HANDLE_VALUE
+#else
+typedef int File_Handle;
+#define NO_FILE -1
+#endif
+
+File_Handle open_file(const char* path, bool write = false) // write = create / empty it
+{
+#ifdef _WIN32
+	if (write) return CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	return CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+	if (write) return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	return open(path, O_RDONLY);
+#endif
+}
+void close_file(File_Handle file)
+{
+#ifdef _WIN32
+	CloseHandle(file);
+#else
+	close(file);
+#endif
+}
+uint64 file_size(File_Handle file)
+{
+#ifdef _WIN32
+	LARGE_INTEGER size = {};
+	GetFileSizeEx(file, &size);
+	return size.QuadPart;
+#else
+	struct stat info = {};
+	fstat(file, &info);
+	return info.st_size;
+#endif
+}
+bool read_all(File_Handle file, void* memory, uint64 size) // false if it couldn't read all of it
+{
+	byte* next = (byte*)memory;
+	while (size)
+	{
+		uint chunk = (uint)glm::min(size, (uint64)1 << 30); // a single read can't do more than 2gb
+#ifdef _WIN32
+		DWORD done = 0;
+		if (!ReadFile(file, next, chunk, &done, NULL) || done == 0) return false;
+#else
+		ssize_t done = read(file, next, chunk);
+		if (done < 0 && errno == EINTR) continue;
+		if (done <= 0) return false;
+#endif
+		next += done;
+		size -= done;
+	}
+	return true;
+}
+bool write_all(File_Handle file, const void* data, uint64 size)
+{
+	const byte* next = (const byte*)data;
+	while (size)
+	{
+		uint chunk = (uint)glm::min(size, (uint64)1 << 30);
+#ifdef _WIN32
+		DWORD done = 0;
+		if (!WriteFile(file, next, chunk, &done, NULL) || done == 0) return false;
+#else
+		ssize_t done = write(file, next, chunk);
+		if (done < 0 && errno == EINTR) continue;
+		if (done <= 0) return false;
+#endif
+		next += done;
+		size -= done;
+	}
+	return true;
+}
+bool replace_file(const char* from, const char* to) // renames 'from' over 'to' in one step
+{
+#ifdef _WIN32
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+#else
+	return rename(from, to) == 0;
+#endif
+}
+int64 file_time(const char* path) // when it was last written to, 0 if it doesn't exist
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &info)) return 0;
+	return ((int64)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+	if (stat(path, &info) != 0) return 0;
+	return ((int64)info.st_mtim.tv_sec * 1000000000) + info.st_mtim.tv_nsec;
+#endif
+}
+
+// ------------------ Whole Files ------------------ //
+
+byte* read_file(const char* path, uint* size = NULL) // followed by a 0, free() it
+{
+	File_Handle file = open_file(path);
+	if (file == NO_FILE) return NULL;
+
+	uint64 file_bytes = file_size(file);
+	byte* memory = (byte*)calloc(file_bytes + 1, sizeof(byte));
+
+	if (!memory || !read_all(file, memory, file_bytes))
+	{
+		free(memory);
+		memory = NULL;
+	}
+	close_file(file);
+
+	if (size) *size = memory ? (uint)file_bytes : 0;
+	return memory;
+}
+bool write_file(const char* path, const void* data, uint64 size) // the old file is kept if this fails
+{
+	char temp_path[MAX_FILE_PATH];
+	if (snprintf(temp_path, MAX_FILE_PATH, "%s.tmp", path) >= MAX_FILE_PATH) return false;
+
+	File_Handle file = open_file(temp_path, true);
+	if (file == NO_FILE) return false;
+
+	bool written = write_all(file, data, size);
+	close_file(file);
+
+	if (!written || !replace_file(temp_path, path)) { remove(temp_path); return false; }
+	return true;
+}
+
+// -------------------- File View ------------------ //
+
+struct File_View
+{
+	byte* memory;
+	uint64 size;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+};
+
+bool open_view(File_View* view, const char* path) // empty files can't be mapped either
+{
+	*view = {};
+
+	File_Handle file = open_file(path);
+	if (file == NO_FILE) return false;
+
+	uint64 size = file_size(file);
+	byte* memory = NULL;
+
+#ifdef _WIN32
+	HANDLE mapping = size ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	if (mapping) memory = (byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapping && !memory) CloseHandle(mapping);
+	view->mapping = mapping;
+#else
+	if (size) memory = (byte*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (memory == MAP_FAILED) memory = NULL;
+#endif
+	close_file(file); // the mapping keeps the file open
+
+	if (!memory) return false;
+
+	view->memory = memory;
+	view->size   = size;
+	return true;
+}
+void close_view(File_View* view)
+{
+	if (!view->memory) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(view->memory);
+	CloseHandle(view->mapping);
+#else
+	munmap(view->memory, view->size);
+#endif
+	*view = {};
+}
+
+// ------------------- File Writer ----------------- //
+
+struct File_Writer
+{
+	File_Handle file;
+	byte* buffer; // FILE_WRITE_BUFFER_SIZE
+	uint used;
+	uint64 written; // bytes, including what is still in the buffer
+	bool failed;
+};
+
+bool open_writer(File_Writer* writer, const char* path)
+{
+	*writer = {};
+	writer->file = open_file(path, true);
+	if (writer->file == NO_FILE) return false;
+
+	writer->buffer = Alloc(byte, FILE_WRITE_BUFFER_SIZE);
+	return true;
+}
+void flush(File_Writer* writer)
+{
+	if (writer->used && !writer->failed) writer->failed = !write_all(writer->file, writer->buffer, writer->used);
+	writer->used = 0;
+}
+void write(File_Writer* writer, const void* data, uint64 size)
+{
+	writer->written += size;
+
+	if (writer->used + size > FILE_WRITE_BUFFER_SIZE) flush(writer);
+	if (size >= FILE_WRITE_BUFFER_SIZE) // too big to be worth copying
+	{
+		if (!writer->failed) writer->failed = !write_all(writer->file, data, size);
+		return;
+	}
+
+	memcpy(writer->buffer + writer->used, data, size);
+	writer->used += size;
+}
+void pad(File_Writer* writer, uint alignment) // zeros up to the next multiple of 'alignment'
+{
+	static const byte zeros[256] = {};
+
+	uint padding = (uint)((alignment - (writer->written % alignment)) % alignment);
+	while (padding)
+	{
+		uint n = glm::min(padding, (uint)sizeof(zeros));
+		write(writer, zeros, n);
+		padding -= n;
+	}
+}
+bool close_writer(File_Writer* writer) // false if any of the writes failed
+{
+	flush(writer);
+	close_file(writer->file);
+	free(writer->buffer);
+
+	bool ok = !writer->failed;
+	*writer = {};
+	return ok;
+}
+
+// ------------------ Async Files ------------------ //
+
+/* -- how 2 read a file without waiting for it --
+
+	File_Request* request = read_async("world/region_0_0.bin");
+	...
+	if (finished(request)) { use(request->memory, request->size); free(request->memory); release(request); }
+*/
+
+#define REQUEST_FREE   0
+#define REQUEST_QUEUED 1
+#define REQUEST_DONE   2
+#define REQUEST_FAILED 3
+
+struct File_Request
+{
+	char path[MAX_FILE_PATH];
+	byte* memory; // read : filled in (followed by a 0), free() it. write : yours, keep it until it's finished
+	uint size;
+	bool write;
+	std::atomic<uint> state;
+};
+
+struct File_Queue
+{
+	File_Request requests[MAX_FILE_REQUESTS];
+	uint waiting[MAX_FILE_REQUESTS]; // ring of request indices for the threads
+	uint head, tail;
+	bool running;
+
+	std::mutex lock;
+	std::condition_variable wake;
+};
+
+File_Queue* file_queue() // never freed, so the threads don't outlive it when the program exits
+{
+	static File_Queue* queue = new File_Queue();
+	return queue;
+}
+
+void run_file_thread()
+{
+	File_Queue* queue = file_queue();
+
+	for (;;)
+	{
+		File_Request* request = NULL;
+		{
+			std::unique_lock<std::mutex> guard(queue->lock);
+			queue->wake.wait(guard, [queue] { return queue->head != queue->tail; });
+			request = queue->requests + queue->waiting[queue->head++ % MAX_FILE_REQUESTS];
+		}
+
+		bool ok = false;
+		if (request->write) ok = write_file(request->path, request->memory, request->size);
+		else ok = (request->memory = read_file(request->path, &request->size)) != NULL;
+
+		request->state = ok ? REQUEST_DONE : REQUEST_FAILED;
+	}
+}
+File_Request* queue_request(const char* path, byte* memory, uint size, bool write) // NULL if it's full
+{
+	if (strlen(path) >= MAX_FILE_PATH) return NULL;
+
+	File_Queue* queue = file_queue();
+	std::lock_guard<std::mutex> guard(queue->lock);
+
+	if (!queue->running)
+	{
+		for (uint i = 0; i < NUM_FILE_THREADS; i++) std::thread(run_file_thread).detach();
+		queue->running = true;
+	}
+
+	for (uint i = 0; i < MAX_FILE_REQUESTS; i++)
+	{
+		File_Request* request = queue->requests + i;
+		if (request->state != REQUEST_FREE) continue;
+
+		strcpy(request->path, path);
+		request->memory = memory;
+		request->size   = size;
+		request->write  = write;
+		request->state  = REQUEST_QUEUED;
+
+		queue->waiting[queue->tail++ % MAX_FILE_REQUESTS] = i;
+		queue->wake.notify_one();
+		return request;
+	}
+
+	return NULL;
+}
+
+File_Request* read_async(const char* path) { return queue_request(path, NULL, 0, false); }
+File_Request* write_async(const char* path, byte* data, uint size) { return queue_request(path, data, size, true); }
+
+bool finished(File_Request* request) { return request->state >= REQUEST_DONE; } // check 'state' for failure
+void wait(File_Request* request) { while (!finished(request)) std::this_thread::yield(); }
+void release(File_Request* request) { request->state = REQUEST_FREE; } // after it's finished
+
+// ------------------- File Watch ------------------ //
+
+// polls the modification time, which is cheap enough to do every frame for a handful of files.
+// editors often write a file in more than one step, so it can change again right after
+
+struct File_Watch
+{
+	char path[MAX_FILE_PATH];
+	int64 time;
+};
+
+void watch(File_Watch* file_watch, const char* path)
+{
+	strncpy(file_watch->path, path, MAX_FILE_PATH - 1);
+	file_watch->time = file_time(file_watch->path);
+}
+bool changed(File_Watch* file_watch) // true once per change
+{
+	int64 time = file_time(file_watch->path);
+	if (time == file_watch->time) return false;
+
+	file_watch->time = time;
+	return time != 0; // deleted files don't count until they come back
+}
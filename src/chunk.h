@@ -11,6 +11,7 @@
 
 #define NUM_CHUNK_BLOCKS (CHUNK_X * CHUNK_Z * CHUNK_Y)
 #define BLOCK_INDEX(x,y,z,i) ((((x) + (CHUNK_X * (z))) + ((CHUNK_X * CHUNK_Z) * (y))) + (NUM_CHUNK_BLOCKS * i))
+#define COLUMN_INDEX(x,z,i) (((x) + (CHUNK_X * (z))) + ((CHUNK_X * CHUNK_Z) * (i)))
 
 #define BLOCK_AIR	0
 
@@ -65,12 +66,14 @@
 #define BLOCK_WIRE 42
 
 // fluids
-#define BLOCK_WATER	50
-#define BLOCK_WATER	51
-#define BLOCK_WATER	52
-#define BLOCK_WATER_FLOW	53
-#define BLOCK_WATER_FLOW	54
-#define BLOCK_WATER_FLOW	55
+#define BLOCK_WATER	50 // source block, never runs dry
+#define BLOCK_WATER_FLOW	51 // 51 - 57 : flowing water, level 1 - 7 (see flow_block())
+#define MAX_FLOW_LEVEL	7
+
+#define LOADED_CHUNKS_WIDTH 7 // loaded chunks always form a 7x7 square around the player
+
+bool is_solid(u16 block) { return block != BLOCK_AIR && block < BLOCK_WATER; } // INVALID is not solid
+bool is_fluid(u16 block) { return block >= BLOCK_WATER && block < BLOCK_WATER_FLOW + MAX_FLOW_LEVEL; }
 
 struct Chunk
 {
@@ -78,6 +81,95 @@ struct Chunk
 	u16 blocks_index;
 };
 
+// block faces / directions
+#define FACE_POS_X 0
+#define FACE_NEG_X 1
+#define FACE_POS_Z 2
+#define FACE_NEG_Z 3
+#define FACE_POS_Y 4
+#define FACE_NEG_Y 5
+
+const ivec3 FACE_DIRS[6] = { ivec3(1,0,0), ivec3(-1,0,0), ivec3(0,0,1), ivec3(0,0,-1), ivec3(0,1,0), ivec3(0,-1,0) };
+
+struct Chunk_Lookup // finds the block data of a loaded chunk without scanning the chunk list
+{
+	uint32 x, z; // block coordinates of the corner of the loaded square
+	u16 blocks_index[LOADED_CHUNKS_WIDTH * LOADED_CHUNKS_WIDTH]; // INVALID = not loaded
+	u16 neighbors[NUM_CHUNKS][4]; // [blocks_index][FACE_POS_X .. FACE_NEG_Z] -> blocks_index, INVALID = not loaded
+	u8  tiers[NUM_CHUNKS]; // [blocks_index] -> TIER_ACTIVE / BORDER / PRIMED
+};
+
+#define TIER_ACTIVE 0 // the player's chunk & the ring around it
+#define TIER_BORDER 1 // simulated at a lower rate
+#define TIER_PRIMED 2 // loaded, but not simulated
+#define NUM_TIERS   3
+
+const uint TIER_TICK_RATE[NUM_TIERS] = { 1, 4, 0 }; // a chunk is ticked every n ticks, 0 = never (primed)
+
+#define INVALID_BLOCK_INDEX 0xFFFFFFFF
+
+// light : every block stores (sky light << 4) | block light, both 0 - 15
+#define MAX_LIGHT 15
+#define LIGHT_BLOCK 0 // light channels
+#define LIGHT_SKY   1
+
+#define LIGHT_QUEUE_SIZE (1 << 18) // must be a power of 2
+
+struct Light_Queue // ring buffer of (block index | channel << 23 | light level << 24)
+{
+	uint head, tail;
+	bool overflow; // some nodes didn't fit, the light has to be rebuilt (see rebuild_light())
+	uint nodes[LIGHT_QUEUE_SIZE];
+};
+
+// fluid simulation : only cells next to a recent change are looked at, never the whole world
+#define FLUID_QUEUE_SIZE (1 << 16) // per tier, must be a power of 2
+
+struct Fluid_Queue // ring buffer of block indices
+{
+	uint head, tail;
+	uint cells[FLUID_QUEUE_SIZE];
+};
+
+struct Fluid_Sim
+{
+	Fluid_Queue queues[NUM_TIERS]; // cells are queued by the tier of their chunk
+	u8 queued[(NUM_CHUNKS * NUM_CHUNK_BLOCKS) / 8]; // 1 bit per block, so no cell is queued twice
+};
+
+// block entities : blocks with state of their own (chest contents, furnace progress, etc.). the state lives with
+// the world (see items.h), the chunk loader only logs where blocks that have one were placed or removed
+#define ENTITY_NONE		0
+#define ENTITY_CHEST		1
+#define ENTITY_FURNACE	2
+#define ENTITY_CRAFTING	3
+#define ENTITY_MACHINE	4
+#define ENTITY_PIPE		5 // pipes, belts & wires
+#define NUM_ENTITY_TYPES	6
+
+#define ENTITY_LOG_SIZE 4096
+
+u8 block_entity_type(u16 block)
+{
+	switch (block)
+	{
+	case BLOCK_CHEST   : return ENTITY_CHEST;
+	case BLOCK_FURNACE : return ENTITY_FURNACE;
+	case BLOCK_CRAFTING: return ENTITY_CRAFTING;
+	case BLOCK_PIPE    :
+	case BLOCK_BELT    :
+	case BLOCK_WIRE    : return ENTITY_PIPE;
+	default: return (block >= BLOCK_QUARRY && block <= BLOCK_OIL_REFINERY) ? ENTITY_MACHINE : ENTITY_NONE;
+	}
+}
+
+struct Entity_Log // positions whose block entity may have changed, emptied by the world every frame
+{
+	uint count;
+	bool overflow; // some changes didn't fit, every loaded block has to be checked
+	ivec3 positions[ENTITY_LOG_SIZE];
+};
+
 struct Chunk_Loader
 {
 	union
@@ -92,9 +184,62 @@ struct Chunk_Loader
 		};
 	};
 
+	uint seed; // world seed, see gen_random()
+	Chunk_Lookup lookup; // rebuilt whenever chunks are loaded or unloaded
+	bool dirty[NUM_CHUNKS]; // indexed by blocks_index; set when blocks change, cleared when remeshed
+	u8  heights[NUM_CHUNKS * CHUNK_X * CHUNK_Z]; // y above the topmost solid block of each column, 0 if there is none
+	u16 surface[NUM_CHUNKS * CHUNK_X * CHUNK_Z]; // the topmost solid block of each column, BLOCK_AIR if there is none
 	u16 blocks[NUM_CHUNKS * NUM_CHUNK_BLOCKS];
+	u8  light [NUM_CHUNKS * NUM_CHUNK_BLOCKS];
+	Light_Queue light_adds, light_removals;
+	Fluid_Sim fluids;
+	Entity_Log entity_log;
 };
 
+// world generation randomness : every random number is a hash of (seed, chunk, feature, counter)
+// so it only depends on its inputs. chunks can be generated in any order, on any thread,
+// and always come out the same. never use random_uint() (or randfn() etc.) in here!
+
+#define FEATURE_TERRAIN	0
+#define FEATURE_TREES	1
+#define FEATURE_ORES	2
+#define FEATURE_CAVES	3 // caves use 2 noise fields : 3 & 4
+
+uint noise_uint(uint n, uint seed) // squirrel noise
+{
+	n *= BIT_NOISE_1;
+	n += seed;
+	n ^= (n >> 8);
+	n += BIT_NOISE_2;
+	n ^= (n << 8);
+	n *= BIT_NOISE_3;
+	n ^= (n >> 8);
+	return n;
+}
+
+struct Gen_Random
+{
+	uint key;     // hash of (seed, chunk, feature)
+	uint counter; // how many numbers have been drawn so far
+};
+
+Gen_Random gen_random(uint seed, uint chunk_x, uint chunk_z, uint feature)
+{
+	uint key = noise_uint(chunk_x, seed);
+	key = noise_uint(chunk_z, key);
+	key = noise_uint(feature, key);
+	return { key, 0 };
+}
+uint  next_uint (Gen_Random* rng) { return noise_uint(rng->counter++, rng->key); }
+uint  next_uint (Gen_Random* rng, uint max) { return next_uint(rng) % max; } // [0, max)
+float next_float(Gen_Random* rng) { return (next_uint(rng) >> 8) * (1.f / (1 << 24)); } // [0, 1)
+
+vec2 terrain_offset(uint seed) // moves the noise around so every seed gets a different world
+{
+	Gen_Random rng = gen_random(seed, 0, 0, FEATURE_TERRAIN);
+	return vec2(next_uint(&rng, 1024), next_uint(&rng, 1024));
+}
+
 float terrain_noise(float x, float y, float scale)
 {
 	uint octaves = 4;
@@ -116,77 +261,265 @@ float terrain_noise(float x, float y, float scale)
 
 	return n;
 }
-void generate(Chunk chunk, u16* blocks, float scale = 45)
+// world generation is a pipeline of passes over one chunk :
+// heightmap -> biomes -> caves -> ores -> decorations (trees)
+//
+// ores & trees can cross chunk borders. instead of loading the neighbouring chunks, every chunk
+// replays the features of the chunks around it (they only depend on the seed & chunk coordinates)
+// and keeps whatever lands inside of it. this keeps generation independent from chunk loading.
+
+#define WATER_LEVEL 24
+#define TERRAIN_SCALE 45.f
+#define CLIMATE_SCALE 400.f
+
+#define BIOME_OCEAN		0
+#define BIOME_BEACH		1
+#define BIOME_PLAINS	2
+#define BIOME_FOREST	3
+#define BIOME_DESERT	4
+
+struct Biome
+{
+	u16 top, filler; // surface block & the few blocks under it
+	float tree_chance;
+};
+
+const Biome BIOMES[] = {
+	{ BLOCK_SAND , BLOCK_SAND, 0    }, // ocean
+	{ BLOCK_SAND , BLOCK_SAND, 0    }, // beach
+	{ BLOCK_GRASS, BLOCK_DIRT, .08f }, // plains
+	{ BLOCK_GRASS, BLOCK_DIRT, .6f  }, // forest
+	{ BLOCK_SAND , BLOCK_SAND, 0    }, // desert
+};
+
+struct Ore_Vein
+{
+	u16 block;
+	uint veins_per_chunk, max_y, size;
+};
+
+const Ore_Vein ORES[] = {
+	{ BLOCK_COAL_ORE   , 12, 64, 10 },
+	{ BLOCK_IRON_ORE   ,  8, 48,  8 },
+	{ BLOCK_COPPER_ORE ,  8, 48,  8 },
+	{ BLOCK_GOLD_ORE   ,  2, 24,  6 },
+	{ BLOCK_DIAMOND_ORE,  1, 12,  4 },
+	{ BLOCK_EMERALD_ORE,  1, 16,  3 },
+	{ BLOCK_RUBY_ORE   ,  1, 16,  3 },
+};
+
+#define TREE_ATTEMPTS 8 // per chunk, the biome decides how many succeed
+
+struct Chunk_Generator // scratch data for the generation passes over one chunk
+{
+	Chunk chunk;
+	uint seed;
+	u16* blocks; // the blocks of this chunk only
+
+	u8 heights[CHUNK_X * CHUNK_Z];
+	u8 biomes [CHUNK_X * CHUNK_Z];
+};
+
+// these only depend on their inputs so they can be evaluated for columns in other chunks
+uint terrain_height(uint seed, int x, int z)
+{
+	vec2 point = (vec2(x, z) / TERRAIN_SCALE) + terrain_offset(seed);
+	return glm::min(64 * terrain_noise(point.x, point.y, 1), (float)CHUNK_Y - 1);
+}
+uint biome_at(uint seed, int x, int z, uint height)
 {
-	uint x_pos = chunk.x & 0xFFF0;
-	uint z_pos = chunk.z & 0xFFF0;
+	if (height <= WATER_LEVEL) return BIOME_OCEAN;
+	if (height <= WATER_LEVEL + 1) return BIOME_BEACH;
 
-	uint water_level = 24;
+	// low frequency 'climate' noise, moved away from the terrain noise so they don't line up
+	vec2 point = (vec2(x, z) / CLIMATE_SCALE) + terrain_offset(seed) + vec2(512);
+	float climate = terrain_noise(point.x, point.y, 1);
 
+	if (climate > .52f) return BIOME_DESERT;
+	if (climate < .43f) return BIOME_FOREST;
+	return BIOME_PLAINS;
+}
+// caves use 3D value noise with a lattice point every CAVE_SPACING blocks. the spacing is the
+// width of a chunk, so a chunk only ever needs the 2 x 2 columns of lattice points around it
+#define CAVE_SPACING CHUNK_X
+#define CAVE_LATTICE_Y ((CHUNK_Y / CAVE_SPACING) + 1)
+
+float lattice_value(uint seed, uint feature, ivec3 p)
+{
+	uint n = noise_uint(p.x, noise_uint(p.y, noise_uint(p.z, noise_uint(feature, seed))));
+	return (n >> 8) * (1.f / (1 << 24));
+}
+u16* gen_block(Chunk_Generator* gen, ivec3 world_pos) // NULL if the block is outside of this chunk
+{
+	uint x = (uint)(world_pos.x - (int)gen->chunk.x);
+	uint z = (uint)(world_pos.z - (int)gen->chunk.z);
+	uint y = (uint)world_pos.y;
+
+	if (x >= CHUNK_X || z >= CHUNK_Z || y >= CHUNK_Y) return NULL;
+	return gen->blocks + BLOCK_INDEX(x, y, z, 0);
+}
+
+void generate_heightmap(Chunk_Generator* gen)
+{
 	for (uint x = 0; x < CHUNK_X; ++x) {
 	for (uint z = 0; z < CHUNK_Z; ++z)
 	{
-		vec2 point = vec2{ x + x_pos, z + z_pos } / scale;
-
-		// heightfield noise
-		uint height = 64 * terrain_noise(point.x, point.y, 1);
+		gen->heights[x + (z * CHUNK_X)] = terrain_height(gen->seed, gen->chunk.x + x, gen->chunk.z + z);
+	} }
+}
+void generate_biomes(Chunk_Generator* gen) // picks a biome per column & fills it in
+{
+	for (uint x = 0; x < CHUNK_X; ++x) {
+	for (uint z = 0; z < CHUNK_Z; ++z)
+	{
+		uint height = gen->heights[x + (z * CHUNK_X)];
+		uint biome  = biome_at(gen->seed, gen->chunk.x + x, gen->chunk.z + z, height);
+		gen->biomes[x + (z * CHUNK_X)] = biome;
 
-		//// tree noise
-		//float n1 = perlin(point.x, point.y);
-		//float n2 = perlin(point.x + EPSILON, point.y + EPSILON);
-		//float n3 = perlin(point.x + EPSILON2, point.y + EPSILON2);
-		//
-		//float d1 = (n2 - n1) / EPSILON; // first derivative
-		//float d2 = (n2 - (2.f * n1) + n3) / EPSILON2; // second derivative
+		Biome info = BIOMES[biome];
 
 		for (uint y = 0; y < CHUNK_Y; ++y)
 		{
-			uint index = BLOCK_INDEX(x, y, z, chunk.blocks_index);
+			u16 block = BLOCK_AIR;
 
-			if (y == water_level && height <= water_level)
-			{
-				blocks[index] = BLOCK_WATER;
-				continue;
-			}
+			if (y == height) block = info.top;
+			else if (y + 3 >= height && y < height) block = info.filler;
+			else if (y < height) block = BLOCK_STONE;
+			else if (y <= WATER_LEVEL) block = BLOCK_WATER; // seas are full all the way down
 
-			if (y > height)
-			{
-				blocks[index] = BLOCK_AIR;
-				continue;
-			}
+			gen->blocks[BLOCK_INDEX(x, y, z, 0)] = block;
+		}
+	} }
+}
+void carve_caves(Chunk_Generator* gen)
+{
+	// tunnels are where two noise 'surfaces' intersect
+	ivec3 cell = ivec3((int)gen->chunk.x / CAVE_SPACING, 0, (int)gen->chunk.z / CAVE_SPACING);
+
+	float lattice[2][CAVE_LATTICE_Y][2][2]; // [noise][y][z][x]
+	for (uint n = 0; n < 2; n++) {
+	for (uint y = 0; y < CAVE_LATTICE_Y; y++) {
+	for (uint z = 0; z < 2; z++) {
+	for (uint x = 0; x < 2; x++)
+	{
+		lattice[n][y][z][x] = lattice_value(gen->seed, FEATURE_CAVES + n, cell + ivec3(x, y, z));
+	} } } }
 
-			if (height > water_level) // land
-			{
-				if (y == water_level + 1)
-					blocks[index] = BLOCK_SAND;
-				else if (y == height)
-					blocks[index] = BLOCK_GRASS;
-				else if (y == height - 1)
-					blocks[index] = BLOCK_DIRT;
-			}
-			else if (y < water_level)// ocean
+	for (uint x = 0; x < CHUNK_X; ++x) {
+	for (uint z = 0; z < CHUNK_Z; ++z)
+	{
+		uint height = gen->heights[x + (z * CHUNK_X)];
+		if (height < 6) continue;
+
+		uint top = (height > WATER_LEVEL) ? height - 4 : height - 6; // don't break into the sea / the surface (trees are placed on it)
+
+		float tx = smoothstep(0, 1, x / (float)CAVE_SPACING);
+		float tz = smoothstep(0, 1, z / (float)CAVE_SPACING);
+
+		for (uint y = 1; y < top; ++y)
+		{
+			uint  ly = y / CAVE_SPACING;
+			float ty = smoothstep(0, 1, (y % CAVE_SPACING) / (float)CAVE_SPACING);
+
+			float noise[2];
+			for (uint n = 0; n < 2; n++)
 			{
-				if (y == height)
-					blocks[index] = BLOCK_WATER;
-				else if (y == height - 1)
-					blocks[index] = BLOCK_SAND;
+				float (*l)[2][2] = lattice[n];
+				float a = lerp(lerp(l[ly][0][0], l[ly][0][1], tx), lerp(l[ly][1][0], l[ly][1][1], tx), tz);
+				float b = lerp(lerp(l[ly + 1][0][0], l[ly + 1][0][1], tx), lerp(l[ly + 1][1][0], l[ly + 1][1][1], tx), tz);
+				noise[n] = lerp(a, b, ty);
 			}
 
-			if (y < height - 1) // underground
+			if (abs(noise[0] - .5f) < .06f && abs(noise[1] - .5f) < .06f)
+				gen->blocks[BLOCK_INDEX(x, y, z, 0)] = BLOCK_AIR;
+		}
+	} }
+}
+void generate_ores(Chunk_Generator* gen)
+{
+	for (int dx = -1; dx <= 1; dx++) {
+	for (int dz = -1; dz <= 1; dz++)
+	{
+		uint chunk_x = gen->chunk.x + (dx * CHUNK_X);
+		uint chunk_z = gen->chunk.z + (dz * CHUNK_Z);
+		Gen_Random rng = gen_random(gen->seed, chunk_x, chunk_z, FEATURE_ORES);
+
+		for (uint ore = 0; ore < sizeof(ORES) / sizeof(Ore_Vein); ore++) {
+		for (uint v = 0; v < ORES[ore].veins_per_chunk; v++)
+		{
+			ivec3 pos = ivec3(chunk_x + next_uint(&rng, CHUNK_X), next_uint(&rng, ORES[ore].max_y), chunk_z + next_uint(&rng, CHUNK_Z));
+
+			for (uint n = 0; n < ORES[ore].size; n++) // random walk
 			{
-				blocks[index] = BLOCK_STONE;
+				u16* block = gen_block(gen, pos);
+				if (block && *block == BLOCK_STONE) *block = ORES[ore].block;
+
+				uint dir = next_uint(&rng, 6);
+				pos[dir / 2] += (dir & 1) ? 1 : -1;
 			}
+		} }
+	} }
+}
+void place_tree(Chunk_Generator* gen, ivec3 base, uint trunk_height)
+{
+	ivec3 top = base + ivec3(0, trunk_height, 0);
+
+	for (int x = -2; x <= 2; x++) { // leaves
+	for (int y = -2; y <= 2; y++) {
+	for (int z = -2; z <= 2; z++)
+	{
+		if ((x * x) + (y * y) + (z * z) > 6) continue; // rounded
+
+		u16* block = gen_block(gen, top + ivec3(x, y, z));
+		if (block && *block == BLOCK_AIR) *block = BLOCK_GRASS;
+	} } }
+
+	for (uint y = 1; y <= trunk_height; y++)
+	{
+		u16* block = gen_block(gen, base + ivec3(0, y, 0));
+		if (block) *block = BLOCK_WOOD;
+	}
+}
+void generate_decorations(Chunk_Generator* gen)
+{
+	for (int dx = -1; dx <= 1; dx++) {
+	for (int dz = -1; dz <= 1; dz++)
+	{
+		uint chunk_x = gen->chunk.x + (dx * CHUNK_X);
+		uint chunk_z = gen->chunk.z + (dz * CHUNK_Z);
+		Gen_Random rng = gen_random(gen->seed, chunk_x, chunk_z, FEATURE_TREES);
+
+		for (uint i = 0; i < TREE_ATTEMPTS; i++)
+		{
+			// always draw the same amount of numbers so the sequence doesn't depend on the result
+			int x = chunk_x + next_uint(&rng, CHUNK_X);
+			int z = chunk_z + next_uint(&rng, CHUNK_Z);
+			float chance = next_float(&rng);
+			uint trunk_height = 4 + next_uint(&rng, 3);
+
+			uint height = terrain_height(gen->seed, x, z);
+			uint biome  = biome_at(gen->seed, x, z, height);
 
-			//// trees
-			//if (d2 == 0.f && d1 == 0 && height == y)
-			//{
-			//	blocks[index] = BLOCK_WOOD;
-			//	continue;
-			//}
+			if (chance < BIOMES[biome].tree_chance && height + trunk_height + 3 < CHUNK_Y)
+				place_tree(gen, ivec3(x, height, z), trunk_height);
 		}
 	} }
 }
 
+void generate(Chunk chunk, u16* blocks, uint seed)
+{
+	Chunk_Generator gen = {};
+	gen.chunk  = chunk;
+	gen.seed   = seed;
+	gen.blocks = blocks + (chunk.blocks_index * NUM_CHUNK_BLOCKS);
+
+	generate_heightmap  (&gen);
+	generate_biomes     (&gen);
+	carve_caves         (&gen);
+	generate_ores       (&gen);
+	generate_decorations(&gen);
+}
+
 uint max(uint a, uint b) { return (a > b) ? a : b; }
 uint absi(int a) { return a >= 0 ? a : a * -1; }
 
@@ -194,6 +527,480 @@ void unload_blocks(u16* blocks, uint index)
 {
 	memset(&blocks[index * NUM_CHUNK_BLOCKS], 0, sizeof(u16) * NUM_CHUNK_BLOCKS);
 }
+void update_lookup(Chunk_Loader* chunks)
+{
+	Chunk_Lookup* lookup = &chunks->lookup;
+	Chunk* loaded = chunks->loaded_chunks;
+
+	// coordinates are compared as offsets from the first chunk so that chunks on the
+	// other side of 0 (which have wrapped around) still end up in the right place
+	int min_x = 0, min_z = 0;
+	for (uint i = 0; i < NUM_CHUNKS; i++)
+	{
+		int dx = (int)(loaded[i].x - loaded[0].x);
+		int dz = (int)(loaded[i].z - loaded[0].z);
+		if (dx < min_x) min_x = dx;
+		if (dz < min_z) min_z = dz;
+	}
+
+	lookup->x = loaded[0].x + min_x;
+	lookup->z = loaded[0].z + min_z;
+	memset(lookup->blocks_index, 0xFF, sizeof(lookup->blocks_index));
+
+	for (uint i = 0; i < NUM_CHUNKS; i++)
+	{
+		uint lx = (uint)((int)(loaded[i].x - lookup->x) / CHUNK_X);
+		uint lz = (uint)((int)(loaded[i].z - lookup->z) / CHUNK_Z);
+
+		if (lx < LOADED_CHUNKS_WIDTH && lz < LOADED_CHUNKS_WIDTH)
+			lookup->blocks_index[lx + (lz * LOADED_CHUNKS_WIDTH)] = loaded[i].blocks_index;
+
+		if      (i < NUM_ACTIVE_CHUNKS)                     lookup->tiers[loaded[i].blocks_index] = TIER_ACTIVE;
+		else if (i < NUM_ACTIVE_CHUNKS + NUM_BORDER_CHUNKS) lookup->tiers[loaded[i].blocks_index] = TIER_BORDER;
+		else                                                lookup->tiers[loaded[i].blocks_index] = TIER_PRIMED;
+	}
+
+	memset(lookup->neighbors, 0xFF, sizeof(lookup->neighbors));
+
+	for (int lx = 0; lx < LOADED_CHUNKS_WIDTH; lx++) {
+	for (int lz = 0; lz < LOADED_CHUNKS_WIDTH; lz++)
+	{
+		u16 blocks_index = lookup->blocks_index[lx + (lz * LOADED_CHUNKS_WIDTH)];
+		if (blocks_index == INVALID) continue;
+
+		u16* neighbors = lookup->neighbors[blocks_index];
+		if (lx < LOADED_CHUNKS_WIDTH - 1) neighbors[FACE_POS_X] = lookup->blocks_index[(lx + 1) + (lz * LOADED_CHUNKS_WIDTH)];
+		if (lx > 0)                       neighbors[FACE_NEG_X] = lookup->blocks_index[(lx - 1) + (lz * LOADED_CHUNKS_WIDTH)];
+		if (lz < LOADED_CHUNKS_WIDTH - 1) neighbors[FACE_POS_Z] = lookup->blocks_index[lx + ((lz + 1) * LOADED_CHUNKS_WIDTH)];
+		if (lz > 0)                       neighbors[FACE_NEG_Z] = lookup->blocks_index[lx + ((lz - 1) * LOADED_CHUNKS_WIDTH)];
+	} }
+}
+
+// column heightmap : kept in sync with the blocks so the surface never has to be searched for
+
+uint column_of(uint block_index) // Chunk_Loader.blocks index -> Chunk_Loader.heights index
+{
+	uint blocks_index = block_index / NUM_CHUNK_BLOCKS;
+	return COLUMN_INDEX(0, 0, blocks_index) + (block_index % (CHUNK_X * CHUNK_Z));
+}
+void scan_column(Chunk_Loader* chunks, uint column, int top) // top = highest y that could be solid
+{
+	uint blocks_index = column / (CHUNK_X * CHUNK_Z);
+	u16* blocks = chunks->blocks + (blocks_index * NUM_CHUNK_BLOCKS) + (column % (CHUNK_X * CHUNK_Z));
+
+	int y = top;
+	while (y >= 0 && !is_solid(blocks[y * (CHUNK_X * CHUNK_Z)])) y--;
+
+	chunks->heights[column] = (u8)(y + 1);
+	chunks->surface[column] = (y >= 0) ? blocks[y * (CHUNK_X * CHUNK_Z)] : BLOCK_AIR;
+}
+void update_columns(Chunk_Loader* chunks, uint blocks_index) // after the whole chunk has changed
+{
+	for (uint i = 0; i < CHUNK_X * CHUNK_Z; i++)
+		scan_column(chunks, COLUMN_INDEX(0, 0, blocks_index) + i, CHUNK_Y - 1);
+}
+void update_column(Chunk_Loader* chunks, uint block_index, u16 new_block) // after a single block has changed
+{
+	uint column = column_of(block_index);
+	int y = (block_index % NUM_CHUNK_BLOCKS) / (CHUNK_X * CHUNK_Z);
+	int height = chunks->heights[column];
+
+	if (is_solid(new_block))
+	{
+		if (y >= height - 1)
+		{
+			chunks->heights[column] = (u8)(y + 1);
+			chunks->surface[column] = new_block;
+		}
+	}
+	else if (y == height - 1) scan_column(chunks, column, y - 1); // the surface was removed
+}
+
+// lighting : sky light & block light are flood filled (breadth first) through non-solid blocks.
+// adding light spreads it outwards, removing light clears everything it lit & refills the hole from
+// whatever light is left around it. both only visit the blocks that actually change.
+
+u8 light_emitted(u16 block) // block light given off by a block
+{
+	switch (block)
+	{
+	case BLOCK_FURNACE  : return 13;
+	case BLOCK_SMELTER  : return 14;
+	case BLOCK_GENERATOR: return 10;
+	default: return 0;
+	}
+}
+
+void push_light(Light_Queue* queue, uint index, uint channel, uint level = 0)
+{
+	if (queue->tail - queue->head == LIGHT_QUEUE_SIZE) { queue->overflow = true; return; }
+	queue->nodes[queue->tail++ & (LIGHT_QUEUE_SIZE - 1)] = index | (channel << 23) | (level << 24);
+}
+bool pop_light(Light_Queue* queue, uint* index, uint* channel, uint* level)
+{
+	if (queue->head == queue->tail) return false;
+
+	uint node = queue->nodes[queue->head++ & (LIGHT_QUEUE_SIZE - 1)];
+	*index   = node & 0x7FFFFF;
+	*channel = (node >> 23) & 1;
+	*level   = node >> 24;
+	return true;
+}
+
+uint neighbor(Chunk_Lookup* lookup, uint index, uint face) // the block next to 'index', INVALID_BLOCK_INDEX if it isn't loaded
+{
+	uint i = index % NUM_CHUNK_BLOCKS, blocks_index = index / NUM_CHUNK_BLOCKS;
+	uint x = i % CHUNK_X, z = (i / CHUNK_X) % CHUNK_Z, y = i / (CHUNK_X * CHUNK_Z);
+
+	switch (face)
+	{
+	case FACE_POS_X: if (x < CHUNK_X - 1) return index + 1; x = 0; break;
+	case FACE_NEG_X: if (x > 0) return index - 1; x = CHUNK_X - 1; break;
+	case FACE_POS_Z: if (z < CHUNK_Z - 1) return index + CHUNK_X; z = 0; break;
+	case FACE_NEG_Z: if (z > 0) return index - CHUNK_X; z = CHUNK_Z - 1; break;
+	case FACE_POS_Y: return (y < CHUNK_Y - 1) ? index + (CHUNK_X * CHUNK_Z) : INVALID_BLOCK_INDEX;
+	default        : return (y > 0) ? index - (CHUNK_X * CHUNK_Z) : INVALID_BLOCK_INDEX;
+	}
+
+	u16 next = lookup->neighbors[blocks_index][face]; // crossed into the next chunk
+	return (next == INVALID) ? INVALID_BLOCK_INDEX : BLOCK_INDEX(x, y, z, next);
+}
+
+uint get_light(Chunk_Loader* chunks, uint index, uint channel)
+{
+	return (chunks->light[index] >> (channel * 4)) & 0xF;
+}
+void set_light(Chunk_Loader* chunks, uint index, uint channel, uint level)
+{
+	u8* light = chunks->light + index;
+	*light = (*light & ~(0xF << (channel * 4))) | (level << (channel * 4));
+
+	// blocks on the edge of a chunk are lit by this light too, those chunks have to be remeshed
+	uint i = index % NUM_CHUNK_BLOCKS, blocks_index = index / NUM_CHUNK_BLOCKS;
+	uint x = i % CHUNK_X, z = (i / CHUNK_X) % CHUNK_Z;
+	u16* neighbors = chunks->lookup.neighbors[blocks_index];
+
+	chunks->dirty[blocks_index] = true;
+	if (x == 0           && neighbors[FACE_NEG_X] != INVALID) chunks->dirty[neighbors[FACE_NEG_X]] = true;
+	if (x == CHUNK_X - 1 && neighbors[FACE_POS_X] != INVALID) chunks->dirty[neighbors[FACE_POS_X]] = true;
+	if (z == 0           && neighbors[FACE_NEG_Z] != INVALID) chunks->dirty[neighbors[FACE_NEG_Z]] = true;
+	if (z == CHUNK_Z - 1 && neighbors[FACE_POS_Z] != INVALID) chunks->dirty[neighbors[FACE_POS_Z]] = true;
+}
+uint light_source(Chunk_Loader* chunks, uint index, uint channel) // light a block has without any neighbors
+{
+	u16 block = chunks->blocks[index];
+	if (channel == LIGHT_BLOCK) return light_emitted(block);
+
+	bool top = (index % NUM_CHUNK_BLOCKS) / (CHUNK_X * CHUNK_Z) == CHUNK_Y - 1; // the sky is right above it
+	return (top && !is_solid(block)) ? MAX_LIGHT : 0;
+}
+uint light_through(uint level, uint channel, uint face) // light that reaches the next block in direction 'face'
+{
+	if (channel == LIGHT_SKY && face == FACE_NEG_Y && level == MAX_LIGHT) return MAX_LIGHT; // sunlight doesn't fade going down
+	return (level > 0) ? level - 1 : 0;
+}
+
+void propagate_light(Chunk_Loader* chunks) // empties light_adds
+{
+	uint index, channel, level;
+	while (pop_light(&chunks->light_adds, &index, &channel, &level))
+	{
+		level = get_light(chunks, index, channel); // read it now, it may have changed since it was queued
+		if (level <= 1) continue;
+
+		for (uint face = 0; face < 6; face++)
+		{
+			uint next = neighbor(&chunks->lookup, index, face);
+			if (next == INVALID_BLOCK_INDEX || is_solid(chunks->blocks[next])) continue;
+
+			uint next_level = light_through(level, channel, face);
+			if (get_light(chunks, next, channel) >= next_level) continue;
+
+			set_light(chunks, next, channel, next_level);
+			push_light(&chunks->light_adds, next, channel);
+		}
+	}
+}
+void unpropagate_light(Chunk_Loader* chunks) // empties light_removals & queues whatever has to be refilled in light_adds
+{
+	uint index, channel, level;
+	while (pop_light(&chunks->light_removals, &index, &channel, &level))
+	{
+		for (uint face = 0; face < 6; face++)
+		{
+			uint next = neighbor(&chunks->lookup, index, face);
+			if (next == INVALID_BLOCK_INDEX) continue;
+
+			uint next_level = get_light(chunks, next, channel);
+			if (next_level == 0) continue;
+
+			bool lit_by_removed = (next_level < level) || (next_level == light_through(level, channel, face));
+			if (lit_by_removed && light_source(chunks, next, channel) == 0)
+			{
+				set_light(chunks, next, channel, 0);
+				push_light(&chunks->light_removals, next, channel, next_level);
+			}
+			else push_light(&chunks->light_adds, next, channel); // lit from somewhere else, spread that back in
+		}
+	}
+}
+
+void unlight_block(Chunk_Loader* chunks, uint index) // step 1 of relighting a changed block
+{
+	for (uint channel = 0; channel < 2; channel++)
+	{
+		uint level = get_light(chunks, index, channel);
+		if (level == 0) continue;
+
+		set_light(chunks, index, channel, 0);
+		push_light(&chunks->light_removals, index, channel, level);
+	}
+}
+void relight_block(Chunk_Loader* chunks, uint index) // step 2, after unpropagate_light()
+{
+	bool solid = is_solid(chunks->blocks[index]);
+
+	for (uint channel = 0; channel < 2; channel++)
+	{
+		uint level = light_source(chunks, index, channel);
+
+		if (solid == false) // take light from the neighbors
+		{
+			for (uint face = 0; face < 6; face++)
+			{
+				uint next = neighbor(&chunks->lookup, index, face);
+				if (next == INVALID_BLOCK_INDEX) continue;
+
+				uint opposite = face ^ 1; // the light travels from 'next' towards this block
+				level = glm::max(level, light_through(get_light(chunks, next, channel), channel, opposite));
+			}
+		}
+
+		if (level > get_light(chunks, index, channel))
+		{
+			set_light(chunks, index, channel, level);
+			push_light(&chunks->light_adds, index, channel);
+		}
+	}
+}
+void update_light(Chunk_Loader* chunks, uint index) // after a single block has changed
+{
+	unlight_block(chunks, index);
+	unpropagate_light(chunks);
+	relight_block(chunks, index);
+	propagate_light(chunks);
+}
+
+void fill_sky_light(Chunk_Loader* chunks, uint blocks_index) // fresh chunk : every block above the ground sees the sky
+{
+	memset(chunks->light + (blocks_index * NUM_CHUNK_BLOCKS), 0, NUM_CHUNK_BLOCKS);
+
+	for (uint column = 0; column < CHUNK_X * CHUNK_Z; column++)
+	{
+		uint height = chunks->heights[COLUMN_INDEX(0, 0, blocks_index) + column];
+		for (uint y = height; y < CHUNK_Y; y++)
+			chunks->light[(blocks_index * NUM_CHUNK_BLOCKS) + column + (y * CHUNK_X * CHUNK_Z)] = MAX_LIGHT << 4;
+	}
+}
+void init_light(Chunk_Loader* chunks, uint blocks_index) // after fill_sky_light() was called for every new chunk
+{
+	Chunk_Lookup* lookup = &chunks->lookup;
+	u8* heights = chunks->heights;
+
+	for (uint z = 0; z < CHUNK_Z; z++) {
+	for (uint x = 0; x < CHUNK_X; x++)
+	{
+		// sunlight only spreads sideways where a neighboring column is taller (overhangs, caves, cliffs)
+		uint height = heights[COLUMN_INDEX(x, z, blocks_index)];
+		uint tallest = height;
+
+		for (uint face = FACE_POS_X; face <= FACE_NEG_Z; face++)
+		{
+			uint next = neighbor(lookup, BLOCK_INDEX(x, 0, z, blocks_index), face);
+			if (next != INVALID_BLOCK_INDEX) tallest = max(tallest, (uint)heights[column_of(next)]);
+		}
+
+		for (uint y = height; y < tallest; y++)
+			push_light(&chunks->light_adds, BLOCK_INDEX(x, y, z, blocks_index), LIGHT_SKY);
+
+		// light emitting blocks
+		for (uint y = 0; y < height; y++)
+		{
+			uint index = BLOCK_INDEX(x, y, z, blocks_index);
+			uint level = light_emitted(chunks->blocks[index]);
+			if (level == 0) continue;
+
+			set_light(chunks, index, LIGHT_BLOCK, level);
+			push_light(&chunks->light_adds, index, LIGHT_BLOCK);
+		}
+	} }
+
+	// light coming in from loaded chunks next to this one
+	for (uint face = FACE_POS_X; face <= FACE_NEG_Z; face++)
+	{
+		u16 next = lookup->neighbors[blocks_index][face];
+		if (next == INVALID) continue;
+
+		for (uint y = 0; y < CHUNK_Y; y++) {
+		for (uint i = 0; i < CHUNK_X; i++)
+		{
+			uint x = i, z = i;
+			switch (face)
+			{
+			case FACE_POS_X: x = 0; break;
+			case FACE_NEG_X: x = CHUNK_X - 1; break;
+			case FACE_POS_Z: z = 0; break;
+			case FACE_NEG_Z: z = CHUNK_Z - 1; break;
+			}
+
+			uint index = BLOCK_INDEX(x, y, z, next);
+			if (chunks->light[index] == 0) continue;
+			if (get_light(chunks, index, LIGHT_SKY  ) > 1) push_light(&chunks->light_adds, index, LIGHT_SKY);
+			if (get_light(chunks, index, LIGHT_BLOCK) > 1) push_light(&chunks->light_adds, index, LIGHT_BLOCK);
+		} }
+	}
+
+	propagate_light(chunks);
+}
+void rebuild_light(Chunk_Loader* chunks) // after a light queue overflowed, from scratch for every loaded chunk
+{
+	if (!chunks->light_adds.overflow && !chunks->light_removals.overflow) return;
+
+	// whatever is still queued is part of the light that is about to be thrown away
+	chunks->light_adds.head     = chunks->light_adds.tail     = 0;
+	chunks->light_removals.head = chunks->light_removals.tail = 0;
+	chunks->light_adds.overflow = chunks->light_removals.overflow = false;
+
+	for (uint i = 0; i < NUM_CHUNKS; i++) fill_sky_light(chunks, i);
+	for (uint i = 0; i < NUM_CHUNKS; i++) init_light(chunks, i);
+
+	if (chunks->light_adds.overflow) out("ERROR : the light queue overflowed while rebuilding the light");
+	chunks->light_adds.overflow = false;
+}
+
+// fluids : a cell's water level only depends on its neighbors, so when a cell changes, its neighbors
+// are queued & look at it on the next tick. water falls & spreads 1 block per tick.
+
+uint fluid_level(u16 block) // 0 = no water, MAX_FLOW_LEVEL + 1 = source
+{
+	if (block == BLOCK_WATER) return MAX_FLOW_LEVEL + 1;
+	if (is_fluid(block)) return (block - BLOCK_WATER_FLOW) + 1;
+	return 0;
+}
+u16 flow_block(uint level) // 0 = air
+{
+	return (level > 0) ? BLOCK_WATER_FLOW + (level - 1) : BLOCK_AIR;
+}
+
+void queue_fluid(Chunk_Loader* chunks, uint index)
+{
+	Fluid_Sim* sim = &chunks->fluids;
+
+	u8 bit = 1 << (index % 8);
+	if (sim->queued[index / 8] & bit) return;
+
+	Fluid_Queue* queue = sim->queues + chunks->lookup.tiers[index / NUM_CHUNK_BLOCKS];
+	if (queue->tail - queue->head >= FLUID_QUEUE_SIZE) return; // full : the next change next to this cell queues it again
+
+	sim->queued[index / 8] |= bit;
+	queue->cells[queue->tail++ & (FLUID_QUEUE_SIZE - 1)] = index;
+}
+uint pop_fluid(Chunk_Loader* chunks, Fluid_Queue* queue)
+{
+	uint index = queue->cells[queue->head++ & (FLUID_QUEUE_SIZE - 1)];
+	chunks->fluids.queued[index / 8] &= ~(1 << (index % 8));
+	return index;
+}
+void queue_fluid_neighbors(Chunk_Loader* chunks, uint index)
+{
+	for (uint face = 0; face < 6; face++)
+	{
+		uint next = neighbor(&chunks->lookup, index, face);
+		if (next != INVALID_BLOCK_INDEX && !is_solid(chunks->blocks[next])) queue_fluid(chunks, next);
+	}
+}
+void activate_fluids(Chunk_Loader* chunks, uint index) // after a block was changed by something other than the fluid sim
+{
+	// nothing can flow unless there is water right here
+	bool wet = is_fluid(chunks->blocks[index]);
+	for (uint face = 0; face < 6 && !wet; face++)
+	{
+		uint next = neighbor(&chunks->lookup, index, face);
+		wet = (next != INVALID_BLOCK_INDEX) && is_fluid(chunks->blocks[next]);
+	}
+
+	if (wet == false) return;
+
+	if (!is_solid(chunks->blocks[index])) queue_fluid(chunks, index);
+	queue_fluid_neighbors(chunks, index);
+}
+
+void update_fluid(Chunk_Loader* chunks, uint index)
+{
+	u16* blocks = chunks->blocks;
+	u16 block = blocks[index];
+	if (is_solid(block) || block == BLOCK_WATER) return; // only air & flowing water change
+
+	uint level = 0;
+
+	uint above = neighbor(&chunks->lookup, index, FACE_POS_Y);
+	if (above != INVALID_BLOCK_INDEX && is_fluid(blocks[above])) level = MAX_FLOW_LEVEL; // falling water
+
+	for (uint face = FACE_POS_X; face <= FACE_NEG_Z; face++)
+	{
+		uint next = neighbor(&chunks->lookup, index, face);
+		if (next == INVALID_BLOCK_INDEX) continue;
+
+		uint next_level = fluid_level(blocks[next]);
+		if (next_level <= level + 1) continue; // wouldn't raise this cell
+
+		// flowing water only spreads sideways once it can't fall any further, sources always do
+		uint below = neighbor(&chunks->lookup, next, FACE_NEG_Y);
+		bool landed = (below == INVALID_BLOCK_INDEX) || is_solid(blocks[below]) || blocks[below] == BLOCK_WATER;
+
+		if (landed || next_level == MAX_FLOW_LEVEL + 1) level = next_level - 1;
+	}
+
+	u16 new_block = flow_block(level);
+	if (new_block == block) return;
+
+	blocks[index] = new_block;
+	chunks->dirty[index / NUM_CHUNK_BLOCKS] = true;
+	queue_fluid_neighbors(chunks, index);
+}
+
+// flows the cells of one tier that were queued before this call. when the time budget (microseconds since
+// 'start') runs out, the rest stays queued for the next tick. returns the number of cells updated
+uint tick_fluids(Chunk_Loader* chunks, uint tier, Timestamp start, int64 budget)
+{
+	Fluid_Queue* queue = chunks->fluids.queues + tier;
+	uint count = queue->tail - queue->head; // cells queued during this tick wait for the next one
+
+	for (uint i = 0; i < count; i++)
+	{
+		if ((i % 64) == 63 && calculate_microseconds_elapsed(start, get_timestamp()) > budget) return i;
+		update_fluid(chunks, pop_fluid(chunks, queue));
+	}
+
+	return count;
+}
+void requeue_fluids(Chunk_Loader* chunks, bool* unloaded) // after the loaded chunks changed, cells may be in a different tier
+{
+	Fluid_Sim* sim = &chunks->fluids;
+
+	for (uint tier = 0; tier < NUM_TIERS; tier++)
+	{
+		Fluid_Queue* queue = sim->queues + tier;
+		uint count = queue->tail - queue->head;
+
+		for (uint i = 0; i < count; i++)
+		{
+			uint index = pop_fluid(chunks, queue);
+			if (unloaded[index / NUM_CHUNK_BLOCKS] == false) queue_fluid(chunks, index);
+		}
+	}
+}
+
 void update_chunks(Chunk_Loader* world, vec3 position)
 {
 	Chunk* old_chunks = world->loaded_chunks;
@@ -239,6 +1046,7 @@ void update_chunks(Chunk_Loader* world, vec3 position)
 	// keep track of block data that has been unloaded
 	uint num_free = 0;
 	u16 free_blocks[NUM_CHUNKS] = {};
+	bool unloaded[NUM_CHUNKS] = {}; // by blocks_index
 
 	// check for chunks that need to be unloaded
 	for (uint i = 0; i < NUM_CHUNKS; i++) // for each old chunk
@@ -260,6 +1068,7 @@ void update_chunks(Chunk_Loader* world, vec3 position)
 		{
 			// mark it as free
 			free_blocks[num_free++] = old_chunks[i].blocks_index;
+			unloaded[old_chunks[i].blocks_index] = true;
 
 			// unload the chunk data
 			unload_blocks(world->blocks, old_chunks[i].blocks_index);
@@ -267,6 +1076,9 @@ void update_chunks(Chunk_Loader* world, vec3 position)
 	}
 
 	// check for chunks that need to be generated / loaded from disk
+	uint num_generated = 0;
+	u16 generated[NUM_CHUNKS] = {};
+
 	for (uint i = 0; i < NUM_CHUNKS; i++) // for each new chunk
 	{
 		bool load = true;
@@ -285,7 +1097,10 @@ void update_chunks(Chunk_Loader* world, vec3 position)
 		if (load)
 		{
 			new_chunks.loaded[i].blocks_index = free_blocks[--num_free];
-			generate(new_chunks.loaded[i], world->blocks);
+			generate(new_chunks.loaded[i], world->blocks, world->seed);
+			update_columns(world, new_chunks.loaded[i].blocks_index);
+			world->dirty[new_chunks.loaded[i].blocks_index] = true;
+			generated[num_generated++] = new_chunks.loaded[i].blocks_index;
 			// TODO : check if it is on disk & load the changes if it is
 		}
 	}
@@ -294,61 +1109,111 @@ void update_chunks(Chunk_Loader* world, vec3 position)
 	for (uint i = 0; i < NUM_CHUNKS; i++)
 		old_chunks[i] = new_chunks.loaded[i];
 
+	update_lookup(world);
+
+	// light needs the neighbors, so it can only be done once all of them are in place
+	for (uint i = 0; i < num_generated; i++) fill_sky_light(world, generated[i]);
+	for (uint i = 0; i < num_generated; i++) init_light(world, generated[i]);
+	rebuild_light(world);
+
+	requeue_fluids(world, unloaded);
+
 	assert(num_free == 0);
 }
 
 // utilities
 
-void set_block(Chunk_Loader* chunks, vec3 pos, u16 new_block)
+uint find_block(Chunk_Lookup* lookup, ivec3 pos) // index into Chunk_Loader.blocks; works for any loaded chunk
 {
-	uint chunk_x = ((uint)pos.x) & 0xFFF0;
-	uint chunk_z = ((uint)pos.z) & 0xFFF0;
+	uint x = (uint)(pos.x - (int)lookup->x);
+	uint z = (uint)(pos.z - (int)lookup->z);
+	uint y = (uint)pos.y;
 
-	uint local_x = (uint)pos.x - chunk_x;
-	uint local_z = (uint)pos.z - chunk_z;
-	uint local_y = (uint)pos.y;
+	// negative offsets wrap around to huge numbers, so this also catches them
+	if (x >= LOADED_CHUNKS_WIDTH * CHUNK_X || z >= LOADED_CHUNKS_WIDTH * CHUNK_Z || y >= CHUNK_Y)
+		return INVALID_BLOCK_INDEX;
 
-	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++)
-	{
-		if (chunks->active[i].coords == uvec2(chunk_x, chunk_z))
-		{
-			chunks->blocks[BLOCK_INDEX(local_x, local_y, local_z, chunks->active[i].blocks_index)] = new_block;
-			return;
-		}
-	}
+	u16 blocks_index = lookup->blocks_index[(x / CHUNK_X) + ((z / CHUNK_Z) * LOADED_CHUNKS_WIDTH)];
+	if (blocks_index == INVALID) return INVALID_BLOCK_INDEX;
+
+	return BLOCK_INDEX(x % CHUNK_X, y, z % CHUNK_Z, blocks_index);
 }
-void set_block(Chunk_Loader* chunks, uvec3 coords, u16 new_block)
+u16 get_block(Chunk_Lookup* lookup, u16* blocks, ivec3 pos)
 {
-	uint chunk_x = coords.x & 0xFFF0;
-	uint chunk_z = coords.z & 0xFFF0;
+	uint index = find_block(lookup, pos);
+	return (index == INVALID_BLOCK_INDEX) ? INVALID : blocks[index];
+}
+u16 get_block(Chunk_Loader* chunks, vec3 pos)
+{
+	return get_block(&chunks->lookup, chunks->blocks, ivec3(floor(pos)));
+}
 
-	uint local_x = coords.x - chunk_x;
-	uint local_z = coords.z - chunk_z;
-	uint local_y = coords.y;
+uint find_column(Chunk_Lookup* lookup, int x, int z) // index into Chunk_Loader.heights / surface
+{
+	uint index = find_block(lookup, ivec3(x, 0, z));
+	return (index == INVALID_BLOCK_INDEX) ? INVALID_BLOCK_INDEX : column_of(index);
+}
+uint get_surface_height(Chunk_Lookup* lookup, u8* heights, int x, int z) // 0 if the column is not loaded (like get_block, unloaded = air)
+{
+	uint column = find_column(lookup, x, z);
+	return (column == INVALID_BLOCK_INDEX) ? 0 : heights[column];
+}
+uint get_surface_height(Chunk_Loader* chunks, int x, int z) // y of the first air block above the ground
+{
+	return get_surface_height(&chunks->lookup, chunks->heights, x, z);
+}
+u16 get_surface_block(Chunk_Loader* chunks, int x, int z)
+{
+	uint column = find_column(&chunks->lookup, x, z);
+	return (column == INVALID_BLOCK_INDEX) ? INVALID : chunks->surface[column];
+}
+void get_blocks(Chunk_Loader* chunks, vec3* positions, u16* results, uint count) // batched get_block
+{
+	Chunk_Lookup lookup = chunks->lookup; // local copy so it stays in registers / L1
 
-	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++)
-	{
-		if (chunks->active[i].coords == uvec2(chunk_x, chunk_z))
-		{
-			chunks->blocks[BLOCK_INDEX(local_x, local_y, local_z, chunks->active[i].blocks_index)] = new_block;
-			return;
-		}
-	}
+	for (uint i = 0; i < count; i++)
+		results[i] = get_block(&lookup, chunks->blocks, ivec3(floor(positions[i])));
 }
-u16 get_block(Chunk_Loader* chunks, vec3 pos)
+
+void log_entity_change(Chunk_Loader* chunks, ivec3 pos, u16 old_block, u16 new_block)
 {
-	uint chunk_x = ((uint)pos.x) & 0xFFF0;
-	uint chunk_z = ((uint)pos.z) & 0xFFF0;
+	if (block_entity_type(old_block) == ENTITY_NONE && block_entity_type(new_block) == ENTITY_NONE) return;
 
-	uint local_x = (uint)pos.x - chunk_x;
-	uint local_z = (uint)pos.z - chunk_z;
-	uint local_y = (uint)pos.y;
+	Entity_Log* log = &chunks->entity_log;
+	if (log->count < ENTITY_LOG_SIZE)
+		log->positions[log->count++] = pos;
+	else
+		log->overflow = true;
+}
 
-	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++)
-		if (chunks->active[i].coords == uvec2(chunk_x, chunk_z))
-			return chunks->blocks[BLOCK_INDEX(local_x, local_y, local_z, chunks->active[i].blocks_index)];
+void set_block(Chunk_Loader* chunks, ivec3 pos, u16 new_block)
+{
+	uint index = find_block(&chunks->lookup, pos);
+	if (index == INVALID_BLOCK_INDEX) return;
 
-	return INVALID;
+	log_entity_change(chunks, pos, chunks->blocks[index], new_block);
+	chunks->blocks[index] = new_block;
+	update_column(chunks, index, new_block);
+
+	// the culling & ao of the blocks next to this one changed too, they may be in another chunk
+	for (int dx = -1; dx <= 1; dx++) {
+	for (int dz = -1; dz <= 1; dz++)
+	{
+		uint next = find_block(&chunks->lookup, pos + ivec3(dx, 0, dz));
+		if (next != INVALID_BLOCK_INDEX) chunks->dirty[next / NUM_CHUNK_BLOCKS] = true;
+	} }
+
+	update_light(chunks, index);
+	rebuild_light(chunks);
+	activate_fluids(chunks, index);
+}
+void set_block(Chunk_Loader* chunks, vec3 pos, u16 new_block)
+{
+	set_block(chunks, ivec3(floor(pos)), new_block);
+}
+void set_block(Chunk_Loader* chunks, uvec3 coords, u16 new_block)
+{
+	set_block(chunks, ivec3(coords), new_block);
 }
 u16 get_block_raycast(Chunk_Loader* chunks, vec3 pos, vec3 dir)
 {
@@ -447,58 +1312,393 @@ uvec3 get_place_pos_raycast(Chunk_Loader* chunks, vec3 pos, vec3 dir)
 	return uvec3(INVALID);
 }
 
-void fill_sphere(Chunk_Loader* chunks, vec3 sphere_pos, float radius = 2, u16 block = BLOCK_AIR)
+// block editing : edits are collected in a batch and applied together so every
+// touched chunk is only visited (and marked for remeshing) once per batch
+
+#define EDIT_BOX      1
+#define EDIT_SPHERE   2
+#define EDIT_CYLINDER 3
+
+#define MAX_BLOCK_EDITS 64
+
+struct Block_Edit
 {
-	uint chunk_x = (uint)sphere_pos.x & 0xFFF0;
-	uint chunk_z = (uint)sphere_pos.z & 0xFFF0;
+	uint shape;
+	u16 block;
+	vec3 position; // box : min corner | sphere : center | cylinder : center of the base
+	vec3 size;     // box : dimensions | sphere : x = radius | cylinder : x = radius, y = height
+};
 
-	vec3 local_sphere_pos = sphere_pos - vec3(chunk_x, 0, chunk_z) - vec3(.5);
+struct Edit_Batch
+{
+	uint num_edits;
+	Block_Edit edits[MAX_BLOCK_EDITS];
+};
 
-	for (uint x = 0; x < CHUNK_X; ++x) {
-	for (uint z = 0; z < CHUNK_Z; ++z) {
-	for (uint y = 0; y < CHUNK_Y; ++y)
+struct Block_Region // the part of an area that falls inside one loaded chunk
+{
+	u16 blocks_index;
+	ivec3 origin;   // block coordinates of the chunk corner
+	ivec3 min, max; // local block coordinates (inclusive)
+};
+
+void add_edit(Edit_Batch* batch, Block_Edit edit)
+{
+	if (batch->num_edits >= MAX_BLOCK_EDITS) { out("too many block edits in one batch!"); return; }
+	batch->edits[batch->num_edits++] = edit;
+}
+void add_box(Edit_Batch* batch, ivec3 min, ivec3 max, u16 block) // min & max are inclusive
+{
+	add_edit(batch, { EDIT_BOX, block, vec3(min), vec3(max - min + ivec3(1)) });
+}
+void add_sphere(Edit_Batch* batch, vec3 center, float radius, u16 block)
+{
+	add_edit(batch, { EDIT_SPHERE, block, center, vec3(radius, 0, 0) });
+}
+void add_cylinder(Edit_Batch* batch, vec3 base, float radius, float height, u16 block)
+{
+	add_edit(batch, { EDIT_CYLINDER, block, base, vec3(radius, height, 0) });
+}
+
+void get_bounds(Block_Edit edit, ivec3* min, ivec3* max)
+{
+	vec3 lo = edit.position, hi = edit.position;
+
+	switch (edit.shape)
 	{
-		if (length(vec3(x, y, z) - local_sphere_pos) < radius)
-			set_block(chunks, vec3(x, y, z) + vec3(chunk_x, 0, chunk_z), block);
-	} } }
+	case EDIT_BOX     : { hi = edit.position + edit.size - vec3(1); } break;
+	case EDIT_SPHERE  : { lo -= vec3(edit.size.x); hi += vec3(edit.size.x); } break;
+	case EDIT_CYLINDER: {
+		lo -= vec3(edit.size.x, 0, edit.size.x);
+		hi += vec3(edit.size.x, edit.size.y, edit.size.x);
+	} break;
+	}
+
+	*min = ivec3(floor(lo));
+	*max = ivec3(floor(hi));
+}
+bool inside(Block_Edit edit, vec3 block_center)
+{
+	vec3 d = block_center - edit.position;
+
+	switch (edit.shape)
+	{
+	case EDIT_BOX     : return true; // the region already is the box
+	case EDIT_SPHERE  : return dot(d, d) < edit.size.x * edit.size.x;
+	case EDIT_CYLINDER: return (d.x * d.x) + (d.z * d.z) < edit.size.x * edit.size.x && d.y >= 0 && d.y < edit.size.y;
+	}
+
+	return false;
+}
+
+// splits an area into the pieces that lie in loaded chunks, returns the number of pieces
+uint get_regions(Chunk_Lookup* lookup, ivec3 min, ivec3 max, Block_Region* regions)
+{
+	min.y = glm::max(min.y, 0);
+	max.y = glm::min(max.y, CHUNK_Y - 1);
+	if (min.y > max.y) return 0;
+
+	// chunk range of the area relative to the loaded square (clamped to it)
+	int lx0 = glm::max(0, (int)floor((min.x - (int)lookup->x) / (float)CHUNK_X));
+	int lz0 = glm::max(0, (int)floor((min.z - (int)lookup->z) / (float)CHUNK_Z));
+	int lx1 = glm::min(LOADED_CHUNKS_WIDTH - 1, (int)floor((max.x - (int)lookup->x) / (float)CHUNK_X));
+	int lz1 = glm::min(LOADED_CHUNKS_WIDTH - 1, (int)floor((max.z - (int)lookup->z) / (float)CHUNK_Z));
+
+	uint num_regions = 0;
+	for (int lx = lx0; lx <= lx1; lx++) {
+	for (int lz = lz0; lz <= lz1; lz++)
+	{
+		u16 blocks_index = lookup->blocks_index[lx + (lz * LOADED_CHUNKS_WIDTH)];
+		if (blocks_index == INVALID) continue;
+
+		Block_Region* region = regions + num_regions++;
+		region->blocks_index = blocks_index;
+		region->origin = ivec3((int)lookup->x + (lx * CHUNK_X), 0, (int)lookup->z + (lz * CHUNK_Z));
+		region->min = glm::max(min - region->origin, ivec3(0));
+		region->max = glm::min(max - region->origin, ivec3(CHUNK_X - 1, CHUNK_Y - 1, CHUNK_Z - 1));
+	} }
+
+	return num_regions;
+}
+
+void apply(Edit_Batch* batch, Chunk_Loader* chunks) // empties the batch
+{
+	Block_Region regions[NUM_CHUNKS];
+
+	for (uint e = 0; e < batch->num_edits; e++)
+	{
+		Block_Edit edit = batch->edits[e];
+
+		ivec3 min, max;
+		get_bounds(edit, &min, &max);
+
+		// remesh every chunk that touches the edit or is next to it (culling & ao look 1 block past the edit)
+		uint num_regions = get_regions(&chunks->lookup, min - ivec3(1, 0, 1), max + ivec3(1, 0, 1), regions);
+		for (uint r = 0; r < num_regions; r++)
+			chunks->dirty[regions[r].blocks_index] = true;
+
+		num_regions = get_regions(&chunks->lookup, min, max, regions);
+
+		for (uint r = 0; r < num_regions; r++)
+		{
+			Block_Region region = regions[r];
+
+			for (int y = region.min.y; y <= region.max.y; y++) {
+			for (int z = region.min.z; z <= region.max.z; z++) {
+			for (int x = region.min.x; x <= region.max.x; x++)
+			{
+				uint index = BLOCK_INDEX(x, y, z, region.blocks_index);
+				if (chunks->blocks[index] == edit.block) continue;
+
+				if (inside(edit, vec3(region.origin + ivec3(x, y, z)) + vec3(.5)))
+				{
+					log_entity_change(chunks, region.origin + ivec3(x, y, z), chunks->blocks[index], edit.block);
+					chunks->blocks[index] = edit.block;
+					unlight_block(chunks, index);
+				}
+			} } }
+
+			// relight the region in one go (a region is at most one chunk, the light queues can almost always hold it)
+			unpropagate_light(chunks);
+
+			for (int y = region.min.y; y <= region.max.y; y++) {
+			for (int z = region.min.z; z <= region.max.z; z++) {
+			for (int x = region.min.x; x <= region.max.x; x++)
+			{
+				uint index = BLOCK_INDEX(x, y, z, region.blocks_index);
+				if (chunks->blocks[index] == edit.block && inside(edit, vec3(region.origin + ivec3(x, y, z)) + vec3(.5)))
+				{
+					relight_block(chunks, index);
+					activate_fluids(chunks, index);
+				}
+			} } }
+
+			propagate_light(chunks);
+
+			// rescan the touched columns, starting at whichever is higher : the edit or the old surface
+			for (int z = region.min.z; z <= region.max.z; z++) {
+			for (int x = region.min.x; x <= region.max.x; x++)
+			{
+				uint column = COLUMN_INDEX(x, z, region.blocks_index);
+				scan_column(chunks, column, glm::max(region.max.y, chunks->heights[column] - 1));
+			} }
+		}
+	}
+
+	rebuild_light(chunks); // only does something if a region was too much for the light queues
+	batch->num_edits = 0;
+}
+
+void fill_sphere(Chunk_Loader* chunks, vec3 sphere_pos, float radius = 2, u16 block = BLOCK_AIR)
+{
+	Edit_Batch batch = {};
+	add_sphere(&batch, sphere_pos, radius, block);
+	apply(&batch, chunks);
 }
 void spawn_tree(Chunk_Loader* chunks, vec3 pos)
 {
-	// trunk
-	for (uint i = 0; i < 7; i++)
-		set_block(chunks, pos + vec3(0, i, 0), BLOCK_WOOD);
+	ivec3 base = ivec3(floor(pos));
 
-	// leaves
-	fill_sphere(chunks, pos + vec3(0, 6, 0), 3, BLOCK_GRASS);
+	Edit_Batch batch = {};
+	add_box(&batch, base, base + ivec3(0, 6, 0), BLOCK_WOOD); // trunk
+	add_sphere(&batch, pos + vec3(0, 6, 0), 3, BLOCK_GRASS);  // leaves
+	apply(&batch, chunks);
+}
+
+// particle collision
+
+// like update(Particle_Emitter*) but debris, sparks & blood bounce off of blocks
+void update(Particle_Emitter* emitter, Chunk_Loader* chunks, float dtime, vec3 wind = vec3(0))
+{
+	Particle* particles = emitter->particles;
+	u16* colliders = emitter->colliders;
+
+	uint num_colliders = 0;
+
+	for (uint i = 0; i < MAX_PARTICLES; i++)
+	{
+		if (particles[i].type == NULL || particles[i].time_alive >= particles[i].max_age)
+		{
+			particles[i] = {};
+			continue;
+		}
+
+		apply_forces(particles + i, dtime);
+		particles[i].time_alive += dtime;
+
+		if (particle_collides(particles[i].type))
+			colliders[num_colliders++] = i;
+		else
+			particles[i].position += (particles[i].velocity + wind) * dtime;
+	}
+
+	// sweep one axis at a time so particles slide along surfaces instead of sticking to them
+	vec3* test_points = emitter->test_points;
+	u16*  test_blocks = emitter->test_blocks;
+
+	for (uint axis = 0; axis < 3; axis++)
+	{
+		for (uint i = 0; i < num_colliders; i++)
+		{
+			Particle* particle = particles + colliders[i];
+			test_points[i] = particle->position;
+			test_points[i][axis] += (particle->velocity[axis] + wind[axis]) * dtime;
+		}
+
+		get_blocks(chunks, test_points, test_blocks, num_colliders);
+
+		for (uint i = 0; i < num_colliders; i++)
+		{
+			Particle* particle = particles + colliders[i];
+
+			if (is_solid(test_blocks[i]) == false)
+			{
+				particle->position[axis] = test_points[i][axis];
+				continue;
+			}
+
+			particle->velocity[axis] *= -particle_bounciness(particle->type);
+
+			if (axis == 1) // hit the floor (or ceiling) : friction & settling
+			{
+				particle->velocity.x *= .5f;
+				particle->velocity.z *= .5f;
+				if (abs(particle->velocity.y) < .5f) particle->velocity.y = 0;
+			}
+		}
+	}
 }
 
 // rendering
 
-struct Solid_Drawable { vec3 position; float tex_offset; };
+struct Solid_Drawable
+{
+	vec3 position;
+	uint block; // row of the material table, see Block_Textures
+	uint light[2]; // light of the block in front of each face, 8 bits per face
+	uint ao[2];    // ambient occlusion of each face's 4 corners, 2 bits per corner (3 = not occluded)
+};
 struct Fluid_Drawable { vec3 position; };
 
+// the blocks of a chunk + a 1 block apron from the chunks around it, 1 = solid
+#define MESH_GRID_X (CHUNK_X + 2)
+#define MESH_GRID_Z (CHUNK_Z + 2)
+#define MESH_GRID_Y (CHUNK_Y + 2)
+#define MESH_INDEX(x,y,z) (((x) + 1) + (MESH_GRID_X * ((z) + 1)) + ((MESH_GRID_X * MESH_GRID_Z) * ((y) + 1)))
+
 struct Chunk_Renderer
 {
+	uint64 chunk_id; // chunk that is currently meshed
 	uint num_solids, num_fluids;
 
 	Solid_Drawable solids[NUM_CHUNK_BLOCKS];
 	Fluid_Drawable fluids[NUM_CHUNK_BLOCKS];
+	u8 solid_grid[MESH_GRID_X * MESH_GRID_Y * MESH_GRID_Z];
 
 	Drawable_Mesh_UV solid_mesh;
 	Drawable_Mesh fluid_mesh;
 };
 
+// ambient occlusion : each corner of a face is darkened by the 2 sides & 1 corner block touching it,
+// in the layer of blocks in front of the face. those 8 blocks form an index into a table with all 4 corners.
+
+u8  ao_table[256];    // 8 bit mask of blocks in front of a face -> 4 corners * 2 bits
+int ao_offsets[6][8]; // [face][bit] -> offset from a block's MESH_INDEX
+
+void init_ao_tables()
+{
+	// the 2 axes along each face, corner (u, v) of a face is vertex (u + 2v) in solid.vert
+	const ivec3 FACE_U[6]    = { ivec3(0,0,1), ivec3( 0,0,1), ivec3(1,0,0), ivec3( 1,0, 0), ivec3(1,0,0), ivec3( 1, 0,0) };
+	const ivec3 FACE_V[6]    = { ivec3(0,1,0), ivec3( 0,1,0), ivec3(0,1,0), ivec3( 0,1, 0), ivec3(0,0,1), ivec3( 0, 0,1) };
+
+	// bit order of the 8 blocks around the block in front of a face
+	const ivec2 AROUND[8] = { ivec2(-1,-1), ivec2(0,-1), ivec2(1,-1), ivec2(-1,0), ivec2(1,0), ivec2(-1,1), ivec2(0,1), ivec2(1,1) };
+
+	for (uint face = 0; face < 6; face++) {
+	for (uint bit = 0; bit < 8; bit++)
+	{
+		ivec3 p = FACE_DIRS[face] + (FACE_U[face] * AROUND[bit].x) + (FACE_V[face] * AROUND[bit].y);
+		ao_offsets[face][bit] = MESH_INDEX(p.x, p.y, p.z) - MESH_INDEX(0, 0, 0);
+	} }
+
+	for (uint mask = 0; mask < 256; mask++)
+	{
+		ao_table[mask] = 0;
+
+		for (uint corner = 0; corner < 4; corner++)
+		{
+			int u = (corner & 1) ? 1 : -1;
+			int v = (corner & 2) ? 1 : -1;
+
+			uint side_1 = 0, side_2 = 0, diagonal = 0;
+			for (uint bit = 0; bit < 8; bit++)
+			{
+				if ((mask & (1 << bit)) == 0) continue;
+				if (AROUND[bit] == ivec2(u, 0)) side_1   = 1;
+				if (AROUND[bit] == ivec2(0, v)) side_2   = 1;
+				if (AROUND[bit] == ivec2(u, v)) diagonal = 1;
+			}
+
+			uint ao = (side_1 && side_2) ? 0 : 3 - (side_1 + side_2 + diagonal);
+			ao_table[mask] |= ao << (corner * 2);
+		}
+	}
+}
+
 void init(Chunk_Renderer* renderer)
 {
 	load(&renderer->solid_mesh, "assets/meshes/block.mesh_uv", sizeof(renderer->solids));
 	mesh_add_attrib_vec3 (3, sizeof(Solid_Drawable), 0); // world pos
-	mesh_add_attrib_float(4, sizeof(Solid_Drawable), sizeof(vec3)); // tex coord
+	mesh_add_attrib_uint (4, sizeof(Solid_Drawable), offsetof(Solid_Drawable, block)); // block
+	mesh_add_attrib_uvec2(5, sizeof(Solid_Drawable), offsetof(Solid_Drawable, light)); // face light
+	mesh_add_attrib_uvec2(6, sizeof(Solid_Drawable), offsetof(Solid_Drawable, ao)); // corner ao
 
 	load(&renderer->fluid_mesh, "assets/meshes/fluid.mesh", sizeof(renderer->fluids));
 	mesh_add_attrib_vec3(2, sizeof(Fluid_Drawable), 0); // world pos
+
+	init_ao_tables();
 }
-void update(Chunk_Renderer* renderer, Chunk chunk, u16* blocks)
+void update_solid_grid(Chunk_Renderer* renderer, Chunk chunk, Chunk_Loader* chunks)
 {
+	u8*  grid   = renderer->solid_grid; // the layers above & below the chunk are never written, so they stay 0
+	u16* blocks = chunks->blocks;
+	u16* neighbors = chunks->lookup.neighbors[chunk.blocks_index];
+
+	for (int y = 0; y < CHUNK_Y; y++)
+	{
+		for (int z = 0; z < CHUNK_Z; z++) {
+		for (int x = 0; x < CHUNK_X; x++)
+		{
+			grid[MESH_INDEX(x, y, z)] = is_solid(blocks[BLOCK_INDEX(x, y, z, chunk.blocks_index)]);
+		} }
+
+		// the apron, unloaded chunks count as air
+		for (int i = 0; i < CHUNK_X; i++)
+		{
+			u16 n;
+			n = neighbors[FACE_POS_X]; grid[MESH_INDEX(CHUNK_X, y, i)] = (n != INVALID) && is_solid(blocks[BLOCK_INDEX(0, y, i, n)]);
+			n = neighbors[FACE_NEG_X]; grid[MESH_INDEX(-1     , y, i)] = (n != INVALID) && is_solid(blocks[BLOCK_INDEX(CHUNK_X - 1, y, i, n)]);
+			n = neighbors[FACE_POS_Z]; grid[MESH_INDEX(i, y, CHUNK_Z)] = (n != INVALID) && is_solid(blocks[BLOCK_INDEX(i, y, 0, n)]);
+			n = neighbors[FACE_NEG_Z]; grid[MESH_INDEX(i, y, -1     )] = (n != INVALID) && is_solid(blocks[BLOCK_INDEX(i, y, CHUNK_Z - 1, n)]);
+		}
+
+		// corners of the apron are in the diagonal chunks
+		ivec3 origin = ivec3(chunk.x, y, chunk.z);
+		grid[MESH_INDEX(-1     , y, -1     )] = is_solid(get_block(&chunks->lookup, blocks, origin + ivec3(-1     , 0, -1     )));
+		grid[MESH_INDEX(CHUNK_X, y, -1     )] = is_solid(get_block(&chunks->lookup, blocks, origin + ivec3(CHUNK_X, 0, -1     )));
+		grid[MESH_INDEX(-1     , y, CHUNK_Z)] = is_solid(get_block(&chunks->lookup, blocks, origin + ivec3(-1     , 0, CHUNK_Z)));
+		grid[MESH_INDEX(CHUNK_X, y, CHUNK_Z)] = is_solid(get_block(&chunks->lookup, blocks, origin + ivec3(CHUNK_X, 0, CHUNK_Z)));
+	}
+}
+void update(Chunk_Renderer* renderer, Chunk chunk, Chunk_Loader* chunks)
+{
+	u16* blocks = chunks->blocks;
+	u8*  grid   = renderer->solid_grid;
+
+	update_solid_grid(renderer, chunk, chunks);
+
+	const int FRONT[6] = { 1, -1, MESH_GRID_X, -MESH_GRID_X, MESH_GRID_X * MESH_GRID_Z, -(MESH_GRID_X * MESH_GRID_Z) };
+
 	Solid_Drawable* solid_mem = renderer->solids;
 	Fluid_Drawable* fluid_mem = renderer->fluids;
 
@@ -509,33 +1709,21 @@ void update(Chunk_Renderer* renderer, Chunk chunk, u16* blocks)
 	for (uint y = 0; y < CHUNK_Y; ++y)
 	{
 		uint index = BLOCK_INDEX(x, y, z, chunk.blocks_index);
+		uint g = MESH_INDEX(x, y, z);
 
 		// if block is surrounded, don't draw it
-		if (y > 0 && x > 0 && z > 0 && y < 255 && x < 15 && z < 15)
+		if (grid[g + 1] && grid[g - 1] && grid[g + FRONT[FACE_POS_Z]] && grid[g + FRONT[FACE_NEG_Z]]
+			&& grid[g + FRONT[FACE_POS_Y]] && grid[g + FRONT[FACE_NEG_Y]])
 		{
-			if (  blocks[index + 1]   >= BLOCK_WATER || blocks[index - 1]   >= BLOCK_WATER
-				|| blocks[index + 16]  >= BLOCK_WATER || blocks[index - 16]  >= BLOCK_WATER
-				|| blocks[index + 256] >= BLOCK_WATER || blocks[index - 256] >= BLOCK_WATER)
-			{
-				goto draw_block;
-			}
-		
-			if (blocks[index + 1] && blocks[index - 1]
-				&& blocks[index + 16] && blocks[index - 16]
-				&& blocks[index + 256] && blocks[index - 256])
-			{
-				continue;
-			}
+			continue;
 		}
-		
-		draw_block:
 
 		u16 block = blocks[index];
 		if (block == BLOCK_AIR) continue; // only store block data for non-air
 		
 		uint block_type = 1;
 		if      (block <  BLOCK_WATER) block_type = 1; // solid
-		else if (block == BLOCK_WATER) block_type = 2; // fluid
+		else if (is_fluid(block))      block_type = 2; // fluid
 		else continue;
 		
 		vec3 position = vec3(x, y, z) + vec3(chunk.x, 0, chunk.z);
@@ -544,12 +1732,41 @@ void update(Chunk_Renderer* renderer, Chunk chunk, u16* blocks)
 		{
 		case 1: {
 			solid_mem->position = position;
-			solid_mem->tex_offset = (float)(block - 1) * (1 / 16.f);
+			solid_mem->block = block;
+			solid_mem->light[0] = solid_mem->light[1] = 0;
+			solid_mem->ao[0] = solid_mem->ao[1] = 0xFFFFFFFF;
+
+			for (uint face = 0; face < 6; face++)
+			{
+				if (grid[g + FRONT[face]]) continue; // hidden face
+
+				uint next = neighbor(&chunks->lookup, index, face);
+
+				// outside the loaded world : only the sky above & darkness below
+				u8 light = (next != INVALID_BLOCK_INDEX) ? chunks->light[next] : (face == FACE_NEG_Y) ? 0 : MAX_LIGHT << 4;
+				solid_mem->light[face / 4] |= light << ((face % 4) * 8);
+
+				uint mask = 0;
+				for (uint bit = 0; bit < 8; bit++)
+					mask |= grid[g + ao_offsets[face][bit]] << bit;
+
+				uint shift = (face % 4) * 8;
+				solid_mem->ao[face / 4] = (solid_mem->ao[face / 4] & ~(0xFF << shift)) | (ao_table[mask] << shift);
+			}
+
 			solid_mem++;
 			num_solids++;
 		} break;
 
 		case 2: {
+			bool hidden = true; // under the surface of a sea, nothing can see it
+			for (uint face = 0; face < 6 && hidden; face++)
+			{
+				uint next = neighbor(&chunks->lookup, index, face);
+				hidden = (next != INVALID_BLOCK_INDEX) && blocks[next] != BLOCK_AIR;
+			}
+			if (hidden) continue;
+
 			fluid_mem->position = position;
 			fluid_mem++;
 			num_fluids++;
@@ -557,6 +1774,7 @@ void update(Chunk_Renderer* renderer, Chunk chunk, u16* blocks)
 		}
 	} } }
 
+	renderer->chunk_id   = chunk.id;
 	renderer->num_solids = num_solids;
 	renderer->num_fluids = num_fluids;
 	update(renderer->solid_mesh, num_solids * sizeof(Solid_Drawable), (byte*)renderer->solids);
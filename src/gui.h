@@ -42,17 +42,6 @@ bool mouse_in_quad(Icon_Drawable quad, Mouse mouse)
 	if (mouse.norm_y > quad.position.y + quad.scale.y) return false;
 	return true;
 }
-int gui_item_index(Icon_Drawable* icons, Mouse mouse, int selected_index = -1)
-{
-	for (int i = 0; i < NUM_PLAYER_ITEMS; i++)
-	{
-		// icons are in the order : [hotbar][backpack][interactable(chest, furnace, etc.)]
-		if (mouse_in_quad(icons[i], mouse) && i != selected_index)
-			return i;
-	}
-
-	return -1;
-}
 
 #define GUI_INVENTORY	1
 #define GUI_FURNACE		2
@@ -61,76 +50,110 @@ int gui_item_index(Icon_Drawable* icons, Mouse mouse, int selected_index = -1)
 #define GUI_CRAFTING		5
 #define GUI_RECYCLER		6
 
-struct GUI_Renderer
+#define NUM_GUI_SCREENS	7 // 0 = just the HUD
+
+// texture coordinates of an item
+vec2 icon_tex(u16 id) { u16 m = id % 16; return vec2(m / 16.f, (id - m) / 16.f); }
+
+// retained GUI : each screen's quads & icons are laid out once. every frame only the icons whose item changed
+// & the dragged icon are patched, & only that range of the icon buffer is uploaded. nothing changing = no uploads
+
+// every icon shows a slot : player items are slots 0 .. NUM_PLAYER_ITEMS, whatever is open (chest, crafting
+// grid, etc.) comes after them. the mouse is mapped to a slot through a grid over the screen
+#define MAX_GUI_SLOTS	(NUM_PLAYER_ITEMS + 64)
+#define GUI_GRID_CELLS	32 // hit test cells per axis, covering -1 .. 1
+#define MAX_GUI_HITS	(MAX_GUI_QUADS * 16) // an icon can touch up to 16 cells
+
+struct GUI_Layout
 {
+	uint num_quads, num_icons;
 	Quad_Drawable quads[MAX_GUI_QUADS];
-	Icon_Drawable icons[MAX_GUI_QUADS];
-	Drawable_Mesh_2D quad_mesh;
-	Drawable_Mesh_2D_UV icon_mesh;
-	Shader quad_shader, icon_shader;
-	GLuint texture;
+	Icon_Drawable icons[MAX_GUI_QUADS]; // texture offsets are filled in from the items shown
+	u16 slots[MAX_GUI_QUADS]; // slot each icon shows
+	u16 slot_icons[MAX_GUI_SLOTS]; // icon showing each slot, INVALID if it isn't shown
+
+	// icons touching cell c are cell_icons[cell_start[c] .. cell_start[c + 1]], in icon order
+	u16 cell_start[(GUI_GRID_CELLS * GUI_GRID_CELLS) + 1];
+	u8 cell_icons[MAX_GUI_HITS];
 };
 
-void init(GUI_Renderer* renderer)
+ivec2 gui_grid_coords(vec2 position)
 {
-	init(&renderer->quad_mesh, MAX_GUI_QUADS * sizeof(Quad_Drawable));
-	mesh_add_attrib_vec2(1, sizeof(Quad_Drawable), 0 * sizeof(vec2)); // position
-	mesh_add_attrib_vec2(2, sizeof(Quad_Drawable), 1 * sizeof(vec2)); // scale
-	mesh_add_attrib_vec3(3, sizeof(Quad_Drawable), 2 * sizeof(vec2)); // color
+	ivec2 coords = ivec2(floor((position + 1.f) * (GUI_GRID_CELLS / 2.f)));
+	return glm::clamp(coords, ivec2(0), ivec2(GUI_GRID_CELLS - 1));
+}
+void update_grid(GUI_Layout* layout)
+{
+	u16* cell_start = layout->cell_start;
+	memset(cell_start, 0, sizeof(layout->cell_start));
 
-	init(&renderer->icon_mesh, MAX_GUI_QUADS * sizeof(Icon_Drawable), {}, vec2(1.f / 16));
-	mesh_add_attrib_vec2(2, sizeof(Icon_Drawable), 0 * sizeof(vec2)); // position
-	mesh_add_attrib_vec2(3, sizeof(Icon_Drawable), 1 * sizeof(vec2)); // scale
-	mesh_add_attrib_vec2(4, sizeof(Icon_Drawable), 2 * sizeof(vec2)); // texture offset
+	for (uint i = 0; i < layout->num_icons; i++)
+	{
+		ivec2 min = gui_grid_coords(layout->icons[i].position - layout->icons[i].scale);
+		ivec2 max = gui_grid_coords(layout->icons[i].position + layout->icons[i].scale);
 
-	renderer->texture = load_texture("assets/textures/icons.bmp", false);
-	load(&renderer->quad_shader, "assets/shaders/mesh_2D.vert"   , "assets/shaders/mesh_2D.frag"   );
-	load(&renderer->icon_shader, "assets/shaders/mesh_2D_UV.vert", "assets/shaders/mesh_2D_UV.frag");
+		for (int y = min.y; y <= max.y; y++)
+		for (int x = min.x; x <= max.x; x++)
+			cell_start[x + (y * GUI_GRID_CELLS)]++;
+	}
+
+	// running total : cell_start[c] = end of cell c
+	for (uint c = 1; c <= GUI_GRID_CELLS * GUI_GRID_CELLS; c++)
+		cell_start[c] += cell_start[c - 1];
+
+	// filling each cell from the back leaves cell_start[c] = start of cell c
+	for (uint i = layout->num_icons; i-- > 0;)
+	{
+		ivec2 min = gui_grid_coords(layout->icons[i].position - layout->icons[i].scale);
+		ivec2 max = gui_grid_coords(layout->icons[i].position + layout->icons[i].scale);
+
+		for (int y = min.y; y <= max.y; y++)
+		for (int x = min.x; x <= max.x; x++)
+			layout->cell_icons[--cell_start[x + (y * GUI_GRID_CELLS)]] = i;
+	}
 }
-void update(GUI_Renderer* renderer, Mouse mouse, Item* player_items, uint screen = 1, int selected_index = -1, Item* items = NULL)
-{
-	// screen = which GUI should be displayed : inventory, crafting table, furnace, etc.
-	// selected_index : item the player has equipped : -1 = none, 3 = 4th inventory slot, 
-	//                                                 > NUM_PLAYER_INVENTORY_ITEMS = item is not on the player
-	// items = items for whatever the player is interacting with(eg. chest); NULL = nothing open
-	// player_items : player inventory
 
+void init(GUI_Layout* layout, uint screen)
+{
 	// Warning : this system is a first draft, it relies on alot of obscure details
-	// The order in which icons are added to the render buffer matters, see get_item_index for more information
-
-	ZeroMemory(renderer->quads, sizeof(renderer->quads));
-	ZeroMemory(renderer->icons, sizeof(renderer->icons));
+	// The order in which icons are added to the render buffer matters, see gui_item_index for more information
 
 	uint num_quads = 0, num_icons = 0;
+	Quad_Drawable* quads = layout->quads;
+	Icon_Drawable* icons = layout->icons;
+	u16* slots = layout->slots;
 
 	vec2 scale = vec2(.3, .5); // makes a square in a 16:9 screen (i think)
 	vec3 color = vec3(.1);
 
-	// texture coordinates of an item
-	auto tex = [](u16 block) {u16 m = block % 16; return vec2(m / 16.f, (block - m) / 16.f); };
-
 	// --- icons --- //
-	
+
 	// hotbar
 	for (uint i = 0; i < NUM_HOTBAR_ITEMS; i++)
-		renderer->icons[num_icons++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f, tex(player_items[i].id) };
+	{
+		slots[num_icons] = i;
+		icons[num_icons++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f };
+	}
 
 	if (screen) // inventory
 		for (uint i = 0, n = 0; i < 12; i++)
 		for (uint j = 3; j < 6; j++)
-			renderer->icons[num_icons++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f, tex(player_items[NUM_HOTBAR_ITEMS + n++].id) };
+		{
+			slots[num_icons] = NUM_HOTBAR_ITEMS + n++;
+			icons[num_icons++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f };
+		}
 
 	// --- quads --- //
-	
+
 	// hotbar selected item
-	renderer->quads[num_quads++] = { vec2(-.66 + (0 * .12), -.799), scale / 5.6f, vec3(.3) };
+	quads[num_quads++] = { vec2(-.66 + (0 * .12), -.799), scale / 5.6f, vec3(.3) };
 
 	// hotbar item frames
 	for (uint i = 0; i < 12; i++)
-		renderer->quads[num_quads++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f, vec3(.2) };
+		quads[num_quads++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f, vec3(.2) };
 
 	// hotbar frame
-	renderer->quads[num_quads++] = { vec2(0, -.8), vec2(.735, .12), color };
+	quads[num_quads++] = { vec2(0, -.8), vec2(.735, .12), color };
 
 	switch (screen)
 	{
@@ -139,23 +162,26 @@ void update(GUI_Renderer* renderer, Mouse mouse, Item* player_items, uint screen
 		// icons
 		for (uint i = 0, n = 0; i < 3; i++)
 		for (uint j = 0; j < 3; j++)
-			renderer->icons[num_icons++] = { vec2(-.66 + (i * .12), .7 - (j * .2)), scale / 6.f, tex(items[n++].id) };
-		
+		{
+			slots[num_icons] = NUM_PLAYER_ITEMS + n++;
+			icons[num_icons++] = { vec2(-.66 + (i * .12), .7 - (j * .2)), scale / 6.f };
+		}
+
 		// crafting window
 		for (uint i = 0; i < 3; i++)
 		for (uint j = 0; j < 3; j++)
-			renderer->quads[num_quads++] = { vec2(-.66 + (i * .12), .7 - (j * .2)), scale / 6.f, vec3(.4) };
-		
+			quads[num_quads++] = { vec2(-.66 + (i * .12), .7 - (j * .2)), scale / 6.f, vec3(.4) };
+
 		// crafting output
-		renderer->quads[num_quads++] = { vec2(-.66 + (4 * .12), .7 - (1 * .2)), scale / 6.f, vec3(.4) };
+		quads[num_quads++] = { vec2(-.66 + (4 * .12), .7 - (1 * .2)), scale / 6.f, vec3(.4) };
 	} break;
 	case GUI_CRAFTING:
 	{
 		for (uint i = 0; i < 12; i++)
 		for (uint j = 0; j <  6; j++)
-			renderer->quads[num_quads++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f, vec3(.2) };
+			quads[num_quads++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f, vec3(.2) };
 
-		renderer->quads[num_quads++] = { vec2(0, 0), vec2(.73, .85), color };
+		quads[num_quads++] = { vec2(0, 0), vec2(.73, .85), color };
 	} break;
 	}
 
@@ -164,37 +190,151 @@ void update(GUI_Renderer* renderer, Mouse mouse, Item* player_items, uint screen
 		// player item backgrounds
 		for (uint i = 0; i < 12; i++)
 		for (uint j = 3; j <  6; j++)
-			renderer->quads[num_quads++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f, vec3(.2) };
-	
+			quads[num_quads++] = { vec2(-.66 + (i * .12), .6 - (j * .2)), scale / 6.f, vec3(.2) };
+
 		// background
-		renderer->quads[num_quads++] = { vec2(0, 0), vec2(.735, .86), color };
+		quads[num_quads++] = { vec2(0, 0), vec2(.735, .86), color };
 	}
 	else
 	{
 		for (uint i = 0; i < 10; i++) // health
-			renderer->quads[num_quads++] = { vec2(-.7 + (i * .06), -.63), scale / 12.f, vec3(.4, 0, 0) };
+			quads[num_quads++] = { vec2(-.7 + (i * .06), -.63), scale / 12.f, vec3(.4, 0, 0) };
 
 		for (uint i = 0; i < 10; i++) // hunger (should this be replaced/removed?)
-			renderer->quads[num_quads++] = { vec2(.7 - (i * .06), -.63), scale / 12.f, vec3(.513, .309, .086) };
+			quads[num_quads++] = { vec2(.7 - (i * .06), -.63), scale / 12.f, vec3(.513, .309, .086) };
 
 		// crosshair
-		renderer->quads[num_quads++] = { {}, scale / 150.f, vec3(.5) };
+		quads[num_quads++] = { {}, scale / 150.f, vec3(.5) };
+	}
+
+	layout->num_quads = num_quads;
+	layout->num_icons = num_icons;
+
+	for (uint i = 0; i < MAX_GUI_SLOTS; i++) layout->slot_icons[i] = INVALID;
+	for (uint i = 0; i < num_icons; i++) layout->slot_icons[slots[i]] = i;
+
+	update_grid(layout);
+}
+
+struct GUI_Renderer
+{
+	Quad_Drawable quads[MAX_GUI_QUADS]; // what is in the buffers
+	Icon_Drawable icons[MAX_GUI_QUADS];
+	uint num_quads, num_icons;
+
+	GUI_Layout layouts[NUM_GUI_SCREENS];
+
+	// what the buffers were built from
+	uint screen;
+	uint dragged_icon; // INVALID = none
+	uint shown[MAX_GUI_QUADS]; // item id behind each icon
+
+	Drawable_Mesh_2D quad_mesh;
+	Drawable_Mesh_2D_UV icon_mesh;
+	Shader quad_shader, icon_shader;
+	GLuint texture;
+};
+
+void init(GUI_Renderer* renderer)
+{
+	for (uint i = 0; i < NUM_GUI_SCREENS; i++)
+		init(renderer->layouts + i, i);
+
+	renderer->screen = INVALID; // nothing has been built yet
+	renderer->dragged_icon = INVALID;
+
+	init(&renderer->quad_mesh, MAX_GUI_QUADS * sizeof(Quad_Drawable));
+	mesh_add_attrib_vec2(1, sizeof(Quad_Drawable), 0 * sizeof(vec2)); // position
+	mesh_add_attrib_vec2(2, sizeof(Quad_Drawable), 1 * sizeof(vec2)); // scale
+	mesh_add_attrib_vec3(3, sizeof(Quad_Drawable), 2 * sizeof(vec2)); // color
+
+	init(&renderer->icon_mesh, MAX_GUI_QUADS * sizeof(Icon_Drawable), {}, vec2(1.f / 16));
+	mesh_add_attrib_vec2(2, sizeof(Icon_Drawable), 0 * sizeof(vec2)); // position
+	mesh_add_attrib_vec2(3, sizeof(Icon_Drawable), 1 * sizeof(vec2)); // scale
+	mesh_add_attrib_vec2(4, sizeof(Icon_Drawable), 2 * sizeof(vec2)); // texture offset
+
+	renderer->texture = load_texture("assets/textures/icons.bmp", false);
+	load(&renderer->quad_shader, "assets/shaders/mesh_2D.vert"   , "assets/shaders/mesh_2D.frag"   );
+	load(&renderer->icon_shader, "assets/shaders/mesh_2D_UV.vert", "assets/shaders/mesh_2D_UV.frag");
+}
+void update(GUI_Renderer* renderer, Mouse mouse, Item* player_items, uint screen = 1, int selected_index = -1, Item* items = NULL)
+{
+	// screen = which GUI should be displayed : inventory, crafting table, furnace, etc.
+	// selected_index : slot the player is dragging : -1 = none, 3 = 4th inventory slot, 
+	//                                                 >= NUM_PLAYER_ITEMS = item is not on the player
+	// items = items for whatever the player is interacting with(eg. chest); NULL = nothing open
+	// player_items : player inventory
+
+	if (screen >= NUM_GUI_SCREENS) screen = 0;
+	GUI_Layout* layout = renderer->layouts + screen;
+
+	if (screen != renderer->screen) // switch layouts, the quads never change after this
+	{
+		renderer->screen = screen;
+		renderer->dragged_icon = INVALID;
+		renderer->num_quads = layout->num_quads;
+		renderer->num_icons = layout->num_icons;
+
+		memcpy(renderer->quads, layout->quads, layout->num_quads * sizeof(Quad_Drawable));
+		memcpy(renderer->icons, layout->icons, layout->num_icons * sizeof(Icon_Drawable));
+		for (uint i = 0; i < layout->num_icons; i++) renderer->shown[i] = INVALID;
+
+		update(renderer->quad_mesh, layout->num_quads * sizeof(Quad_Drawable), (byte*)renderer->quads);
 	}
 
-	if (selected_index >= 0 && screen)
+	uint first = MAX_GUI_QUADS, last = 0; // range of icons that changed
+	auto changed = [&](uint i) { first = glm::min(first, i); last = glm::max(last, i); };
+
+	for (uint i = 0; i < renderer->num_icons; i++)
 	{
-		renderer->icons[selected_index].position = vec2(mouse.norm_x, mouse.norm_y);
+		uint slot = layout->slots[i];
+		uint id = (slot < NUM_PLAYER_ITEMS) ? player_items[slot].id : items[slot - NUM_PLAYER_ITEMS].id;
+		if (id == renderer->shown[i]) continue;
+
+		renderer->shown[i] = id;
+		renderer->icons[i].tex_offset = icon_tex(id);
+		changed(i);
 	}
 
-	update(renderer->quad_mesh, MAX_GUI_QUADS * sizeof(Quad_Drawable), (byte*)renderer->quads);
-	update(renderer->icon_mesh, MAX_GUI_QUADS * sizeof(Icon_Drawable), (byte*)renderer->icons);
+	uint dragged = (screen && selected_index >= 0 && selected_index < MAX_GUI_SLOTS) ? layout->slot_icons[selected_index] : INVALID;
+
+	if (dragged != renderer->dragged_icon) // put the last dragged icon back
+	{
+		uint old = renderer->dragged_icon;
+		if (old != INVALID) { renderer->icons[old].position = layout->icons[old].position; changed(old); }
+		renderer->dragged_icon = dragged;
+	}
+
+	if (dragged != INVALID) // dragged icon follows the mouse
+	{
+		vec2 position = vec2(mouse.norm_x, mouse.norm_y);
+		if (renderer->icons[dragged].position != position) { renderer->icons[dragged].position = position; changed(dragged); }
+	}
+
+	if (first <= last)
+		update(renderer->icon_mesh, (last + 1 - first) * sizeof(Icon_Drawable), (byte*)(renderer->icons + first), first * sizeof(Icon_Drawable));
+}
+int gui_item_index(GUI_Renderer* renderer, Mouse mouse, int selected_index = -1) // slot under the mouse, -1 = none
+{
+	if (renderer->screen >= NUM_GUI_SCREENS) return -1; // nothing shown yet
+	GUI_Layout* layout = renderer->layouts + renderer->screen;
+
+	ivec2 coords = gui_grid_coords(vec2(mouse.norm_x, mouse.norm_y));
+	uint cell = coords.x + (coords.y * GUI_GRID_CELLS);
+
+	for (uint n = layout->cell_start[cell]; n < layout->cell_start[cell + 1]; n++)
+	{
+		uint i = layout->cell_icons[n];
+		if (layout->slots[i] != selected_index && mouse_in_quad(layout->icons[i], mouse))
+			return layout->slots[i];
+	}
+
+	return -1;
 }
-void draw(GUI_Renderer* renderer)
+void draw(GUI_Renderer* renderer, Render_Queue* queue) // icons, then the quads on top of them
 {
-	bind(renderer->icon_shader);
-	bind_texture(renderer->texture, 0);
-	draw(renderer->icon_mesh, MAX_GUI_QUADS);
+	Draw_Packet* packet = submit(queue, PASS_GUI, renderer->icon_shader, renderer->icon_mesh.VAO, 6, renderer->num_icons);
+	set_texture(packet, 0, renderer->texture);
 
-	bind(renderer->quad_shader);
-	draw(renderer->quad_mesh, MAX_GUI_QUADS);
+	submit(queue, PASS_GUI, renderer->quad_shader, renderer->quad_mesh.VAO, 6, renderer->num_quads);
 }
\ No newline at end of file
@@ -32,153 +32,1431 @@
 #define ITEM_COPPER	4
 #define PIPE_DIAMOND	5
 
+#define MAX_STACK_SIZE 64
+
 struct Item { uint type, id, count; };
 
-Item smelt(Item item)
+// recipes : loaded from assets/recipes.txt into flat arrays. machine recipes are found by a hash of
+// (machine, input item), crafting recipes by a hash of their shape moved into the top left corner,
+// so a lookup costs the same however many recipes there are
+
+#define MAX_PROCESS_RECIPES	(1 << 14)
+#define MAX_CRAFTING_RECIPES	(1 << 14)
+#define RECIPE_HASH_SIZE		(1 << 15) // must be a power of 2, at least 2x either of the above
+#define ITEM_NAME_HASH_SIZE	256 // must be a power of 2
+
+#define DEFAULT_PROCESS_TIME 10 // seconds
+
+struct Item_Name { const char* name; uint type, id; };
+
+const Item_Name ITEM_NAMES[] = {
+	{ "stone"       , ITEM_BLOCK, BLOCK_STONE       }, { "dirt"        , ITEM_BLOCK, BLOCK_DIRT        },
+	{ "grass"       , ITEM_BLOCK, BLOCK_GRASS       }, { "sand"        , ITEM_BLOCK, BLOCK_SAND        },
+	{ "wood"        , ITEM_BLOCK, BLOCK_WOOD        }, { "brick"       , ITEM_BLOCK, BLOCK_BRICK       },
+	{ "stone_brick" , ITEM_BLOCK, BLOCK_STONE_BRICK }, { "bark"        , ITEM_BLOCK, BLOCK_BARK        },
+	{ "coal_ore"    , ITEM_BLOCK, BLOCK_COAL_ORE    }, { "iron_ore"    , ITEM_BLOCK, BLOCK_IRON_ORE    },
+	{ "copper_ore"  , ITEM_BLOCK, BLOCK_COPPER_ORE  }, { "diamond_ore" , ITEM_BLOCK, BLOCK_DIAMOND_ORE },
+	{ "emerald_ore" , ITEM_BLOCK, BLOCK_EMERALD_ORE }, { "gold_ore"    , ITEM_BLOCK, BLOCK_GOLD_ORE    },
+	{ "ruby_ore"    , ITEM_BLOCK, BLOCK_RUBY_ORE    },
+
+	{ "crafting_table", ITEM_BLOCK, BLOCK_CRAFTING  }, { "furnace"     , ITEM_BLOCK, BLOCK_FURNACE     },
+	{ "quarry"      , ITEM_BLOCK, BLOCK_QUARRY      }, { "recycler"    , ITEM_BLOCK, BLOCK_RECYCLER    },
+	{ "crusher"     , ITEM_BLOCK, BLOCK_CRUSHER     }, { "washer"      , ITEM_BLOCK, BLOCK_WASHER      },
+	{ "smelter"     , ITEM_BLOCK, BLOCK_SMELTER     }, { "generator"   , ITEM_BLOCK, BLOCK_GENERATOR   },
+	{ "pump"        , ITEM_BLOCK, BLOCK_PUMP        }, { "solar_panel" , ITEM_BLOCK, BLOCK_SOLAR_PANEL },
+	{ "assembler"   , ITEM_BLOCK, BLOCK_ASSEMBLER   }, { "oil_refinery", ITEM_BLOCK, BLOCK_OIL_REFINERY},
+	{ "chest"       , ITEM_BLOCK, BLOCK_CHEST       }, { "tank"        , ITEM_BLOCK, BLOCK_TANK        },
+	{ "pipe"        , ITEM_BLOCK, BLOCK_PIPE        }, { "belt"        , ITEM_BLOCK, BLOCK_BELT        },
+	{ "wire"        , ITEM_BLOCK, BLOCK_WIRE        },
+
+	{ "coal"            , ITEM_RESOURCE, RESOURCE_COAL             }, { "charcoal"       , ITEM_RESOURCE, RESOURCE_CHARCOAL        },
+	{ "diamond"         , ITEM_RESOURCE, RESOURCE_DIAMOND          }, { "iron_nugget"    , ITEM_RESOURCE, RESOURCE_IRON_NUGGET     },
+	{ "crushed_iron_ore", ITEM_RESOURCE, RESOURCE_CRUSHED_IRON_ORE }, { "washed_iron_ore", ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE },
+
+	{ "iron_ingot"  , ITEM_INGOT, INGOT_IRON   }, { "copper_ingot", ITEM_INGOT, INGOT_COPPER },
+	{ "gold_ingot"  , ITEM_INGOT, INGOT_GOLD   }, { "silver_ingot", ITEM_INGOT, INGOT_SILVER },
+	{ "steel_ingot" , ITEM_INGOT, INGOT_STEEL  },
+};
+
+struct Process_Recipe // furnace, crusher, washer, etc.
+{
+	u16 machine; // block id
+	Item in, out; // in.count = how many it takes
+	float time; // seconds
+};
+
+struct Crafting_Recipe
+{
+	u8 width, height;
+	uint cells[9]; // item_key() of each cell, row major, width x height of them are used
+	Item out;
+};
+
+struct Recipes
+{
+	uint num_process, num_crafting;
+	Process_Recipe  process [MAX_PROCESS_RECIPES];
+	Crafting_Recipe crafting[MAX_CRAFTING_RECIPES];
+
+	uint process_slots [RECIPE_HASH_SIZE]; // 1 + index, 0 = empty
+	uint crafting_slots[RECIPE_HASH_SIZE];
+	u16 name_slots[ITEM_NAME_HASH_SIZE]; // 1 + index into ITEM_NAMES
+};
+
+Recipes recipes; // loaded once, see load_recipes()
+
+uint item_key(Item item) { return (item.type << 16) | item.id; } // ignores the count
+uint string_hash(const char* string) // fnv-1a
+{
+	uint hash = 2166136261;
+	for (; *string; string++) hash = (hash ^ (byte)*string) * 16777619;
+	return hash;
+}
+uint process_hash(u16 machine, uint key)
+{
+	return (uint)((((uint64)machine << 32) | key) * 0x9E3779B97F4A7C15ull >> 40) & (RECIPE_HASH_SIZE - 1);
+}
+uint crafting_hash(uint width, uint height, uint* cells)
+{
+	uint hash = (2166136261 ^ (width | (height << 2))) * 16777619;
+	for (uint i = 0; i < width * height; i++) hash = (hash ^ cells[i]) * 16777619;
+	return hash & (RECIPE_HASH_SIZE - 1);
+}
+
+// moves the items in a 3x3 grid into the top left corner, returns false if it is empty
+bool normalize(uint* grid, uint* width, uint* height, uint* cells)
 {
-	switch (item.id)
+	uint x0 = 3, y0 = 3, x1 = 0, y1 = 0;
+
+	for (uint y = 0; y < 3; y++)
+	for (uint x = 0; x < 3; x++)
 	{
-	case BLOCK_WOOD : {
-		return Item{ ITEM_RESOURCE, RESOURCE_CHARCOAL, 1 };
-	} break;
+		if (!grid[x + (y * 3)]) continue;
+		x0 = glm::min(x0, x); x1 = glm::max(x1, x);
+		y0 = glm::min(y0, y); y1 = glm::max(y1, y);
 	}
 
-	return Item{}; // cannot smelt item
+	if (x0 > x1) return false;
+
+	*width  = x1 - x0 + 1;
+	*height = y1 - y0 + 1;
+
+	for (uint y = 0; y < *height; y++)
+	for (uint x = 0; x < *width ; x++)
+		cells[x + (y * *width)] = grid[(x0 + x) + ((y0 + y) * 3)];
+
+	return true;
 }
-Item crush(Item item)
+
+Process_Recipe* find_recipe(Recipes* recipes, u16 machine, Item in) // NULL if the machine can't use this item
 {
-	switch (item.id)
+	uint key = item_key(in);
+
+	for (uint i = process_hash(machine, key); recipes->process_slots[i]; i = (i + 1) & (RECIPE_HASH_SIZE - 1))
 	{
-	case BLOCK_IRON_ORE: {
-		return Item{ ITEM_RESOURCE, RESOURCE_CRUSHED_IRON_ORE, 1 };
-	} break;
+		Process_Recipe* recipe = recipes->process + (recipes->process_slots[i] - 1);
+		if (recipe->machine == machine && item_key(recipe->in) == key) return recipe;
 	}
 
-	return Item{}; // cannot smelt item
+	return NULL;
 }
-Item wash(Item item)
+Item craft(Recipes* recipes, Item* grid) // 3x3 grid, row major. returns nothing if it doesn't match a recipe
 {
-	switch (item.id)
+	uint keys[9], cells[9], width, height;
+	for (uint i = 0; i < 9; i++) keys[i] = grid[i].type ? item_key(grid[i]) : 0;
+
+	if (!normalize(keys, &width, &height, cells)) return Item{};
+
+	for (uint i = crafting_hash(width, height, cells); recipes->crafting_slots[i]; i = (i + 1) & (RECIPE_HASH_SIZE - 1))
 	{
-	case RESOURCE_CRUSHED_IRON_ORE: {
-		return Item{ ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE, 1 };
-	} break;
+		Crafting_Recipe* recipe = recipes->crafting + (recipes->crafting_slots[i] - 1);
+		if (recipe->width == width && recipe->height == height && !memcmp(recipe->cells, cells, width * height * sizeof(uint)))
+			return recipe->out;
 	}
 
-	return Item{}; // cannot smelt item
+	return Item{};
 }
 
-struct Furnace
+// loading
+
+void add_recipe(Recipes* recipes, Process_Recipe recipe) // replaces a recipe for the same machine & input
 {
-	Item in, out, fuel;
-	float progress;
-	float fuel_level;
+	uint key = item_key(recipe.in);
+	uint i = process_hash(recipe.machine, key);
+
+	for (; recipes->process_slots[i]; i = (i + 1) & (RECIPE_HASH_SIZE - 1))
+	{
+		Process_Recipe* old = recipes->process + (recipes->process_slots[i] - 1);
+		if (old->machine == recipe.machine && item_key(old->in) == key) { *old = recipe; return; }
+	}
+
+	if (recipes->num_process == MAX_PROCESS_RECIPES) { print("too many machine recipes\n"); return; }
+
+	recipes->process[recipes->num_process++] = recipe;
+	recipes->process_slots[i] = recipes->num_process;
+}
+void add_recipe(Recipes* recipes, Crafting_Recipe recipe)
+{
+	uint i = crafting_hash(recipe.width, recipe.height, recipe.cells);
+	uint size = recipe.width * recipe.height * sizeof(uint);
+
+	for (; recipes->crafting_slots[i]; i = (i + 1) & (RECIPE_HASH_SIZE - 1))
+	{
+		Crafting_Recipe* old = recipes->crafting + (recipes->crafting_slots[i] - 1);
+		if (old->width == recipe.width && old->height == recipe.height && !memcmp(old->cells, recipe.cells, size)) { *old = recipe; return; }
+	}
+
+	if (recipes->num_crafting == MAX_CRAFTING_RECIPES) { print("too many crafting recipes\n"); return; }
+
+	recipes->crafting[recipes->num_crafting++] = recipe;
+	recipes->crafting_slots[i] = recipes->num_crafting;
+}
+
+char* next_token(char** line) // splits off the next space separated word of a line, NULL if there are none left
+{
+	char* c = *line;
+	while (*c == ' ' || *c == '\t' || *c == '\r') c++;
+	if (*c == 0 || *c == '#') return NULL;
+
+	char* token = c;
+	while (*c && *c != ' ' && *c != '\t' && *c != '\r') c++;
+	if (*c) *c++ = 0;
+
+	*line = c;
+	return token;
+}
+bool parse_item(Recipes* recipes, char* token, Item* item) // name[*count] or type:id[*count]
+{
+	if (!token) return false;
+
+	char* star = strchr(token, '*');
+	item->count = 1;
+	if (star) { *star = 0; item->count = atoi(star + 1); }
+	if (item->count == 0 || item->count > MAX_STACK_SIZE) return false;
+
+	char* colon = strchr(token, ':');
+	if (colon)
+	{
+		item->type = atoi(token);
+		item->id   = atoi(colon + 1);
+		return item->type != NULL;
+	}
+
+	for (uint i = string_hash(token) & (ITEM_NAME_HASH_SIZE - 1); recipes->name_slots[i]; i = (i + 1) & (ITEM_NAME_HASH_SIZE - 1))
+	{
+		const Item_Name* name = ITEM_NAMES + (recipes->name_slots[i] - 1);
+		if (strcmp(name->name, token)) continue;
+
+		item->type = name->type;
+		item->id   = name->id;
+		return true;
+	}
+
+	return false;
+}
+bool parse_recipe(Recipes* recipes, char* line)
+{
+	char* machine = next_token(&line);
+	if (!machine) return true; // empty line or comment
+
+	if (!strcmp(machine, "craft")) // craft <output>[*count] = <row> / <row> / <row>, '.' = empty
+	{
+		Crafting_Recipe recipe = {};
+		uint grid[9] = {}, x = 0, y = 0;
+
+		if (!parse_item(recipes, next_token(&line), &recipe.out)) return false;
+
+		char* token = next_token(&line);
+		if (!token || strcmp(token, "=")) return false;
+
+		while ((token = next_token(&line)))
+		{
+			if (!strcmp(token, "/")) { x = 0; if (++y == 3) return false; continue; }
+			if (x == 3) return false;
+
+			Item cell = {};
+			if (strcmp(token, ".") && !parse_item(recipes, token, &cell)) return false;
+			grid[x++ + (y * 3)] = cell.type ? item_key(cell) : 0;
+		}
+
+		uint width, height;
+		if (!normalize(grid, &width, &height, recipe.cells)) return false;
+
+		recipe.width  = width;
+		recipe.height = height;
+		add_recipe(recipes, recipe);
+		return true;
+	}
+
+	// <machine> <input>[*count] = <output>[*count] [seconds]
+	Item block = {};
+	if (!parse_item(recipes, machine, &block) || block.type != ITEM_BLOCK) return false;
+
+	Process_Recipe recipe = { (u16)block.id };
+	if (!parse_item(recipes, next_token(&line), &recipe.in)) return false;
+
+	char* token = next_token(&line);
+	if (!token || strcmp(token, "=")) return false;
+	if (!parse_item(recipes, next_token(&line), &recipe.out)) return false;
+
+	token = next_token(&line);
+	recipe.time = token ? (float)atof(token) : DEFAULT_PROCESS_TIME;
+
+	add_recipe(recipes, recipe);
+	return true;
+}
+void load_recipes(Recipes* recipes, const char* path)
+{
+	memset(recipes, 0, sizeof(Recipes)); // ~1.6 MB, too big for a temporary on the stack
+
+	for (uint n = 0; n < sizeof(ITEM_NAMES) / sizeof(ITEM_NAMES[0]); n++)
+	{
+		uint i = string_hash(ITEM_NAMES[n].name) & (ITEM_NAME_HASH_SIZE - 1);
+		while (recipes->name_slots[i]) i = (i + 1) & (ITEM_NAME_HASH_SIZE - 1);
+		recipes->name_slots[i] = n + 1;
+	}
+
+	char* text = (char*)read_text_file_into_memory(path);
+	if (!text) { out("ERROR : '" << path << "' NOT FOUND!"); return; }
+	char* line = text;
+
+	for (uint line_number = 1; line; line_number++)
+	{
+		char* end = strchr(line, '\n');
+		if (end) *end = 0;
+
+		if (!parse_recipe(recipes, line))
+			print("%s line %u : could not read recipe\n", path, line_number);
+
+		line = end ? end + 1 : NULL;
+	}
+
+	free(text);
+}
+
+// inventories : an item array plus a bitmap of its empty slots & a small hash of which slots hold each kind of
+// item, so adding items only looks at stacks of the same kind & then the first empty slot. every change to
+// the items has to go through set_slot() (or give / take / transfer) to keep them in step
+
+#define MAX_INVENTORY_SLOTS	64 // one bit per slot
+#define INVENTORY_INDEX_SIZE	128 // must be a power of 2, at least 2x MAX_INVENTORY_SLOTS
+
+struct Inventory_Entry
+{
+	uint key; // item_key()
+	uint64 slots; // that hold it, 0 = unused entry
 };
 
-void update(Furnace* furnace, float dt)
+struct Inventory
+{
+	uint num_slots;
+	uint64 empty; // bit i is set if slot i is empty
+	Inventory_Entry index[INVENTORY_INDEX_SIZE]; // open addressing, linear probing
+};
+
+uint max_stack(Item item) { return (item.type == ITEM_TOOL) ? 1 : MAX_STACK_SIZE; }
+
+bool stack(Item* slot, Item item) // false if it doesn't fit
 {
-	if (furnace->in.type)
+	if (slot->type == NULL) { *slot = item; return true; }
+	if (slot->type != item.type || slot->id != item.id || slot->count + item.count > max_stack(item)) return false;
+
+	slot->count += item.count;
+	return true;
+}
+
+uint64 slot_mask(uint first, uint count) // bits first .. first + count
+{
+	uint64 bits = (count >= 64) ? ~0ull : ((1ull << count) - 1);
+	return bits << first;
+}
+uint inventory_hash(uint key) { return ((key * 2654435769u) >> 16) & (INVENTORY_INDEX_SIZE - 1); }
+
+// the entry for 'key', or the unused entry it would go in
+Inventory_Entry* find_entry(Inventory* inventory, uint key)
+{
+	uint i = inventory_hash(key);
+
+	while (inventory->index[i].slots && inventory->index[i].key != key)
+		i = (i + 1) & (INVENTORY_INDEX_SIZE - 1);
+
+	return inventory->index + i;
+}
+void remove_entry(Inventory* inventory, Inventory_Entry* entry) // same backward shift as remove_slot()
+{
+	uint hole = entry - inventory->index;
+
+	for (uint i = (hole + 1) & (INVENTORY_INDEX_SIZE - 1); inventory->index[i].slots; i = (i + 1) & (INVENTORY_INDEX_SIZE - 1))
 	{
-		furnace->fuel_level -= dt;
-		furnace->out = smelt(furnace->in);
-		furnace->in.count--;
+		uint home = inventory_hash(inventory->index[i].key);
+		if (((i - home) & (INVENTORY_INDEX_SIZE - 1)) >= ((i - hole) & (INVENTORY_INDEX_SIZE - 1)))
+		{
+			inventory->index[hole] = inventory->index[i];
+			hole = i;
+		}
 	}
+
+	inventory->index[hole] = {};
 }
 
+void set_slot(Inventory* inventory, Item* items, uint slot, Item item)
+{
+	if (item.count == 0) item = {};
+
+	Item old = items[slot];
+	items[slot] = item;
+
+	if (old.type == item.type && old.id == item.id) return; // only the count changed
+
+	uint64 bit = 1ull << slot;
+
+	if (old.type)
+	{
+		Inventory_Entry* entry = find_entry(inventory, item_key(old));
+		entry->slots &= ~bit;
+		if (entry->slots == 0) remove_entry(inventory, entry);
+	}
+
+	if (item.type)
+	{
+		Inventory_Entry* entry = find_entry(inventory, item_key(item));
+		entry->key = item_key(item);
+		entry->slots |= bit;
+		inventory->empty &= ~bit;
+	}
+	else inventory->empty |= bit;
+}
+void init(Inventory* inventory, Item* items, uint num_slots) // indexes whatever is already in 'items'
+{
+	*inventory = {};
+	inventory->num_slots = num_slots;
+	inventory->empty = slot_mask(0, num_slots);
+
+	for (uint i = 0; i < num_slots; i++)
+	{
+		Item item = items[i];
+		items[i] = {};
+		set_slot(inventory, items, i, item);
+	}
+}
+
+// adds as much of 'item' as fits, topping up stacks of it before using empty slots. only slots in 'allowed'
+// are used. returns how many were added
+uint give(Inventory* inventory, Item* items, Item item, uint64 allowed = ~0ull)
+{
+	uint left = item.count, max = max_stack(item);
+
+	for (uint64 same = find_entry(inventory, item_key(item))->slots & allowed; same && left; same &= same - 1)
+	{
+		Item* slot = items + glm::findLSB(same);
+		uint moved = glm::min(left, max - glm::min(slot->count, max));
+
+		slot->count += moved;
+		left -= moved;
+	}
+
+	for (uint64 empty = inventory->empty & allowed; empty && left; empty &= empty - 1)
+	{
+		Item stack = item;
+		stack.count = glm::min(left, max);
+
+		set_slot(inventory, items, glm::findLSB(empty), stack);
+		left -= stack.count;
+	}
+
+	return item.count - left;
+}
+Item take(Inventory* inventory, Item* items, uint slot, uint count) // up to 'count' from one slot
+{
+	Item taken = items[slot];
+	taken.count = glm::min(taken.count, count);
+
+	Item left = items[slot];
+	left.count -= taken.count;
+	set_slot(inventory, items, slot, left);
+
+	return taken.count ? taken : Item{};
+}
+uint take(Inventory* inventory, Item* items, Item item) // up to item.count of that kind from anywhere, returns how many
+{
+	uint taken = 0;
+
+	for (uint64 same = find_entry(inventory, item_key(item))->slots; same && taken < item.count; same &= same - 1)
+		taken += take(inventory, items, glm::findLSB(same), item.count - taken).count;
+
+	return taken;
+}
+uint first_item(Inventory* inventory) // slot of the first stack, or INVALID if there are none
+{
+	uint64 full = ~inventory->empty & slot_mask(0, inventory->num_slots);
+	return full ? glm::findLSB(full) : INVALID;
+}
+
+// moves as much of the stack in 'slot' as fits into another inventory (shift-click). returns how many moved
+uint transfer(Inventory* from, Item* from_items, uint slot, Inventory* to, Item* to_items, uint64 allowed = ~0ull)
+{
+	Item item = from_items[slot];
+	if (item.type == NULL) return 0;
+
+	uint moved = give(to, to_items, item, allowed);
+	take(from, from_items, slot, moved);
+	return moved;
+}
+uint transfer_all(Inventory* from, Item* from_items, Inventory* to, Item* to_items) // e.g. emptying a chest into the player
+{
+	uint moved = 0;
+
+	for (uint64 full = ~from->empty & slot_mask(0, from->num_slots); full; full &= full - 1)
+		moved += transfer(from, from_items, glm::findLSB(full), to, to_items);
+
+	return moved;
+}
+
+// machine processing : progress & fuel are whole numbers, so running a machine for n ticks in one go gives
+// exactly what running it n times for 1 tick would. machines are only brought up to date when their chunk's
+// tier is due, or when something looks at them, see advance(). idle ones are skipped until something changes
+
+#define TICKS_PER_SECOND	20
+#define PROGRESS_SCALE	256 // progress per tick at full speed
+
+struct Furnace
+{
+	Item in, out, fuel;
+	uint progress; // 1 / PROGRESS_SCALE ticks
+	uint burn; // ticks of fuel left
+	uint tick; // up to date at this tick
+	bool busy; // has something to smelt & the fuel to do it
+	u8 tier; // of its chunk
+	ivec3 pos;
+};
+
 struct Crafting_Table
 {
 	Item in[9];
 	Item out;
+	ivec3 pos;
 };
 
-#define MAX_CHESTS 1
 #define NUM_CHEST_ITEMS (12 * 4)
 
 struct Chest
 {
 	Item items[NUM_CHEST_ITEMS];
-	uvec3 coord;
+	Inventory inventory;
+	ivec3 pos;
 };
 
-Item get_next_item(Chest* chests, uvec3 coords)
+struct Machine // quarry, crusher, washer, smelter, generator, etc.
+{
+	Item in, out;
+	uint progress; // 1 / PROGRESS_SCALE ticks
+	uint burn; // generators : ticks of fuel left
+	float power; // fraction of its demand that was met last tick
+	u16 block;
+	u16 grid; // wire network it is connected to, only valid while grid_generation matches
+	uint grid_generation;
+	uint tick; // up to date at this tick
+	bool busy; // has something to process (generators : fuel to burn)
+	u8 tier; // of its chunk
+	ivec3 pos;
+};
+
+uint fuel_ticks(Item item) // how long one of these burns for
+{
+	if (item.type == ITEM_RESOURCE && (item.id == RESOURCE_COAL || item.id == RESOURCE_CHARCOAL)) return 80 * TICKS_PER_SECOND;
+	if (item.type == ITEM_BLOCK && item.id == BLOCK_WOOD) return 15 * TICKS_PER_SECOND;
+	return 0;
+}
+uint operations_left(Process_Recipe* recipe, Item in, Item out) // until the input runs out or the output is full
+{
+	if (!recipe) return 0;
+
+	uint room = 0, max = max_stack(recipe->out);
+	if (out.type == NULL) room = max;
+	else if (out.type == recipe->out.type && out.id == recipe->out.id && out.count < max) room = max - out.count;
+
+	return glm::min(in.count / recipe->in.count, room / recipe->out.count);
+}
+
+// runs for at most 'ticks' ticks, 'fuel' of which it can actually work for, & returns how many it worked.
+// progress is lost whenever it stops, like it would be on the first tick it couldn't work
+uint process(Process_Recipe* recipe, Item* in, Item* out, uint* progress, uint ticks, uint rate, uint fuel)
 {
-	Chest* chest = {};
+	uint ops = operations_left(recipe, *in, *out);
+	if (rate == 0) return 0; // unpowered, it just waits
+	if (ops == 0 || fuel == 0) { if (ticks) *progress = 0; return 0; }
+
+	uint64 cost = (uint64)glm::max(1u, (uint)(recipe->time * TICKS_PER_SECOND)) * PROGRESS_SCALE;
+	uint64 needed = ((ops * cost) - *progress + rate - 1) / rate; // ticks until the last operation it can do is done
+
+	uint worked = (uint)glm::min((uint64)glm::min(ticks, fuel), needed);
+	uint64 total = *progress + ((uint64)worked * rate);
+	uint done = (uint)glm::min(total / cost, (uint64)ops);
 
-	for (uint i = 0; i < MAX_CHESTS; i++)
+	*progress = (worked < ticks) ? 0 : (uint)(total - (done * cost));
+
+	if (done)
 	{
-		if (chests[i].coord == coords)
+		in->count -= done * recipe->in.count;
+		if (in->count == 0) *in = {};
+
+		if (out->type == NULL) { *out = recipe->out; out->count = 0; }
+		out->count += done * recipe->out.count;
+	}
+
+	return worked;
+}
+void burn(uint* burn, Item* fuel, uint ticks) // uses up 'ticks' ticks of fuel, taking more out of 'fuel' as needed
+{
+	if (ticks <= *burn) { *burn -= ticks; return; }
+
+	uint per_item = fuel_ticks(*fuel);
+	uint used = ((ticks - *burn) + per_item - 1) / per_item;
+
+	fuel->count -= used;
+	if (fuel->count == 0) *fuel = {};
+
+	*burn = *burn + (used * per_item) - ticks;
+}
+
+void advance(Furnace* furnace, uint tick) // catches it up to 'tick'
+{
+	uint ticks = tick - furnace->tick;
+	furnace->tick = tick;
+
+	Process_Recipe* recipe = find_recipe(&recipes, BLOCK_FURNACE, furnace->in);
+	uint fuel = furnace->burn + (furnace->fuel.count * fuel_ticks(furnace->fuel));
+
+	uint worked = process(recipe, &furnace->in, &furnace->out, &furnace->progress, ticks, PROGRESS_SCALE, fuel);
+	burn(&furnace->burn, &furnace->fuel, worked);
+
+	recipe = find_recipe(&recipes, BLOCK_FURNACE, furnace->in);
+	furnace->busy = operations_left(recipe, furnace->in, furnace->out) && (furnace->burn || fuel_ticks(furnace->fuel));
+}
+void advance(Machine* machine, uint tick)
+{
+	uint ticks = tick - machine->tick;
+	machine->tick = tick;
+
+	if (machine->block == BLOCK_GENERATOR) // burns whatever it has, whether the power is used or not
+	{
+		uint fuel = machine->burn + (machine->in.count * fuel_ticks(machine->in));
+		burn(&machine->burn, &machine->in, glm::min(ticks, fuel));
+
+		machine->busy = machine->burn || fuel_ticks(machine->in);
+		return;
+	}
+
+	Process_Recipe* recipe = find_recipe(&recipes, machine->block, machine->in);
+	process(recipe, &machine->in, &machine->out, &machine->progress, ticks, (uint)(machine->power * PROGRESS_SCALE), UINT_MAX);
+
+	recipe = find_recipe(&recipes, machine->block, machine->in);
+	machine->busy = operations_left(recipe, machine->in, machine->out) > 0;
+}
+
+struct Pipe // a pipe, belt or wire segment
+{
+	ivec3 pos;
+	u16 block;
+	u16 network; // index into Transport.networks
+	ivec3 target; // nearest inventory its network delivers to from here
+	uint distance; // in blocks, to 'target'. 0 = nothing to deliver to
+	uint visit; // last search that reached it, see flood()
+};
+
+// transport networks : connected segments of the same kind (pipe, belt or wire) form a network.
+// networks are merged & split as segments are placed & removed, & the routes through a network are
+// only rebuilt when its shape or the inventories next to it change. items aren't moved from pipe to
+// pipe, their arrival is scheduled on a timing wheel instead
+
+#define MAX_PIPES			(1 << 17) // pipes, belts & wires
+#define MAX_NETWORKS			(1 << 14)
+#define MAX_TRANSPORT_EVENTS	(1 << 17)
+#define MAX_PENDING_SPLITS	(1 << 16)
+#define MAX_TRANSPORT_DROPS	256
+#define TIMING_WHEEL_SIZE	256 // in ticks, must be a power of 2. events further out go around more than once
+
+#define PIPE_TICKS_PER_BLOCK	20 // 1 block per second
+#define BELT_TICKS_PER_BLOCK	10
+#define EXTRACT_TICKS		20 // a pipe above a chest pulls an item out of it this often
+#define DELIVERY_RETRY_TICKS	20 // when the destination is full
+#define MAX_DELIVERY_RETRIES	300 // ~5 minutes, then the item is dropped instead
+
+#define EVENT_EXTRACT	1
+#define EVENT_ARRIVE		2
+
+struct Network
+{
+	u16 block; // BLOCK_PIPE, BLOCK_BELT or BLOCK_WIRE. BLOCK_AIR = unused
+	bool dirty; // routes need rebuilding
+	uint num_pipes;
+	uint generation; // changes whenever the routes are rebuilt, events from before that are dropped
+	uint visit; // search that last went through all of it, see split_networks()
+	ivec3 root; // any segment in the network
+
+	// wire networks : totals of the machines on the grid, see tick_power()
+	float supply, demand;
+	uint power_tick;
+};
+
+struct Transport_Event
+{
+	uint next; // 1 + index of the next event in the same wheel slot (or free list), 0 = none
+	uint tick; // when it happens
+	u8 type;
+	u16 network;
+	uint generation;
+	ivec3 pos; // EVENT_EXTRACT : the pipe above the chest, EVENT_ARRIVE : the destination
+	Item item;
+	u16 retries; // EVENT_ARRIVE : times the destination was full
+};
+
+struct Transport
+{
+	uint tick;
+	uint wheel[TIMING_WHEEL_SIZE]; // 1 + index of the first event, 0 = empty
+	uint num_events, free_events;
+	Transport_Event events[MAX_TRANSPORT_EVENTS];
+
+	uint num_networks, num_free_networks, generations;
+	u16 free_networks[MAX_NETWORKS];
+	Network networks[MAX_NETWORKS];
+
+	uint num_dirty;
+	u16 dirty[MAX_NETWORKS];
+
+	// removing a segment may split its network. that is checked once per tick from the segments next to the removed ones
+	uint num_splits;
+	bool splits_overflow; // every network is rebuilt instead
+	ivec3 splits[MAX_PENDING_SPLITS];
+
+	uint visit; // search counter
+	ivec3 queue[MAX_PIPES], frontier[MAX_PIPES]; // search scratch
+
+	uint num_drops; // items that couldn't be delivered, spawned into the world by the world update
+	Item  drops   [MAX_TRANSPORT_DROPS];
+	ivec3 drop_pos[MAX_TRANSPORT_DROPS];
+};
+
+// block entities : one dense array per type, so updating a type is a straight loop over it, and a hash
+// from block position -> (block, index) so finding the one at a position doesn't scan anything.
+// removing one moves the last of its type into the hole
+
+#define MAX_CHESTS			(1 << 12)
+#define MAX_FURNACES			(1 << 12)
+#define MAX_CRAFTING_TABLES	(1 << 10)
+#define MAX_MACHINES			(1 << 17)
+#define ENTITY_HASH_SIZE		(1 << 19) // must be a power of 2, keep it at least ~1.5x all of the above + MAX_PIPES
+
+struct Entity_Slot
+{
+	ivec3 pos;
+	u16 block; // BLOCK_AIR = empty slot
+	uint index; // into the array of block_entity_type(block)
+};
+
+struct Block_Entities
+{
+	uint counts[NUM_ENTITY_TYPES];
+	Chest chests[MAX_CHESTS];
+	Furnace furnaces[MAX_FURNACES];
+	Crafting_Table tables[MAX_CRAFTING_TABLES];
+	Machine machines[MAX_MACHINES];
+	Pipe pipes[MAX_PIPES];
+	Transport transport;
+
+	Entity_Slot slots[ENTITY_HASH_SIZE]; // open addressing, linear probing
+	uint32 lookup_x, lookup_z; // loaded square the entities were last checked against
+	uint tick;
+};
+
+uint entity_hash(ivec3 pos)
+{
+	uint hash = ((uint)pos.x * 73856093) ^ ((uint)pos.y * 19349663) ^ ((uint)pos.z * 83492791);
+	return hash & (ENTITY_HASH_SIZE - 1);
+}
+
+// the slot holding 'pos', or the empty slot it would go in
+Entity_Slot* find_slot(Block_Entities* entities, ivec3 pos)
+{
+	uint i = entity_hash(pos);
+
+	while (entities->slots[i].block != BLOCK_AIR && entities->slots[i].pos != pos)
+		i = (i + 1) & (ENTITY_HASH_SIZE - 1);
+
+	return entities->slots + i;
+}
+void remove_slot(Block_Entities* entities, Entity_Slot* slot)
+{
+	// shift back the slots after the hole that can't be found past it anymore (no tombstones)
+	uint hole = slot - entities->slots;
+
+	for (uint i = (hole + 1) & (ENTITY_HASH_SIZE - 1); entities->slots[i].block != BLOCK_AIR; i = (i + 1) & (ENTITY_HASH_SIZE - 1))
+	{
+		uint home = entity_hash(entities->slots[i].pos);
+		if (((i - home) & (ENTITY_HASH_SIZE - 1)) >= ((i - hole) & (ENTITY_HASH_SIZE - 1)))
 		{
-			chest = chests + i;
-			break;
+			entities->slots[hole] = entities->slots[i];
+			hole = i;
 		}
 	}
 
-	if (chest)
+	entities->slots[hole] = {};
+}
+
+ivec3 entity_pos(Block_Entities* entities, uint type, uint index)
+{
+	switch (type)
+	{
+	case ENTITY_CHEST   : return entities->chests  [index].pos;
+	case ENTITY_FURNACE : return entities->furnaces[index].pos;
+	case ENTITY_CRAFTING: return entities->tables  [index].pos;
+	case ENTITY_MACHINE : return entities->machines[index].pos;
+	case ENTITY_PIPE    : return entities->pipes   [index].pos;
+	}
+
+	return {};
+}
+Item* entity_items(Block_Entities* entities, Entity_Slot slot, uint* count) // everything a block entity holds
+{
+	switch (block_entity_type(slot.block))
+	{
+	case ENTITY_CHEST   : *count = NUM_CHEST_ITEMS; return entities->chests[slot.index].items;
+	case ENTITY_FURNACE : *count = 3 ; advance(entities->furnaces + slot.index, entities->tick); return &entities->furnaces[slot.index].in; // in, out, fuel
+	case ENTITY_CRAFTING: *count = 10; return entities->tables[slot.index].in; // in[9], out
+	case ENTITY_MACHINE : *count = 2 ; advance(entities->machines + slot.index, entities->tick); return &entities->machines[slot.index].in; // in, out
+	}
+
+	*count = 0;
+	return NULL;
+}
+
+bool create_entity(Block_Entities* entities, ivec3 pos, u16 block, u8 tier = TIER_ACTIVE) // false if there is no room left
+{
+	uint type = block_entity_type(block);
+	uint index = entities->counts[type];
+
+	switch (type)
+	{
+	case ENTITY_CHEST: {
+		if (index == MAX_CHESTS) return false;
+		entities->chests[index] = {};
+		entities->chests[index].pos = pos;
+		init(&entities->chests[index].inventory, entities->chests[index].items, NUM_CHEST_ITEMS);
+	} break;
+	case ENTITY_FURNACE: {
+		if (index == MAX_FURNACES) return false;
+		entities->furnaces[index] = {};
+		entities->furnaces[index].pos = pos;
+		entities->furnaces[index].tick = entities->tick;
+		entities->furnaces[index].tier = tier;
+	} break;
+	case ENTITY_CRAFTING: {
+		if (index == MAX_CRAFTING_TABLES) return false;
+		entities->tables[index] = {};
+		entities->tables[index].pos = pos;
+	} break;
+	case ENTITY_MACHINE: {
+		if (index == MAX_MACHINES) return false;
+		entities->machines[index] = {};
+		entities->machines[index].pos = pos;
+		entities->machines[index].block = block;
+		entities->machines[index].tick = entities->tick;
+		entities->machines[index].tier = tier;
+	} break;
+	case ENTITY_PIPE: {
+		if (index == MAX_PIPES) return false;
+		entities->pipes[index] = {};
+		entities->pipes[index].pos = pos;
+		entities->pipes[index].block = block;
+		entities->pipes[index].network = INVALID; // see connect_pipe()
+	} break;
+	default: return false;
+	}
+
+	Entity_Slot* slot = find_slot(entities, pos);
+	assert(slot->block == BLOCK_AIR);
+
+	*slot = { pos, block, index };
+	entities->counts[type]++;
+	return true;
+}
+void remove_entity(Block_Entities* entities, Entity_Slot* slot)
+{
+	uint type  = block_entity_type(slot->block);
+	uint index = slot->index;
+	uint last  = --entities->counts[type];
+
+	switch (type)
+	{
+	case ENTITY_CHEST   : entities->chests  [index] = entities->chests  [last]; break;
+	case ENTITY_FURNACE : entities->furnaces[index] = entities->furnaces[last]; break;
+	case ENTITY_CRAFTING: entities->tables  [index] = entities->tables  [last]; break;
+	case ENTITY_MACHINE : entities->machines[index] = entities->machines[last]; break;
+	case ENTITY_PIPE    : entities->pipes   [index] = entities->pipes   [last]; break;
+	}
+
+	remove_slot(entities, slot);
+
+	if (index != last) // the last one moved, point its slot at the new index
+		find_slot(entities, entity_pos(entities, type, index))->index = index;
+}
+
+Chest* get_chest(Block_Entities* entities, ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	return block_entity_type(slot->block) == ENTITY_CHEST ? entities->chests + slot->index : NULL;
+}
+Furnace* get_furnace(Block_Entities* entities, ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	return block_entity_type(slot->block) == ENTITY_FURNACE ? entities->furnaces + slot->index : NULL;
+}
+Crafting_Table* get_crafting_table(Block_Entities* entities, ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	return block_entity_type(slot->block) == ENTITY_CRAFTING ? entities->tables + slot->index : NULL;
+}
+Machine* get_machine(Block_Entities* entities, ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	return block_entity_type(slot->block) == ENTITY_MACHINE ? entities->machines + slot->index : NULL;
+}
+Pipe* get_pipe(Block_Entities* entities, ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	return block_entity_type(slot->block) == ENTITY_PIPE ? entities->pipes + slot->index : NULL;
+}
+
+Item get_next_item(Block_Entities* entities, ivec3 pos)
+{
+	Chest* chest = get_chest(entities, pos);
+	if (!chest) return Item{};
+
+	uint slot = first_item(&chest->inventory);
+	if (slot == INVALID) return Item{}; // chest is empty
+
+	return take(&chest->inventory, chest->items, slot, 1);
+}
+bool wants_item(Block_Entities* entities, ivec3 pos, Item item) // whether it can do anything with 'item', full or not
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+
+	switch (block_entity_type(slot->block))
+	{
+	case ENTITY_CHEST  : return true;
+	case ENTITY_FURNACE: return find_recipe(&recipes, BLOCK_FURNACE, item) != NULL;
+	case ENTITY_MACHINE: {
+		u16 block = entities->machines[slot->index].block;
+		return (block == BLOCK_GENERATOR) ? fuel_ticks(item) > 0 : find_recipe(&recipes, block, item) != NULL;
+	}
+	default: return false;
+	}
+}
+bool store_item(Block_Entities* entities, ivec3 pos, Item item) // false if there is no room for it, or no use
+{
+	if (!wants_item(entities, pos, item)) return false; // it would sit in the input forever
+	Entity_Slot* slot = find_slot(entities, pos);
+
+	switch (block_entity_type(slot->block))
 	{
-		for (uint i = 0; i < NUM_CHEST_ITEMS; i++)
+	case ENTITY_CHEST: {
+		Chest* chest = entities->chests + slot->index;
+
+		uint given = give(&chest->inventory, chest->items, item);
+		if (given == item.count) return true;
+
+		item.count = given; // all or nothing
+		take(&chest->inventory, chest->items, item);
+	} break;
+	case ENTITY_FURNACE: { // catch up before changing it, & again to see if that gave it something to do
+		Furnace* furnace = entities->furnaces + slot->index;
+		advance(furnace, entities->tick);
+
+		if (!stack(&furnace->in, item)) return false;
+		advance(furnace, entities->tick);
+		return true;
+	}
+	case ENTITY_MACHINE: {
+		Machine* machine = entities->machines + slot->index;
+		advance(machine, entities->tick);
+
+		if (!stack(&machine->in, item)) return false;
+		advance(machine, entities->tick);
+		return true;
+	}
+	}
+
+	return false;
+}
+
+// transport networks
+
+uint new_network(Transport* transport, u16 block, ivec3 root)
+{
+	uint network = transport->num_free_networks ? transport->free_networks[--transport->num_free_networks] : transport->num_networks++;
+	assert(network < MAX_NETWORKS);
+
+	transport->networks[network] = {};
+	transport->networks[network].block = block;
+	transport->networks[network].generation = ++transport->generations;
+	transport->networks[network].root = root;
+	return network;
+}
+void free_network(Transport* transport, uint network)
+{
+	transport->networks[network] = {};
+	transport->free_networks[transport->num_free_networks++] = network;
+}
+void mark_dirty(Transport* transport, uint network)
+{
+	Network* net = transport->networks + network;
+	if (net->dirty) return;
+
+	net->dirty = true;
+	transport->dirty[transport->num_dirty++] = network;
+}
+
+// visits every segment connected to 'start' that is in 'network' (& the same kind), moving it to 'relabel'.
+// the visited segments are left in transport->queue, returns how many there are
+uint flood(Block_Entities* entities, ivec3 start, uint network, uint relabel)
+{
+	Transport* transport = &entities->transport;
+	uint visit = ++transport->visit;
+	uint head = 0, tail = 0;
+
+	Pipe* first = get_pipe(entities, start);
+	first->visit = visit;
+	first->network = relabel;
+	transport->queue[tail++] = start;
+
+	while (head < tail)
+	{
+		ivec3 pos = transport->queue[head++];
+
+		for (uint face = 0; face < 6; face++)
 		{
-			if (chest->items[i].type == NULL) continue;
+			Pipe* next = get_pipe(entities, pos + FACE_DIRS[face]);
+			if (!next || next->visit == visit || next->network != network || next->block != first->block) continue;
+
+			next->visit = visit;
+			next->network = relabel;
+			transport->queue[tail++] = next->pos;
+		}
+	}
 
-			Item ret = chest->items[i];
+	return tail;
+}
 
-			if (chest->items[i].count > 1)
-			{
-				ret.count = 1;
-				return ret;
-			}
-			else
-			{
-				chest->items[i] = {};
-				return ret;
-			}
+void rebuild_networks(Block_Entities* entities) // from scratch
+{
+	Transport* transport = &entities->transport;
+
+	for (uint i = 0; i < transport->num_networks; i++)
+		if (transport->networks[i].block) free_network(transport, i);
+
+	uint num_pipes = entities->counts[ENTITY_PIPE];
+	for (uint i = 0; i < num_pipes; i++)
+		entities->pipes[i].network = INVALID;
+
+	for (uint i = 0; i < num_pipes; i++)
+	{
+		Pipe* pipe = entities->pipes + i;
+		if (pipe->network != INVALID) continue;
+
+		uint network = new_network(transport, pipe->block, pipe->pos);
+		transport->networks[network].num_pipes = flood(entities, pipe->pos, INVALID, network);
+		mark_dirty(transport, network);
+	}
+
+	transport->num_splits = 0;
+	transport->splits_overflow = false;
+}
+void split_networks(Block_Entities* entities) // checks the pending splits
+{
+	Transport* transport = &entities->transport;
+	if (transport->splits_overflow) { rebuild_networks(entities); return; }
+
+	uint first_visit = transport->visit + 1; // searches from before this call don't count
+
+	for (uint i = 0; i < transport->num_splits; i++)
+	{
+		Pipe* pipe = get_pipe(entities, transport->splits[i]);
+		if (!pipe || pipe->network == INVALID) continue; // removed too
+
+		uint network = pipe->network;
+		Network* net = transport->networks + network;
+
+		if (net->visit < first_visit) // first time the network is seen : whatever this reaches stays in it
+		{
+			net->num_pipes = flood(entities, pipe->pos, network, network);
+			net->visit = transport->visit;
+			net->root = pipe->pos;
 		}
+		else if (pipe->visit != net->visit) // not reached from the rest, it was cut off
+		{
+			uint split = new_network(transport, net->block, pipe->pos);
+			transport->networks[split].num_pipes = flood(entities, pipe->pos, network, split);
+			transport->networks[split].visit = transport->visit;
+			mark_dirty(transport, split);
+		}
+	}
+
+	transport->num_splits = 0;
+}
+
+void connect_pipe(Block_Entities* entities, ivec3 pos) // after the segment was created
+{
+	Transport* transport = &entities->transport;
+	if (transport->num_splits || transport->splits_overflow) split_networks(entities); // so roots can reach all of their network
+
+	Pipe* pipe = get_pipe(entities, pos);
+	uint network = INVALID;
+
+	for (uint face = 0; face < 6; face++)
+	{
+		Pipe* next = get_pipe(entities, pos + FACE_DIRS[face]);
+		if (!next || next->block != pipe->block || next->network == network) continue;
+
+		if (network == INVALID) { network = next->network; continue; }
+
+		// joins 2 networks, the smaller one is moved into the bigger one
+		uint a = network, b = next->network;
+		if (transport->networks[a].num_pipes < transport->networks[b].num_pipes) { a = b; b = network; }
+
+		transport->networks[a].num_pipes += flood(entities, transport->networks[b].root, b, a);
+		free_network(transport, b);
+		network = a;
 	}
 
-	return Item{}; // chest is empty
+	if (network == INVALID)
+		network = new_network(transport, pipe->block, pos);
+
+	pipe->network = network;
+	transport->networks[network].num_pipes++;
+	mark_dirty(transport, network);
 }
-void store_item(Chest* chests, Item item) {}
+void disconnect_pipe(Block_Entities* entities, ivec3 pos) // before the segment is removed
+{
+	Transport* transport = &entities->transport;
+
+	Pipe* pipe = get_pipe(entities, pos);
+	uint network = pipe->network;
+	Network* net = transport->networks + network;
 
-// making these should be an interesting logic puzzle
+	pipe->network = INVALID; // searches stop here
+	if (--net->num_pipes == 0) { free_network(transport, network); return; }
 
-// general purpose(?)
-#define UP		0x1
-#define DOWN	0x2
-#define LEFT	0x4
-#define RIGHT	0x8
-#define FRONT	0x16
-#define BACK	0x32
+	mark_dirty(transport, network);
 
-#define MAX_PIPES 1
+	uint num_next = 0;
+	ivec3 next[6];
 
-struct Pipe
+	for (uint face = 0; face < 6; face++)
+	{
+		Pipe* p = get_pipe(entities, pos + FACE_DIRS[face]);
+		if (p && p->network == network) next[num_next++] = p->pos;
+	}
+
+	if (num_next) net->root = next[0];
+	if (num_next < 2 && transport->num_splits == 0) return; // can't have split (with splits pending, a piece may only be reachable from here)
+
+	for (uint i = 0; i < num_next; i++)
+	{
+		if (transport->num_splits == MAX_PENDING_SPLITS) { transport->splits_overflow = true; return; }
+		transport->splits[transport->num_splits++] = next[i];
+	}
+}
+void touch_networks(Block_Entities* entities, ivec3 pos) // an inventory next to 'pos' may have changed
 {
-	uint type;
-	uint inputs;
-	uvec3 coords;
+	for (uint face = 0; face < 6; face++)
+	{
+		Pipe* pipe = get_pipe(entities, pos + FACE_DIRS[face]);
+		if (pipe && pipe->network != INVALID) mark_dirty(&entities->transport, pipe->network);
+	}
+}
 
-	float progress;
-	Item item;
-	uint dir;
-};
+// routing : a chest under a pipe feeds the network, every other inventory next to it is fed by it.
+// one search outwards from all of those inventories at once gives every pipe its nearest one
+
+bool accepts_items(Block_Entities* entities, ivec3 pos, uint face) // the inventory next to a pipe, through 'face'
+{
+	switch (block_entity_type(find_slot(entities, pos + FACE_DIRS[face])->block))
+	{
+	case ENTITY_CHEST  : return face != FACE_NEG_Y; // chests under pipes are sources
+	case ENTITY_FURNACE:
+	case ENTITY_MACHINE: return true;
+	default: return false;
+	}
+}
+uint ticks_per_block(u16 block) { return (block == BLOCK_BELT) ? BELT_TICKS_PER_BLOCK : PIPE_TICKS_PER_BLOCK; }
+
+uint alloc_event(Transport* transport) // 1 + index, 0 if there is no room
+{
+	if (transport->free_events)
+	{
+		uint event = transport->free_events;
+		transport->free_events = transport->events[event - 1].next;
+		return event;
+	}
+
+	return (transport->num_events < MAX_TRANSPORT_EVENTS) ? ++transport->num_events : 0;
+}
+void free_event(Transport* transport, uint index)
+{
+	transport->events[index].next = transport->free_events;
+	transport->free_events = index + 1;
+}
+void schedule(Transport* transport, uint index, uint tick)
+{
+	Transport_Event* event = transport->events + index;
+	uint* slot = transport->wheel + (tick & (TIMING_WHEEL_SIZE - 1));
+
+	event->tick = tick;
+	event->next = *slot;
+	*slot = index + 1;
+}
 
-void update(Pipe* pipes, float dt)
+void route(Block_Entities* entities, uint network)
 {
-	for (uint i = 0; i < MAX_PIPES; i++)
+	Transport* transport = &entities->transport;
+	Network* net = transport->networks + network;
+
+	net->dirty = false;
+	net->generation = ++transport->generations; // drops the extract events of the old routes
+	if (net->block == BLOCK_AIR) return; // freed
+
+	uint num_pipes = flood(entities, net->root, network, network);
+
+	if (net->block == BLOCK_WIRE) // carries power, not items : put every machine next to it on the grid
 	{
-		if (pipes[i].type == NULL) continue;
+		for (uint i = 0; i < num_pipes; i++)
+		for (uint face = 0; face < 6; face++)
+		{
+			Machine* machine = get_machine(entities, transport->queue[i] + FACE_DIRS[face]);
+			if (!machine) continue;
+
+			machine->grid = network;
+			machine->grid_generation = net->generation;
+		}
+
+		return;
+	}
+	uint num_frontier = 0;
+
+	for (uint i = 0; i < num_pipes; i++)
+	{
+		Pipe* pipe = get_pipe(entities, transport->queue[i]);
+		pipe->distance = 0;
 
-		if (pipes[i].item.type) // pipe is transporting
+		for (uint face = 0; face < 6; face++)
 		{
-			pipes[i].progress += dt;
+			if (!accepts_items(entities, pipe->pos, face)) continue;
 
-			if (pipes[i].progress > 1) // deposit item
-			{
-				// store_item(chests, [depends on dir])
-			}
+			pipe->distance = 1;
+			pipe->target = pipe->pos + FACE_DIRS[face];
+			transport->frontier[num_frontier++] = pipe->pos;
+			break;
 		}
-		else if (pipes[i].inputs & DOWN) // pipe is empty
+	}
+
+	for (uint head = 0; head < num_frontier; head++)
+	{
+		Pipe* pipe = get_pipe(entities, transport->frontier[head]);
+
+		for (uint face = 0; face < 6; face++)
+		{
+			Pipe* next = get_pipe(entities, pipe->pos + FACE_DIRS[face]);
+			if (!next || next->network != network || next->distance) continue;
+
+			next->distance = pipe->distance + 1;
+			next->target = pipe->target;
+			transport->frontier[num_frontier++] = next->pos;
+		}
+	}
+
+	for (uint i = 0; i < num_pipes; i++) // sources
+	{
+		Pipe* pipe = get_pipe(entities, transport->queue[i]);
+		if (!pipe->distance || !get_chest(entities, pipe->pos - ivec3(0, 1, 0))) continue;
+
+		uint event = alloc_event(transport);
+		if (!event) break;
+
+		transport->events[event - 1] = { 0, 0, EVENT_EXTRACT, (u16)network, net->generation, pipe->pos };
+		schedule(transport, event - 1, transport->tick + 1 + (i % EXTRACT_TICKS)); // spread them out
+	}
+}
+
+void tick_transport(Block_Entities* entities)
+{
+	Transport* transport = &entities->transport;
+
+	if (transport->num_splits || transport->splits_overflow)
+		split_networks(entities);
+
+	for (uint i = 0; i < transport->num_dirty; i++)
+		if (transport->networks[transport->dirty[i]].dirty) route(entities, transport->dirty[i]);
+	transport->num_dirty = 0;
+
+	uint tick = ++transport->tick;
+	uint* slot = transport->wheel + (tick & (TIMING_WHEEL_SIZE - 1));
+
+	uint next = *slot;
+	*slot = 0;
+
+	while (next)
+	{
+		uint index = next - 1;
+		Transport_Event* event = transport->events + index;
+		next = event->next;
+
+		if (event->tick != tick) { schedule(transport, index, event->tick); continue; } // a later time around the wheel
+
+		switch (event->type)
 		{
-			pipes[i].item = {};// get_next_item(chests, coords - uvec3(0, 1, 0));
+		case EVENT_EXTRACT: {
+			Network* net = transport->networks + event->network;
+			if (net->block == BLOCK_AIR || net->generation != event->generation) { free_event(transport, index); break; }
+
+			Pipe* pipe = get_pipe(entities, event->pos);
+			uint arrive = alloc_event(transport);
+
+			if (arrive)
+			{
+				Item item = get_next_item(entities, event->pos - ivec3(0, 1, 0));
+
+				if (item.type)
+				{
+					transport->events[arrive - 1] = { 0, 0, EVENT_ARRIVE, event->network, event->generation, pipe->target, item };
+					schedule(transport, arrive - 1, tick + (pipe->distance * ticks_per_block(net->block)));
+				}
+				else free_event(transport, arrive - 1);
+			}
+
+			schedule(transport, index, tick + EXTRACT_TICKS);
+		} break;
+		case EVENT_ARRIVE: {
+			if (store_item(entities, event->pos, event->item)) { free_event(transport, index); break; }
+
+			// full : wait for room, for a while. gone, or replaced by something that never takes it : dropped there
+			bool full = wants_item(entities, event->pos, event->item);
+			if ((full && event->retries < MAX_DELIVERY_RETRIES) || transport->num_drops == MAX_TRANSPORT_DROPS)
+			{
+				event->retries += full;
+				schedule(transport, index, tick + DELIVERY_RETRY_TICKS);
+				break;
+			}
+
+			bool gone = find_slot(entities, event->pos)->block == BLOCK_AIR;
+			transport->drops   [transport->num_drops] = event->item;
+			transport->drop_pos[transport->num_drops++] = gone ? event->pos : event->pos + ivec3(0, 1, 0); // on top of it
+			free_event(transport, index);
+		} break;
 		}
 	}
-}
\ No newline at end of file
+}
+
+// power : every machine next to a wire network is on that network's grid. each tick the grid's supply
+// is shared out over its demand, every machine gets the same fraction of what it asked for. machines that
+// use power don't work at all off a grid. one that is stepped less often (see tick_entities()) is caught
+// up whenever its power changes, so it worked at the power every tick really had. what it asks for is
+// only updated when it steps though, it keeps asking until its next step after it runs out of work
+
+#define GENERATOR_POWER	32 // power units
+#define SOLAR_POWER		8
+
+float power_demand(u16 block)
+{
+	switch (block)
+	{
+	case BLOCK_QUARRY      : return 16;
+	case BLOCK_RECYCLER    : return 8;
+	case BLOCK_CRUSHER     : return 8;
+	case BLOCK_WASHER      : return 4;
+	case BLOCK_SMELTER     : return 12;
+	case BLOCK_PUMP        : return 4;
+	case BLOCK_ASSEMBLER   : return 8;
+	case BLOCK_OIL_REFINERY: return 24;
+	default: return 0;
+	}
+}
+float power_supply(Machine* machine)
+{
+	switch (machine->block)
+	{
+	case BLOCK_GENERATOR  : return machine->busy ? GENERATOR_POWER : 0; // fuel is burnt in advance(), busy = some left
+	case BLOCK_SOLAR_PANEL: return SOLAR_POWER; // constant, there is no day / night cycle & covering the panel doesn't matter
+	default: return 0;
+	}
+}
+
+void tick_power(Block_Entities* entities)
+{
+	Transport* transport = &entities->transport;
+	uint tick = entities->tick;
+
+	Machine* machines = entities->machines;
+	uint num_machines = entities->counts[ENTITY_MACHINE];
+
+	for (uint i = 0; i < num_machines; i++) // totals
+	{
+		Machine* machine = machines + i;
+		Network* grid = transport->networks + machine->grid;
+		if (grid->block != BLOCK_WIRE || grid->generation != machine->grid_generation) continue;
+
+		if (grid->power_tick != tick) { grid->supply = grid->demand = 0; grid->power_tick = tick; }
+		if (machine->block == BLOCK_GENERATOR && machine->tick + 1 < tick) advance(machine, tick - 1); // fuel as of last tick
+
+		grid->supply += power_supply(machine);
+		if (machine->busy) grid->demand += power_demand(machine->block);
+	}
+
+	for (uint i = 0; i < num_machines; i++) // share it out
+	{
+		Machine* machine = machines + i;
+		Network* grid = transport->networks + machine->grid;
+
+		float power = 0;
+		if (grid->block == BLOCK_WIRE && grid->generation == machine->grid_generation)
+			power = (grid->supply >= grid->demand) ? 1 : grid->supply / grid->demand;
+
+		if (power != machine->power && machine->tick + 1 < tick) advance(machine, tick - 1); // the ticks it owes ran at the old power
+		machine->power = power;
+	}
+}
+
+void update_tiers(Block_Entities* entities, Chunk_Lookup* lookup) // after chunks were loaded / unloaded
+{
+	for (uint i = 0; i < entities->counts[ENTITY_FURNACE]; i++)
+		entities->furnaces[i].tier = lookup->tiers[find_block(lookup, entities->furnaces[i].pos) / NUM_CHUNK_BLOCKS];
+
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++)
+		entities->machines[i].tier = lookup->tiers[find_block(lookup, entities->machines[i].pos) / NUM_CHUNK_BLOCKS];
+}
+
+void tick_entities(Block_Entities* entities)
+{
+	uint tick = ++entities->tick;
+
+	for (uint i = 0; i < entities->counts[ENTITY_CRAFTING]; i++)
+		entities->tables[i].out = craft(&recipes, entities->tables[i].in);
+
+	tick_transport(entities);
+	tick_power(entities);
+
+	// machines in chunks that are ticked less often are caught up in bigger steps, primed ones only when looked at
+	for (uint i = 0; i < entities->counts[ENTITY_FURNACE]; i++)
+	{
+		Furnace* furnace = entities->furnaces + i;
+		uint rate = TIER_TICK_RATE[furnace->tier];
+		if (furnace->busy && rate && (tick % rate) == 0) advance(furnace, tick);
+	}
+
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++)
+	{
+		Machine* machine = entities->machines + i;
+		uint rate = TIER_TICK_RATE[machine->tier];
+		if (machine->busy && rate && (tick % rate) == 0) advance(machine, tick);
+	}
+}
@@ -2,6 +2,8 @@
 
 int main()
 {
+	open_asset_pack("assets.pack"); // if there isn't one, assets are loaded from their files
+
 	Window   window = {};
 	Mouse    mouse  = {};
 	Keyboard keys   = {};
@@ -16,11 +18,13 @@ int main()
 	Player* player = Alloc(Player, 1);
 	init(player);
 
+	load_recipes(&recipes, "assets/recipes.txt");
+
 	World* world = Alloc(World, 1);
 	init(world, player->eyes.position);
 
 	World_Renderer* world_renderer = Alloc(World_Renderer, 1);
-	init(world_renderer);
+	init(world_renderer, world->items.capacity);
 
 	GUI_Renderer* gui = Alloc(GUI_Renderer, 1);
 	init(gui);
@@ -33,11 +37,15 @@ int main()
 	};
 
 	G_Buffer g_buffer = make_g_buffer(window);
-	Shader lighting_shader = make_lighting_shader();
+	Shader lighting_shader = {};
+	load_lighting_shader(&lighting_shader);
+	GLuint frame_uniforms = make_frame_uniforms();
+	Render_Queue* render_queue = Alloc(Render_Queue, 1);
+	Light_Clusters* light_clusters = Alloc(Light_Clusters, 1);
+	init(light_clusters);
+	float time = 0;
 	mat4 proj = perspective(FOV, (float)window.screen_width / window.screen_height, 0.1f, DRAW_DISTANCE);
 
-	Chest chest = {};
-
 	// frame timer
 	float frame_time = 1.f / 60;
 	int64 target_frame_milliseconds = frame_time * 1000.f; // seconds * 1000 = milliseconds
@@ -50,14 +58,15 @@ int main()
 		update(&keys, window);
 
 		// game updates
-		update(player, world, keys, mouse, frame_time, emitter, pops, gui->icons);
-		update(emitter, frame_time, vec3(0));
-		update(world, player->eyes, mouse, frame_time, player->items, pops);
+		update(player, world, keys, mouse, frame_time, emitter, pops, gui);
+		update(emitter, &world->chunks, frame_time, vec3(0));
+		update(world, player->eyes, mouse, frame_time, &player->storage, player->items, pops);
 
 		// renderer updates
+		update(&hot_reloader, frame_time); // changed shaders, textures & meshes
 		update(particle_renderer , emitter);
 		update(world_renderer, world, frame_time);
-		update(gui, mouse, player->items, player->action, player->selected_item, chest.items);// player->opened_items);
+		update(gui, mouse, player->items, player->action, player->selected_item, player->opened_items);
 
 		if (player->status != STATUS_IN_MENU)
 			disable_cursor(window);
@@ -67,19 +76,29 @@ int main()
 		// geometry pass
 		glBindFramebuffer(GL_FRAMEBUFFER, g_buffer.FBO);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		mat4 proj_view = proj * lookAt(player->eyes.position, player->eyes.position + player->eyes.front, player->eyes.up);
-		
-		draw(particle_renderer, proj_view);
-		draw(world_renderer   , proj_view, frame_time);
+		mat4 view = lookAt(player->eyes.position, player->eyes.position + player->eyes.front, player->eyes.up);
+		mat4 proj_view = proj * view;
+		time += frame_time;
+		update(frame_uniforms, { proj_view, player->eyes.position, time });
+
+		gather_lights(light_clusters, &world->entities, player->eyes.position);
+		update(light_clusters, view, proj);
+
+		clear(render_queue, player->eyes.position);
+		draw(particle_renderer, render_queue);
+		draw(world_renderer, render_queue);
+		draw(gui, render_queue);
+
+		draw(render_queue, PASS_GEOMETRY);
 
 		// lighting pass
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		bind(lighting_shader);
-		set_vec3(lighting_shader, "view_pos", player->eyes.position);
+		bind(light_clusters);
 		draw(g_buffer);
-		draw(gui);
+		draw(render_queue, PASS_GUI);
 
 		// frame time
 		frame_end = get_timestamp();
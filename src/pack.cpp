@@ -0,0 +1,12 @@
+#include <proprietary/boilerplate.h>
+
+// builds the asset pack the game maps at startup : pack [list] [pack]
+// run it from the folder the game runs in, so the paths match
+
+int main(int argc, char** argv)
+{
+	const char* list_path = argc > 1 ? argv[1] : "assets/pack.txt";
+	const char* pack_path = argc > 2 ? argv[2] : "assets.pack";
+
+	return pack_assets(list_path, pack_path) ? 0 : 1;
+}
@@ -2,7 +2,10 @@
 
 #define GRAVITY -9.80665f
 
+#ifndef MAX_PARTICLES // define it before including this to change it, the emitter & particle renderer grow with it
 #define MAX_PARTICLES 512
+#endif
+static_assert(MAX_PARTICLES <= 65536, "particle indices are u16s");
 
 #define PARTICLE_DEBRIS	1
 #define PARTICLE_FIRE	2
@@ -23,6 +26,11 @@ struct Particle
 struct Particle_Emitter
 {
 	Particle particles[MAX_PARTICLES];
+
+	// scratch for block collision, see update(Particle_Emitter*, Chunk_Loader*)
+	u16  colliders[MAX_PARTICLES]; // indices of particles that need block collision
+	vec3 test_points[MAX_PARTICLES];
+	u16  test_blocks[MAX_PARTICLES];
 };
 
 void emit_cone(Particle_Emitter* emitter, vec3 pos, vec3 dir, uint type, float radius = 1, float speed = 1)
@@ -93,6 +101,49 @@ void emit_fire(Particle_Emitter* emitter, vec3 pos)
 	for (uint i = 0; i < num; i++) { emit_circle(emitter, pos, PARTICLE_FIRE, .3); }
 }
 
+void apply_forces(Particle* particle, float dtime)
+{
+	switch (particle->type)
+	{
+	case PARTICLE_SMOKE:
+	{
+		particle->velocity.y -= GRAVITY * .1 * dtime;
+	} break;
+	case PARTICLE_SPARK :
+	{
+		particle->velocity.y += GRAVITY * .3 * dtime;
+	} break;
+	case PARTICLE_DEBRIS:
+	case PARTICLE_BLOOD :
+	{
+		particle->velocity.y += GRAVITY * .1 * dtime;
+	} break;
+	}
+}
+
+// particles that can bounce off of / settle on blocks (see update(Particle_Emitter*, Chunk_Loader*) in chunk.h)
+bool particle_collides(uint type)
+{
+	switch (type)
+	{
+	case PARTICLE_DEBRIS:
+	case PARTICLE_SPARK :
+	case PARTICLE_BLOOD : return true;
+	}
+
+	return false;
+}
+float particle_bounciness(uint type) // fraction of velocity kept after hitting a block
+{
+	switch (type)
+	{
+	case PARTICLE_SPARK : return .5f;
+	case PARTICLE_DEBRIS: return .3f;
+	}
+
+	return 0; // blood just sticks
+}
+
 void update(Particle_Emitter* emitter, float dtime, vec3 wind = vec3(0))
 {
 	Particle* particles = emitter->particles;
@@ -101,22 +152,7 @@ void update(Particle_Emitter* emitter, float dtime, vec3 wind = vec3(0))
 	{
 		if (particles[i].type != NULL && particles[i].time_alive < particles[i].max_age)
 		{
-			switch (particles[i].type)
-			{
-			case PARTICLE_SMOKE:
-			{
-				particles[i].velocity.y -= GRAVITY * .1 * dtime;
-			} break;
-			case PARTICLE_SPARK :
-			{
-				particles[i].velocity.y += GRAVITY * .3 * dtime;
-			} break;
-			case PARTICLE_DEBRIS:
-			case PARTICLE_BLOOD :
-			{
-				particles[i].velocity.y += GRAVITY * .1 * dtime;
-			} break;
-			}
+			apply_forces(particles + i, dtime);
 
 			particles[i].position += (particles[i].velocity + wind) * dtime;
 			particles[i].time_alive += dtime;
@@ -214,9 +250,7 @@ void update(Particle_Renderer* renderer, Particle_Emitter* emitter)
 
 	update(renderer->cube, sizeof(Particle_Drawable) * MAX_PARTICLES, (byte*)(&renderer->particles));
 }
-void draw(Particle_Renderer* renderer, mat4 proj_view)
+void draw(Particle_Renderer* renderer, Render_Queue* queue) // proj_view comes from the frame uniforms
 {
-	bind(renderer->shader);
-	set_mat4(renderer->shader, "proj_view", proj_view);
-	draw(renderer->cube, MAX_PARTICLES);
+	submit(queue, PASS_GEOMETRY, renderer->shader, renderer->cube.VAO, renderer->cube.num_indices, MAX_PARTICLES);
 }
@@ -12,6 +12,7 @@ struct Player
 {
 	Camera eyes;
 	union { struct { Item hotbar[NUM_HOTBAR_ITEMS]; Item inventory[NUM_INVENTORY_ITEMS]; }; Item items[NUM_PLAYER_ITEMS]; };
+	Inventory storage; // bookkeeping for items[], change them through it
 	struct { float attack, mine; } power;
 
 	uint status, action;
@@ -30,8 +31,9 @@ void init(Player* player)
 	player->eyes = { {116, 48, 116} };
 	player->inventory[0]  = Item{ ITEM_BLOCK, BLOCK_STONE, 1 };
 	player->inventory[16] = Item{ ITEM_BLOCK, BLOCK_FURNACE, 1 };
+	init(&player->storage, player->items, NUM_PLAYER_ITEMS);
 }
-void update(Player* player, World* world, Keyboard keys, Mouse mouse, float dt, Particle_Emitter* emitter, Audio* pops, Icon_Drawable* icons)
+void update(Player* player, World* world, Keyboard keys, Mouse mouse, float dt, Particle_Emitter* emitter, Audio* pops, GUI_Renderer* gui)
 {
 	switch (player->status)
 	{
@@ -61,7 +63,7 @@ neutral:
 	{
 		u16 block = get_block_raycast(&world->chunks, player->eyes.position, player->eyes.front);
 
-		if (block == BLOCK_WATER)
+		if (is_fluid(block))
 			return;
 
 		switch (player->hotbar[player->equipped_item].id)
@@ -70,7 +72,7 @@ neutral:
 		default: { // break block
 			vec3 break_pos = {};
 			block = break_block_raycast(&world->chunks, player->eyes.position, player->eyes.front, &break_pos);
-			spawn(world->items, Item{ ITEM_BLOCK, block, 1 }, break_pos);
+			spawn(&world->items, Item{ ITEM_BLOCK, block, 1 }, break_pos);
 			emit_blockbreak(emitter, break_pos);
 			play_audio(pops[3]);
 		}
@@ -103,8 +105,10 @@ in_menu:
 		return;
 	}
 
+	player->crafting[9] = craft(&recipes, player->crafting);
+
 	int selected_index = player->selected_item;
-	int hovered_index  = gui_item_index(icons, mouse, selected_index);
+	int hovered_index  = gui_item_index(gui, mouse, selected_index);
 
 	if (hovered_index >= NUM_PLAYER_ITEMS) out("not on player");
 
@@ -112,8 +116,14 @@ in_menu:
 	{
 		if (FirstPress(mouse.left_button))
 		{
-			if (hovered_index < 0 || player->items[hovered_index].type == NULL)
+			if (hovered_index < 0 || hovered_index >= NUM_PLAYER_ITEMS || player->items[hovered_index].type == NULL)
 				return;
+			else if (keys.SHIFT.is_pressed) // move the stack between the hotbar & the backpack
+			{
+				uint64 hotbar = slot_mask(0, NUM_HOTBAR_ITEMS);
+				uint64 backpack = slot_mask(NUM_HOTBAR_ITEMS, NUM_INVENTORY_ITEMS);
+				transfer(&player->storage, player->items, hovered_index, &player->storage, player->items, (hovered_index < NUM_HOTBAR_ITEMS) ? backpack : hotbar);
+			}
 			else
 				player->selected_item = hovered_index;
 		}
@@ -126,19 +136,23 @@ in_menu:
 				return;
 			else if (hovered_index == selected_index) // put it back
 				player->selected_item = -1;
-			else // TODO : Handle items that are not in player items
+			else if (hovered_index >= NUM_PLAYER_ITEMS) // TODO : Handle items that are not in player items
+				return;
+			else
 			{
-				if (player->items[hovered_index].type) // swap
+				Item* items = player->items;
+
+				if (items[hovered_index].type) // swap
 				{
-					Item temp = player->items[selected_index];
-					player->items[selected_index] = player->items[hovered_index];
-					player->items[hovered_index] = temp;
+					Item temp = items[selected_index];
+					set_slot(&player->storage, items, selected_index, items[hovered_index]);
+					set_slot(&player->storage, items, hovered_index, temp);
 				}
 				else // deposit
 				{
 					player->selected_item = -1;
-					player->items[hovered_index] = player->items[selected_index];
-					player->items[selected_index] = {};
+					set_slot(&player->storage, items, hovered_index, items[selected_index]);
+					set_slot(&player->storage, items, selected_index, {});
 				}
 			}
 		}
@@ -146,17 +160,3 @@ in_menu:
 
 	return;
 }
-
-uint give_player_item(Item* player_items, Item item)
-{
-	for (uint i = 0; i < NUM_PLAYER_ITEMS; i++)
-	{
-		if (player_items[i].type == NULL)
-		{
-			player_items[i] = item;
-			return 1; // should this be an index or something
-		}
-	}
-
-	return 0; // no slot found
-}
\ No newline at end of file
@@ -1,15 +1,72 @@
 #include "window.h"
 
+#include <emmintrin.h> // sse2, for building mips
+
 #define DRAW_DISTANCE 1024.0f
 
 // -------------------- Shaders -------------------- //
 
-struct Shader { GLuint id; };
+// uniforms are found once when a shader is loaded (see reflect()) & set by id, so nothing is looked up by name
+// while drawing. a uniform a shader doesn't have is at -1, which gl ignores. to add one, give it an id & a name
+
+#define UNIFORM_TRANSFORM 0
+#define NUM_UNIFORMS      1
+
+const char* UNIFORM_NAMES[NUM_UNIFORMS] = { "transform" }; // arrays without the [0]
+
+// the per-frame values every shader can read, as the 'Frame' uniform block (std140)
+#define FRAME_UNIFORM_BINDING 2 // skeletons use 0 & 1
+
+struct Frame_Uniforms
+{
+	mat4 proj_view;
+	vec3 view_pos;
+	float time; // seconds
+};
+
+struct Shader
+{
+	GLuint id;
+	GLint uniforms[NUM_UNIFORMS]; // locations
+};
+
+void reflect(Shader* shader) // fills in the uniforms & ties the frame block to its binding
+{
+	for (uint u = 0; u < NUM_UNIFORMS; u++) shader->uniforms[u] = -1;
+	if (!shader->id) return;
+
+	GLint num_uniforms = 0;
+	glGetProgramiv(shader->id, GL_ACTIVE_UNIFORMS, &num_uniforms);
+
+	for (GLint i = 0; i < num_uniforms; i++)
+	{
+		char name[64] = {};
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(shader->id, i, sizeof(name), &length, &size, &type, name);
+
+		if (length > 3 && strcmp(name + length - 3, "[0]") == 0) name[length - 3] = 0; // arrays
+
+		for (uint u = 0; u < NUM_UNIFORMS; u++)
+			if (strcmp(name, UNIFORM_NAMES[u]) == 0) shader->uniforms[u] = glGetUniformLocation(shader->id, name);
+	}
+
+	GLuint frame_block = glGetUniformBlockIndex(shader->id, "Frame");
+	if (frame_block != GL_INVALID_INDEX) glUniformBlockBinding(shader->id, frame_block, FRAME_UNIFORM_BINDING);
+}
 
-void load(Shader* shader, const char* vert_path, const char* frag_path)
+GLuint compile_shader(const char* vert_path, const char* frag_path) // 0 if it didn't compile / link
 {
-	char* vert_source = (char*)read_text_file_into_memory(vert_path);
-	char* frag_source = (char*)read_text_file_into_memory(frag_path);
+	char* vert_source = (char*)open_asset(vert_path);
+	char* frag_source = (char*)open_asset(frag_path);
+	if (!vert_source || !frag_source)
+	{
+		out("ERROR : '" << (vert_source ? frag_path : vert_path) << "' NOT FOUND!");
+		close_asset((byte*)vert_source);
+		close_asset((byte*)frag_source);
+		return 0;
+	}
 
 	GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vert_shader, 1, &vert_source, NULL);
@@ -19,8 +76,12 @@ void load(Shader* shader, const char* vert_path, const char* frag_path)
 	glShaderSource(frag_shader, 1, &frag_source, NULL);
 	glCompileShader(frag_shader);
 
-	free(vert_source);
-	free(frag_source);
+	close_asset((byte*)vert_source);
+	close_asset((byte*)frag_source);
+
+	GLint vert_compiled = 0, frag_compiled = 0;
+	glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &vert_compiled);
+	glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &frag_compiled);
 
 	{
 		GLint log_size = 0;
@@ -44,20 +105,49 @@ void load(Shader* shader, const char* vert_path, const char* frag_path)
 		}
 	}
 
-	shader->id = glCreateProgram();
-	glAttachShader(shader->id, vert_shader);
-	glAttachShader(shader->id, frag_shader);
-	glLinkProgram (shader->id);
+	GLuint id = glCreateProgram();
+	glAttachShader(id, vert_shader);
+	glAttachShader(id, frag_shader);
+	glLinkProgram (id);
+
+	GLint linked = 0;
+	glGetProgramiv(id, GL_LINK_STATUS, &linked);
 
 	{
 		GLsizei length = 0;
 		char log[256] = {};
-		glGetProgramInfoLog(shader->id, 256, &length, log);
+		glGetProgramInfoLog(id, 256, &length, log);
 		if (length) out("SHADER PROGRAM ERROR:[" << vert_path << ", " << frag_path << "]\n\n" << log);
 	}
 
 	glDeleteShader(vert_shader);
 	glDeleteShader(frag_shader);
+
+	if (!vert_compiled || !frag_compiled || !linked)
+	{
+		glDeleteProgram(id);
+		return 0;
+	}
+
+	return id;
+}
+bool reload_shader(Hot_Reload* reload) // uniforms are set every frame, so they only have to be found again
+{
+	Shader* shader = (Shader*)reload->target;
+
+	GLuint id = compile_shader(reload->files[0].path, reload->files[1].path);
+	if (!id) return false;
+
+	glDeleteProgram(shader->id);
+	shader->id = id;
+	reflect(shader);
+	return true;
+}
+void load(Shader* shader, const char* vert_path, const char* frag_path) // 'shader' has to stay where it is
+{
+	shader->id = compile_shader(vert_path, frag_path);
+	reflect(shader);
+	watch(&hot_reloader, reload_shader, shader, 0, vert_path, frag_path);
 }
 void bind(Shader shader)
 {
@@ -69,74 +159,110 @@ void free(Shader shader)
 }
 
 // make sure you bind a shader *before* calling these!
-void set_int  (Shader shader, const char* name, int value  )
+void set_int  (Shader shader, uint uniform, int value  )
+{
+	glUniform1i(shader.uniforms[uniform], value);
+}
+void set_float(Shader shader, uint uniform, float value)
+{
+	glUniform1f(shader.uniforms[uniform], value);
+}
+void set_vec3 (Shader shader, uint uniform, vec3 value )
+{
+	glUniform3f(shader.uniforms[uniform], value.x, value.y, value.z);
+}
+void set_vec3 (Shader shader, uint uniform, vec3* values, uint count) // arrays
 {
-	glUniform1i(glGetUniformLocation(shader.id, name), value);
+	glUniform3fv(shader.uniforms[uniform], count, (float*)values);
 }
-void set_float(Shader shader, const char* name, float value)
+void set_mat3 (Shader shader, uint uniform, mat3 value )
 {
-	glUniform1f(glGetUniformLocation(shader.id, name), value);
+	glUniformMatrix3fv(shader.uniforms[uniform], 1, GL_FALSE, (float*)&value);
 }
-void set_vec3 (Shader shader, const char* name, vec3 value )
+void set_mat4 (Shader shader, uint uniform, mat4 value )
 {
-	glUniform3f(glGetUniformLocation(shader.id, name), value.x, value.y, value.z);
+	glUniformMatrix4fv(shader.uniforms[uniform], 1, GL_FALSE, (float*)&value);
 }
-void set_mat3 (Shader shader, const char* name, mat3 value)
+
+GLuint make_frame_uniforms() // bound for good, every shader with a 'Frame' block reads from it
 {
-	glUniformMatrix3fv(glGetUniformLocation(shader.id, name), 1, GL_FALSE, (float*)&value);
+	GLuint UBO = {};
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Uniforms), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, UBO);
+
+	return UBO;
 }
-void set_mat4 (Shader shader, const char* name, mat4 value )
+void update(GLuint frame_UBO, Frame_Uniforms frame) // once a frame, before anything is drawn
 {
-	glUniformMatrix4fv(glGetUniformLocation(shader.id, name), 1, GL_FALSE, (float*)&value);
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Uniforms), &frame);
 }
 
 // -------------------- Textures ------------------- //
 
-GLuint load_texture(const char* path, bool flip = true)
+// textures are re-uploaded into the same id when they are hot reloaded, so nothing that holds one has to change
+
+bool upload_texture(GLuint id, const char* path, bool flip, GLenum format) // false if it can't be read
 {
-	GLuint id = {};
 	int width, height, num_channels;
 	byte* image;
 
 	stbi_set_flip_vertically_on_load(flip);
 
-	image = stbi_load(path, &width, &height, &num_channels, 0);
-	if (image == NULL) out("ERROR : '" << path << "' NOT FOUND!");
+	uint size = 0;
+	byte* file = open_asset(path, &size);
+	if (file == NULL) return false;
+
+	image = stbi_load_from_memory(file, size, &width, &height, &num_channels, format == GL_RGBA ? 4 : 3);
+	close_asset(file);
+	if (image == NULL) return false;
+
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, format, GL_UNSIGNED_BYTE, image);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	stbi_image_free(image);
+	return true;
+}
+bool reload_texture(Hot_Reload* reload) // param = id | flip << 32 | rgba << 33
+{
+	GLuint id     = (GLuint)reload->param;
+	bool   flip   = (reload->param >> 32) & 1;
+	GLenum format = ((reload->param >> 33) & 1) ? GL_RGBA : GL_RGB;
+
+	return upload_texture(id, reload->files[0].path, flip, format);
+}
+GLuint load_texture(const char* path, bool flip = true)
+{
+	GLuint id = {};
 
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glGenerateMipmap(GL_TEXTURE_2D);
 
-	stbi_image_free(image);
+	if (!upload_texture(id, path, flip, GL_RGB)) out("ERROR : '" << path << "' NOT FOUND!");
+	watch(&hot_reloader, reload_texture, NULL, id | ((uint64)flip << 32), path);
 
 	return id;
 }
 GLuint load_texture_png(const char* path)
 {
 	GLuint id = {};
-	int width, height, num_channels;
-	byte* image;
-
-	stbi_set_flip_vertically_on_load(false);
-
-	image = stbi_load(path, &width, &height, &num_channels, 0);
-	if (image == NULL) out("ERROR : '" << path << "' NOT FOUND!");
 
 	glGenTextures(1, &id);
 	glBindTexture(GL_TEXTURE_2D, id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glGenerateMipmap(GL_TEXTURE_2D);
 
-	stbi_image_free(image);
+	if (!upload_texture(id, path, false, GL_RGBA)) out("ERROR : '" << path << "' NOT FOUND!");
+	watch(&hot_reloader, reload_texture, NULL, id | (1ull << 33), path);
 
 	return id;
 }
@@ -146,10 +272,117 @@ void bind_texture(GLuint texture, uint texture_unit = 0)
 	glBindTexture(GL_TEXTURE_2D, texture);
 }
 
+// texture arrays : square RGBA8 layers, each followed by its mip chain. the mips are built on the cpu so the
+// whole thing can be built once & uploaded as is. sizes must be powers of 2
+
+uint num_mips(uint size)
+{
+	uint n = 1;
+	for (; size > 1; size /= 2) n++;
+	return n;
+}
+uint mip_chain_size(uint size) // bytes for one layer & all of its mips
+{
+	uint bytes = 0;
+	for (; size; size /= 2) bytes += size * size * 4;
+	return bytes;
+}
+void downsample(byte* dst, const byte* src, uint size) // 2x2 box filter, rounded to nearest. dst is (size / 2)^2
+{
+	uint half = size / 2;
+	const __m128i two = _mm_set1_epi16(2), zero = _mm_setzero_si128();
+
+	for (uint y = 0; y < half; y++)
+	{
+		const byte* row0 = src + (2 * y * size * 4);
+		const byte* row1 = row0 + (size * 4);
+		byte* out = dst + (y * half * 4);
+		uint x = 0;
+
+		for (; x + 4 <= half; x += 4) // 8 source pixels per row -> 4 pixels
+		{
+			__m128i a0 = _mm_loadu_si128((__m128i*)(row0 + (x * 8))), a1 = _mm_loadu_si128((__m128i*)(row0 + (x * 8) + 16));
+			__m128i b0 = _mm_loadu_si128((__m128i*)(row1 + (x * 8))), b1 = _mm_loadu_si128((__m128i*)(row1 + (x * 8) + 16));
+
+			// vertical sums as 16 bits, 2 pixels per register
+			__m128i p01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+			__m128i p23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+			__m128i p45 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+			__m128i p67 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+			// horizontal pairs
+			__m128i lo = _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+			__m128i hi = _mm_add_epi16(_mm_unpacklo_epi64(p45, p67), _mm_unpackhi_epi64(p45, p67));
+
+			lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+			_mm_storeu_si128((__m128i*)(out + (x * 4)), _mm_packus_epi16(lo, hi));
+		}
+
+		for (; x < half; x++) // the smallest mips
+		for (uint c = 0; c < 4; c++)
+			out[(x * 4) + c] = (row0[(x * 8) + c] + row0[(x * 8) + 4 + c] + row1[(x * 8) + c] + row1[(x * 8) + 4 + c] + 2) >> 2;
+	}
+}
+void build_mips(byte* layer, uint size) // mip 0 is already in 'layer'
+{
+	for (; size > 1; size /= 2)
+	{
+		byte* next = layer + (size * size * 4);
+		downsample(next, layer, size);
+		layer = next;
+	}
+}
+GLuint make_texture_array(byte* texels, uint size, uint num_layers) // texels = num_layers mip chains, see build_mips()
+{
+	GLuint id = {};
+	uint mips = num_mips(size);
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+
+	for (uint mip = 0, mip_size = size, offset = 0; mip < mips; mip++, offset += mip_size * mip_size * 4, mip_size /= 2)
+	{
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA8, mip_size, mip_size, num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		for (uint layer = 0; layer < num_layers; layer++) // layers aren't next to each other in 'texels'
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, layer, mip_size, mip_size, 1, GL_RGBA, GL_UNSIGNED_BYTE, texels + (layer * mip_chain_size(size)) + offset);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mips - 1);
+
+	return id;
+}
+GLuint make_uint_texture(u8* texels, uint width, uint height) // RGBA8UI, for tables read with texelFetch()
+{
+	GLuint id = {};
+
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8UI, width, height, 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, texels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	return id;
+}
+void bind_texture_array(GLuint texture, uint texture_unit = 0)
+{
+	glActiveTexture(GL_TEXTURE0 + texture_unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
 // ------------------ Mesh Loading ----------------- //
 
+// the arrays point into 'file', see open_asset()
+
 struct Mesh_Data
 {
+	byte* file;
+	uint file_size;
 	uint num_vertices, num_indices;
 
 	vec3* positions;
@@ -159,6 +392,8 @@ struct Mesh_Data
 
 struct Mesh_Data_UV
 {
+	byte* file;
+	uint file_size;
 	uint num_vertices, num_indices;
 
 	vec3* positions;
@@ -169,6 +404,7 @@ struct Mesh_Data_UV
 
 struct Mesh_Data_Anim
 {
+	byte* file;
 	uint num_vertices, num_indices;
 
 	vec3*  positions;
@@ -180,6 +416,7 @@ struct Mesh_Data_Anim
 
 struct Mesh_Data_Anim_UV
 {
+	byte* file;
 	uint num_vertices, num_indices;
 
 	vec3*  positions;
@@ -192,95 +429,65 @@ struct Mesh_Data_Anim_UV
 
 void load(Mesh_Data* data, const char* path)
 {
-	FILE* mesh_file = fopen(path, "rb");
-	if (!mesh_file) { print("could not open mesh file : %s\n", path); stop; return; }
-
-	fread(&data->num_vertices, sizeof(uint), 1, mesh_file);
-	fread(&data->num_indices , sizeof(uint), 1, mesh_file);
+	data->file = open_asset(path, &data->file_size);
+	if (!data->file) { print("could not open mesh file : %s\n", path); stop; return; }
 
-	data->positions = (vec3*)calloc(data->num_vertices, sizeof(vec3));
-	data->normals   = (vec3*)calloc(data->num_vertices, sizeof(vec3));
-	data->indices   = (uint*)calloc(data->num_indices , sizeof(uint));
+	uint* header = (uint*)data->file;
+	data->num_vertices = header[0];
+	data->num_indices  = header[1];
 
-	fread(data->positions, sizeof(vec3), data->num_vertices, mesh_file);
-	fread(data->normals  , sizeof(vec3), data->num_vertices, mesh_file);
-	fread(data->indices  , sizeof(uint), data->num_indices , mesh_file);
+	byte* next = data->file + (2 * sizeof(uint));
+	data->positions = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->normals   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->indices   = (uint *)next;
 }
 void load(Mesh_Data_UV* data, const char* path)
 {
-	FILE* mesh_file = fopen(path, "rb");
-	if (!mesh_file) { print("could not open model file: %s\n", path); stop; return; }
-
-	fread(&data->num_vertices, sizeof(uint), 1, mesh_file);
-	fread(&data->num_indices , sizeof(uint), 1, mesh_file);
-
-	data->positions = (vec3*)calloc(data->num_vertices, sizeof(vec3));
-	data->normals   = (vec3*)calloc(data->num_vertices, sizeof(vec3));
-	data->textures  = (vec2*)calloc(data->num_vertices, sizeof(vec2));
-	data->indices   = (uint*)calloc(data->num_indices , sizeof(uint));
-
-	fread(data->positions, sizeof(vec3), data->num_vertices, mesh_file);
-	fread(data->normals  , sizeof(vec3), data->num_vertices, mesh_file);
-	fread(data->textures , sizeof(vec2), data->num_vertices, mesh_file);
-	fread(data->indices  , sizeof(uint), data->num_indices , mesh_file);
-
-	fclose(mesh_file);
+	data->file = open_asset(path, &data->file_size);
+	if (!data->file) { print("could not open model file: %s\n", path); stop; return; }
+
+	uint* header = (uint*)data->file;
+	data->num_vertices = header[0];
+	data->num_indices  = header[1];
+
+	byte* next = data->file + (2 * sizeof(uint));
+	data->positions = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->normals   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->textures  = (vec2 *)next; next += data->num_vertices * sizeof(vec2);
+	data->indices   = (uint *)next;
 }
 void load(Mesh_Data_Anim* data, const char* path)
 {
-	FILE* mesh_file = fopen(path, "rb");
-	if (!mesh_file) { print("could not open mesh file: %s\n", path); stop; return; }
-
-	fread(&data->num_vertices, sizeof(uint), 1, mesh_file);
-	fread(&data->num_indices , sizeof(uint), 1, mesh_file);
-
-	data->positions = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->normals   = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->weights   = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->bones     = (ivec3*)calloc(data->num_vertices, sizeof(ivec3));
-	data->indices   = (uint*) calloc(data->num_indices , sizeof(uint));
-
-	fread(data->positions, sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->normals  , sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->weights  , sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->bones    , sizeof(ivec3), data->num_vertices, mesh_file);
-	fread(data->indices  , sizeof(uint) , data->num_indices , mesh_file);
-
-	fclose(mesh_file);
+	data->file = open_asset(path);
+	if (!data->file) { print("could not open mesh file: %s\n", path); stop; return; }
+
+	uint* header = (uint*)data->file;
+	data->num_vertices = header[0];
+	data->num_indices  = header[1];
+
+	byte* next = data->file + (2 * sizeof(uint));
+	data->positions = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->normals   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->weights   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->bones     = (ivec3*)next; next += data->num_vertices * sizeof(ivec3);
+	data->indices   = (uint *)next;
 }
 void load(Mesh_Data_Anim_UV* data, const char* path)
 {
-	FILE* mesh_file = fopen(path, "rb");
-	if (!mesh_file) { print("could not open mesh file: %s\n", path); stop; return; }
-
-	fread(&data->num_vertices, sizeof(uint), 1, mesh_file);
-	fread(&data->num_indices , sizeof(uint), 1, mesh_file);
-
-	data->positions = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->normals   = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->weights   = (vec3*) calloc(data->num_vertices, sizeof(vec3));
-	data->bones     = (ivec3*)calloc(data->num_vertices, sizeof(ivec3));
-	data->textures  = (vec2*) calloc(data->num_vertices, sizeof(vec2));
-	data->indices   = (uint*) calloc(data->num_indices , sizeof(uint));
-
-	fread(data->positions, sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->normals  , sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->weights  , sizeof(vec3) , data->num_vertices, mesh_file);
-	fread(data->bones    , sizeof(ivec3), data->num_vertices, mesh_file);
-	fread(data->textures , sizeof(vec2) , data->num_vertices, mesh_file);
-	fread(data->indices  , sizeof(uint) , data->num_indices , mesh_file);
-
-	//for (int i = 0; i < data->num_vertices; i++)
-	//{
-	//	printvec(data->positions[i]);
-	//	printvec(data->normals[i]);
-	//	printvec(data->weights[i]);
-	//	printvec(data->bones[i]);
-	//	out(data->textures[i].x << ',' << data->textures[i].y);
-	//	//stop;
-	//}
-
-	fclose(mesh_file);
+	data->file = open_asset(path);
+	if (!data->file) { print("could not open mesh file: %s\n", path); stop; return; }
+
+	uint* header = (uint*)data->file;
+	data->num_vertices = header[0];
+	data->num_indices  = header[1];
+
+	byte* next = data->file + (2 * sizeof(uint));
+	data->positions = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->normals   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->weights   = (vec3 *)next; next += data->num_vertices * sizeof(vec3);
+	data->bones     = (ivec3*)next; next += data->num_vertices * sizeof(ivec3);
+	data->textures  = (vec2 *)next; next += data->num_vertices * sizeof(vec2);
+	data->indices   = (uint *)next;
 }
 
 // ----------------- Mesh Rendering ---------------- //
@@ -309,6 +516,72 @@ struct Drawable_Mesh_Anim_UV
 	uint num_indices;
 };
 
+// meshes are re-uploaded into the buffers they already have. the vertex attributes point at where the vertices
+// are, so a mesh can only be reloaded if it has the same number of vertices. param = reserved_mem_size
+
+bool fits(GLuint VBO, uint size) // is the buffer exactly 'size' bytes
+{
+	GLint buffer_size = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &buffer_size);
+	return buffer_size == size;
+}
+bool reload_mesh(Hot_Reload* reload)
+{
+	Drawable_Mesh* mesh = (Drawable_Mesh*)reload->target;
+	uint offset = (uint)reload->param;
+	if (!file_time(reload->files[0].path)) return false;
+
+	Mesh_Data mesh_data = {};
+	load(&mesh_data, reload->files[0].path);
+
+	uint vertmemsize = mesh_data.num_vertices * sizeof(vec3);
+	uint file_size = (2 * sizeof(uint)) + (vertmemsize * 2) + (mesh_data.num_indices * sizeof(uint));
+	bool ok = mesh_data.file && mesh_data.file_size >= file_size && fits(mesh->VBO, offset + (vertmemsize * 2));
+
+	if (ok)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, offset, vertmemsize, mesh_data.positions);
+		glBufferSubData(GL_ARRAY_BUFFER, offset + vertmemsize, vertmemsize, mesh_data.normals);
+
+		glBindVertexArray(mesh->VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
+		mesh->num_indices = mesh_data.num_indices;
+	}
+
+	close_asset(mesh_data.file);
+	return ok;
+}
+bool reload_mesh_uv(Hot_Reload* reload)
+{
+	Drawable_Mesh_UV* mesh = (Drawable_Mesh_UV*)reload->target;
+	uint offset = (uint)reload->param;
+	if (!file_time(reload->files[0].path)) return false;
+
+	Mesh_Data_UV mesh_data = {};
+	load(&mesh_data, reload->files[0].path);
+
+	uint vertmemsize = mesh_data.num_vertices * sizeof(vec3);
+	uint texmemsize  = mesh_data.num_vertices * sizeof(vec2);
+	uint file_size = (2 * sizeof(uint)) + (vertmemsize * 2) + texmemsize + (mesh_data.num_indices * sizeof(uint));
+	bool ok = mesh_data.file && mesh_data.file_size >= file_size && fits(mesh->VBO, offset + (vertmemsize * 2) + texmemsize);
+
+	if (ok)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, offset, vertmemsize, mesh_data.positions);
+		glBufferSubData(GL_ARRAY_BUFFER, offset + vertmemsize, vertmemsize, mesh_data.normals);
+		glBufferSubData(GL_ARRAY_BUFFER, offset + vertmemsize + vertmemsize, texmemsize, mesh_data.textures);
+
+		glBindVertexArray(mesh->VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
+		mesh->num_indices = mesh_data.num_indices;
+	}
+
+	close_asset(mesh_data.file);
+	return ok;
+}
 void load(Drawable_Mesh* mesh, const char* path, uint reserved_mem_size = 0)
 {
 	Mesh_Data mesh_data;
@@ -333,9 +606,7 @@ void load(Drawable_Mesh* mesh, const char* path, uint reserved_mem_size = 0)
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
 
-	free(mesh_data.positions);
-	free(mesh_data.normals);
-	free(mesh_data.indices);
+	close_asset(mesh_data.file); // the arrays point into it
 
 	offset = reserved_mem_size;
 	{
@@ -347,6 +618,8 @@ void load(Drawable_Mesh* mesh, const char* path, uint reserved_mem_size = 0)
 		glVertexAttribPointer(norm_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)offset);
 		glEnableVertexAttribArray(norm_attrib);
 	}
+
+	watch(&hot_reloader, reload_mesh, mesh, reserved_mem_size, path);
 }
 void load(Drawable_Mesh_UV* mesh, const char* path, uint reserved_mem_size = 0)
 {
@@ -374,10 +647,7 @@ void load(Drawable_Mesh_UV* mesh, const char* path, uint reserved_mem_size = 0)
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
 
-	free(mesh_data.positions);
-	free(mesh_data.normals);
-	free(mesh_data.textures);
-	free(mesh_data.indices);
+	close_asset(mesh_data.file); // the arrays point into it
 
 	offset = reserved_mem_size;
 	{
@@ -393,6 +663,8 @@ void load(Drawable_Mesh_UV* mesh, const char* path, uint reserved_mem_size = 0)
 		glVertexAttribPointer(tex_attrib, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (void*)offset);
 		glEnableVertexAttribArray(tex_attrib);
 	}
+
+	watch(&hot_reloader, reload_mesh_uv, mesh, reserved_mem_size, path);
 }
 void load(Drawable_Mesh_Anim* mesh, const char* path, uint reserved_mem_size = 0)
 {
@@ -421,11 +693,7 @@ void load(Drawable_Mesh_Anim* mesh, const char* path, uint reserved_mem_size = 0
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
 
-	free(mesh_data.positions);
-	free(mesh_data.normals);
-	free(mesh_data.weights);
-	free(mesh_data.bones);
-	free(mesh_data.indices);
+	close_asset(mesh_data.file); // the arrays point into it
 
 	offset = reserved_mem_size;
 	{
@@ -482,12 +750,7 @@ void load(Drawable_Mesh_Anim_UV* mesh, const char* path, uint reserved_mem_size
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh_data.num_indices * sizeof(uint), mesh_data.indices, GL_STATIC_DRAW);
 
-	free(mesh_data.positions);
-	free(mesh_data.normals);
-	free(mesh_data.textures);
-	free(mesh_data.weights);
-	free(mesh_data.bones);
-	free(mesh_data.indices);
+	close_asset(mesh_data.file); // the arrays point into it
 
 	offset = reserved_mem_size;
 	{
@@ -587,6 +850,18 @@ void mesh_add_attrib_vec3 (GLuint attrib_id, uint stride, uint offset)
 	glVertexAttribDivisor(attrib_id, 1);
 	glEnableVertexAttribArray(attrib_id);
 }
+void mesh_add_attrib_uint (GLuint attrib_id, uint stride, uint offset) // integer attribute, not converted to float
+{
+	glVertexAttribIPointer(attrib_id, 1, GL_UNSIGNED_INT, stride, (void*)offset);
+	glVertexAttribDivisor(attrib_id, 1);
+	glEnableVertexAttribArray(attrib_id);
+}
+void mesh_add_attrib_uvec2(GLuint attrib_id, uint stride, uint offset) // integer attribute, not converted to float
+{
+	glVertexAttribIPointer(attrib_id, 2, GL_UNSIGNED_INT, stride, (void*)offset);
+	glVertexAttribDivisor(attrib_id, 1);
+	glEnableVertexAttribArray(attrib_id);
+}
 void mesh_add_attrib_mat3 (GLuint attrib_id, uint stride, uint offset)
 {
 	glVertexAttribPointer(attrib_id, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
@@ -749,28 +1024,337 @@ void draw(G_Buffer g_buffer)
 
 // -------------------- Lighting ------------------- //
 
-Shader make_lighting_shader()
+// clustered deferred lighting : the view frustum is cut into LIGHT_CLUSTERS_X * Y * Z clusters (screen tiles x
+// depth slices that get longer further away) & every cluster gets a list of the point lights that touch it. so
+// the lighting shader only looks at the lights near each pixel, instead of every light on the screen.
+// the cluster sizes are also in lighting.frag, change both
+
+/* -- how 2 light a frame --
+
+	clear(clusters);
+	add_light(clusters, position, radius, color); // as many as you like, up to MAX_LIGHTS
+	update(clusters, view, proj); // bins them & uploads the lists
+	bind(clusters); // before drawing the g buffer with the lighting shader
+*/
+
+#define MAX_LIGHTS        (1 << 14) // lights are u16s in the cluster lists
+#define MAX_LIGHT_INDICES (1 << 20) // all of the cluster lists together
+
+#define LIGHT_CLUSTERS_X  16
+#define LIGHT_CLUSTERS_Y  9
+#define LIGHT_CLUSTERS_Z  24
+#define NUM_LIGHT_CLUSTERS (LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z)
+#define LIGHT_NEAR        1.f   // slice 0 is everything closer than this
+#define LIGHT_FAR         256.f // nothing further than this is lit by point lights
+
+#define NUM_LIGHT_JOBS    4 // depth slices are shared out between the light threads & the main thread
+#define JOB_LIGHT_INDICES (MAX_LIGHT_INDICES / NUM_LIGHT_JOBS) // every job fills its own part of the lists
+
+#define LIGHT_TEXTURE_UNIT 3 // lights, clusters & indices are on units 3, 4 & 5 (after the g buffer)
+
+struct Point_Light // 2 texels of the light buffer
 {
-	Shader lighting_shader = {};
-	load(&lighting_shader, "assets/shaders/lighting.vert", "assets/shaders/lighting.frag");
-	bind(lighting_shader);
+	vec3 position; // world space
+	float radius;  // it doesn't light anything further away than this
+	vec3 color;
+	float intensity;
+};
+
+struct Light_Range // clusters a light touches, inclusive
+{
+	u16 light;
+	u8 x0, x1, y0, y1, z0, z1;
+};
+
+struct Light_Clusters
+{
+	uint num_lights;
+	Point_Light lights[MAX_LIGHTS];
+
+	uint num_visible; // lights that touch at least 1 cluster
+	Light_Range visible[MAX_LIGHTS];
+
+	uvec2 clusters[NUM_LIGHT_CLUSTERS]; // offset & count into indices. [x + (y * X) + (z * X * Y)]
+	u16 indices[MAX_LIGHT_INDICES];
+	uint num_indices[NUM_LIGHT_JOBS]; // used by each job
+	uint dropped[NUM_LIGHT_JOBS]; // light indices that didn't fit
+
+	GLuint light_buffer, cluster_buffer, index_buffer; // texture buffers
+	GLuint light_texture, cluster_texture, index_texture;
+};
+
+void clear(Light_Clusters* clusters)
+{
+	clusters->num_lights = 0;
+}
+void add_light(Light_Clusters* clusters, vec3 position, float radius, vec3 color, float intensity = 1)
+{
+	if (clusters->num_lights == MAX_LIGHTS) return; // the furthest ones should be left out first anyway
+	clusters->lights[clusters->num_lights++] = { position, radius, color, intensity };
+}
+
+// culls the lights & finds the clusters they touch, 4 at a time. the tile edges are planes through the camera,
+// a sphere is past an edge if it is further than its radius in front of the plane
+void find_light_ranges(Light_Clusters* clusters, mat4 view, mat4 proj)
+{
+	// signed distance to the edge between tiles k - 1 & k = (a[k] * x) + (c[k] * z) in view space
+	float xa[LIGHT_CLUSTERS_X + 1], xc[LIGHT_CLUSTERS_X + 1];
+	float ya[LIGHT_CLUSTERS_Y + 1], yc[LIGHT_CLUSTERS_Y + 1];
+	float slices[LIGHT_CLUSTERS_Z + 1]; // depth where each slice starts
+
+	for (uint k = 0; k <= LIGHT_CLUSTERS_X; k++)
+	{
+		float ndc = -1 + (2.f * k) / LIGHT_CLUSTERS_X;
+		float length = sqrtf((proj[0][0] * proj[0][0]) + (ndc * ndc));
+		xa[k] = proj[0][0] / length;
+		xc[k] = ndc / length;
+	}
+	for (uint k = 0; k <= LIGHT_CLUSTERS_Y; k++)
+	{
+		float ndc = -1 + (2.f * k) / LIGHT_CLUSTERS_Y;
+		float length = sqrtf((proj[1][1] * proj[1][1]) + (ndc * ndc));
+		ya[k] = proj[1][1] / length;
+		yc[k] = ndc / length;
+	}
+
+	slices[0] = 0;
+	for (uint k = 1; k <= LIGHT_CLUSTERS_Z; k++)
+		slices[k] = LIGHT_NEAR * powf(LIGHT_FAR / LIGHT_NEAR, (k - 1.f) / (LIGHT_CLUSTERS_Z - 1));
+
+	const __m128i last_x = _mm_set1_epi32(LIGHT_CLUSTERS_X - 1);
+	const __m128i last_y = _mm_set1_epi32(LIGHT_CLUSTERS_Y - 1);
+	const __m128i last_z = _mm_set1_epi32(LIGHT_CLUSTERS_Z - 1);
+
+	uint num_visible = 0;
+
+	for (uint i = 0; i < clusters->num_lights; i += 4)
+	{
+		// the position & radius of 4 lights, as x, y, z & radius of each (past the last light is just old data)
+		__m128 x = _mm_loadu_ps(&clusters->lights[i + 0].position.x);
+		__m128 y = _mm_loadu_ps(&clusters->lights[i + 1].position.x);
+		__m128 z = _mm_loadu_ps(&clusters->lights[i + 2].position.x);
+		__m128 r = _mm_loadu_ps(&clusters->lights[i + 3].position.x);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+
+		auto row = [&](uint n) {
+			__m128 v = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0][n])), _mm_mul_ps(y, _mm_set1_ps(view[1][n])));
+			return _mm_add_ps(_mm_add_ps(v, _mm_mul_ps(z, _mm_set1_ps(view[2][n]))), _mm_set1_ps(view[3][n]));
+		};
+		__m128 vx = row(0), vy = row(1), vz = row(2);
+		__m128 depth = _mm_sub_ps(_mm_setzero_ps(), vz);
+		__m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+		// a mask is -1 where it's true, so subtracting masks counts them
+		__m128i x0 = _mm_setzero_si128(), x1 = last_x;
+		for (uint k = 0; k <= LIGHT_CLUSTERS_X; k++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(xa[k])), _mm_mul_ps(vz, _mm_set1_ps(xc[k])));
+			if (k > 0)                x0 = _mm_sub_epi32(x0, _mm_castps_si128(_mm_cmpgt_ps(distance, r))); // all of it is past edge k
+			if (k < LIGHT_CLUSTERS_X) x1 = _mm_add_epi32(x1, _mm_castps_si128(_mm_cmplt_ps(distance, neg_r))); // none of it is
+		}
+
+		__m128i y0 = _mm_setzero_si128(), y1 = last_y;
+		for (uint k = 0; k <= LIGHT_CLUSTERS_Y; k++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(vy, _mm_set1_ps(ya[k])), _mm_mul_ps(vz, _mm_set1_ps(yc[k])));
+			if (k > 0)                y0 = _mm_sub_epi32(y0, _mm_castps_si128(_mm_cmpgt_ps(distance, r)));
+			if (k < LIGHT_CLUSTERS_Y) y1 = _mm_add_epi32(y1, _mm_castps_si128(_mm_cmplt_ps(distance, neg_r)));
+		}
+
+		__m128 front = _mm_sub_ps(depth, r), back = _mm_add_ps(depth, r);
+		__m128i z0 = _mm_setzero_si128(), z1 = last_z;
+		for (uint k = 0; k <= LIGHT_CLUSTERS_Z; k++)
+		{
+			__m128 start = _mm_set1_ps(slices[k]);
+			if (k > 0)                z0 = _mm_sub_epi32(z0, _mm_castps_si128(_mm_cmple_ps(start, front)));
+			if (k < LIGHT_CLUSTERS_Z) z1 = _mm_add_epi32(z1, _mm_castps_si128(_mm_cmpge_ps(start, back)));
+		}
+
+		// the edges only work in front of the camera. lights around it touch every tile
+		__m128i around = _mm_castps_si128(_mm_cmplt_ps(depth, r));
+		x0 = _mm_andnot_si128(around, x0); x1 = _mm_or_si128(_mm_and_si128(around, last_x), _mm_andnot_si128(around, x1));
+		y0 = _mm_andnot_si128(around, y0); y1 = _mm_or_si128(_mm_and_si128(around, last_y), _mm_andnot_si128(around, y1));
+
+		int X0[4], X1[4], Y0[4], Y1[4], Z0[4], Z1[4];
+		_mm_storeu_si128((__m128i*)X0, x0); _mm_storeu_si128((__m128i*)X1, x1);
+		_mm_storeu_si128((__m128i*)Y0, y0); _mm_storeu_si128((__m128i*)Y1, y1);
+		_mm_storeu_si128((__m128i*)Z0, z0); _mm_storeu_si128((__m128i*)Z1, z1);
+
+		for (uint n = 0; n < 4 && i + n < clusters->num_lights; n++)
+		{
+			if (X0[n] > X1[n] || Y0[n] > Y1[n] || Z0[n] > Z1[n]) continue; // off the screen, behind or too far
+
+			clusters->visible[num_visible++] = { (u16)(i + n), (u8)X0[n], (u8)X1[n], (u8)Y0[n], (u8)Y1[n], (u8)Z0[n], (u8)Z1[n] };
+		}
+	}
+
+	clusters->num_visible = num_visible;
+}
+
+// fills the lists of every NUM_LIGHT_JOBS'th slice starting at 'job' (near slices have fewer lights, so
+// interleaving them keeps the jobs about the same size). it only writes to its own slices & part of the indices
+void bin_lights(Light_Clusters* clusters, uint job)
+{
+	const uint slice_size = LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y;
+	uint start = job * JOB_LIGHT_INDICES, used = 0, dropped = 0;
+
+	for (uint z = job; z < LIGHT_CLUSTERS_Z; z += NUM_LIGHT_JOBS)
+	{
+		uvec2* slice = clusters->clusters + (z * slice_size);
+		uint counts[slice_size] = {};
+
+		for (uint i = 0; i < clusters->num_visible; i++)
+		{
+			Light_Range range = clusters->visible[i];
+			if (z < range.z0 || z > range.z1) continue;
+
+			for (uint y = range.y0; y <= range.y1; y++)
+			for (uint x = range.x0; x <= range.x1; x++) counts[x + (y * LIGHT_CLUSTERS_X)]++;
+		}
+
+		for (uint c = 0; c < slice_size; c++)
+		{
+			uint count = glm::min(counts[c], JOB_LIGHT_INDICES - used);
+			dropped += counts[c] - count;
+
+			slice[c] = uvec2(start + used, 0);
+			counts[c] = count;
+			used += count;
+		}
+
+		for (uint i = 0; i < clusters->num_visible; i++)
+		{
+			Light_Range range = clusters->visible[i];
+			if (z < range.z0 || z > range.z1) continue;
+
+			for (uint y = range.y0; y <= range.y1; y++)
+			for (uint x = range.x0; x <= range.x1; x++)
+			{
+				uvec2* cluster = slice + x + (y * LIGHT_CLUSTERS_X);
+				if (cluster->y < counts[x + (y * LIGHT_CLUSTERS_X)]) clusters->indices[cluster->x + cluster->y++] = range.light;
+			}
+		}
+	}
+
+	clusters->num_indices[job] = used;
+	clusters->dropped[job] = dropped;
+}
 
-	vec3 light_positions[4] = { vec3(3), vec3(1), vec3(4), vec3(5) };
-	vec3 light_colors   [4] = { vec3(1), vec3(1), vec3(1), vec3(1) };
+// the light threads wait for a frame's lights, bin their share of the slices & go back to waiting.
+// never freed, like the file threads
 
-	set_vec3(lighting_shader, "light_positions[0]", light_positions[0]);
-	set_vec3(lighting_shader, "light_positions[1]", light_positions[1]);
-	set_vec3(lighting_shader, "light_positions[2]", light_positions[2]);
-	set_vec3(lighting_shader, "light_positions[3]", light_positions[3]);
+struct Light_Workers
+{
+	Light_Clusters* clusters;
+	uint frame;
+	std::atomic<uint> finished; // jobs done this frame
+	bool running;
 
-	set_vec3(lighting_shader, "light_colors[0]", light_colors[0]);
-	set_vec3(lighting_shader, "light_colors[1]", light_colors[1]);
-	set_vec3(lighting_shader, "light_colors[2]", light_colors[2]);
-	set_vec3(lighting_shader, "light_colors[3]", light_colors[3]);
+	std::mutex lock;
+	std::condition_variable wake;
+};
 
-	return lighting_shader;
+Light_Workers* light_workers()
+{
+	static Light_Workers* workers = new Light_Workers();
+	return workers;
 }
 
+void run_light_thread(uint job)
+{
+	Light_Workers* workers = light_workers();
+	uint frame = 0;
+
+	for (;;)
+	{
+		Light_Clusters* clusters = NULL;
+		{
+			std::unique_lock<std::mutex> guard(workers->lock);
+			workers->wake.wait(guard, [workers, frame] { return workers->frame != frame; });
+			frame = workers->frame;
+			clusters = workers->clusters;
+		}
+
+		bin_lights(clusters, job);
+		workers->finished++;
+	}
+}
+void bin_lights(Light_Clusters* clusters, mat4 view, mat4 proj) // everything but the upload, so it can run without gl
+{
+	find_light_ranges(clusters, view, proj);
+
+	Light_Workers* workers = light_workers();
+	{
+		std::lock_guard<std::mutex> guard(workers->lock);
+
+		if (!workers->running)
+		{
+			for (uint job = 1; job < NUM_LIGHT_JOBS; job++) std::thread(run_light_thread, job).detach();
+			workers->running = true;
+		}
+
+		workers->clusters = clusters;
+		workers->finished = 0;
+		workers->frame++;
+	}
+	workers->wake.notify_all();
+
+	bin_lights(clusters, 0);
+	while (workers->finished < NUM_LIGHT_JOBS - 1) std::this_thread::yield();
+}
+
+GLuint make_texture_buffer(GLuint* buffer, GLenum format)
+{
+	GLuint id = {};
+
+	glGenBuffers(1, buffer);
+	glGenTextures(1, &id);
+	glBindTexture(GL_TEXTURE_BUFFER, id);
+	glBindBuffer(GL_TEXTURE_BUFFER, *buffer);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, *buffer);
+
+	return id;
+}
+void init(Light_Clusters* clusters)
+{
+	clusters->light_texture   = make_texture_buffer(&clusters->light_buffer  , GL_RGBA32F);
+	clusters->cluster_texture = make_texture_buffer(&clusters->cluster_buffer, GL_RG32UI );
+	clusters->index_texture   = make_texture_buffer(&clusters->index_buffer  , GL_R16UI  );
+
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->light_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(clusters->lights), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->cluster_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(clusters->clusters), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->index_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(clusters->indices), NULL, GL_STREAM_DRAW);
+}
+void update(Light_Clusters* clusters, mat4 view, mat4 proj) // bins this frame's lights & uploads the lists
+{
+	bin_lights(clusters, view, proj);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->light_buffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, clusters->num_lights * sizeof(Point_Light), clusters->lights);
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->cluster_buffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(clusters->clusters), clusters->clusters);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, clusters->index_buffer);
+	for (uint job = 0; job < NUM_LIGHT_JOBS; job++) // only the parts of the lists that were used
+	{
+		uint offset = job * JOB_LIGHT_INDICES * sizeof(u16);
+		glBufferSubData(GL_TEXTURE_BUFFER, offset, clusters->num_indices[job] * sizeof(u16), clusters->indices + (job * JOB_LIGHT_INDICES));
+	}
+}
+void bind(Light_Clusters* clusters)
+{
+	glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT + 0); glBindTexture(GL_TEXTURE_BUFFER, clusters->light_texture);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT + 1); glBindTexture(GL_TEXTURE_BUFFER, clusters->cluster_texture);
+	glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT + 2); glBindTexture(GL_TEXTURE_BUFFER, clusters->index_texture);
+}
+
+void load_lighting_shader(Shader* lighting_shader)
+{
+	load(lighting_shader, "assets/shaders/lighting.vert", "assets/shaders/lighting.frag");
+}
 // ------------------ 2D Rendering ----------------- //
 
 struct Drawable_Mesh_2D
@@ -819,12 +1403,12 @@ void init(Drawable_Mesh_2D* mesh, uint reserved_mem_size = 0)
 		glEnableVertexAttribArray(vert_attrib);
 	}
 }
-void update(Drawable_Mesh_2D mesh, uint vb_size = NULL, byte* vb_data = NULL)
+void update(Drawable_Mesh_2D mesh, uint vb_size = NULL, byte* vb_data = NULL, uint vb_offset = 0) // vb_data goes at vb_offset bytes into the buffer
 {
 	if (vb_size > 0)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, vb_size, vb_data);
+		glBufferSubData(GL_ARRAY_BUFFER, vb_offset, vb_size, vb_data);
 	}
 }
 void draw(Drawable_Mesh_2D mesh, uint num_instances = 1)
@@ -880,12 +1464,12 @@ void init(Drawable_Mesh_2D_UV* mesh, uint reserved_mem_size = 0, vec2 tex_offset
 		glEnableVertexAttribArray(tex_attrib);
 	}
 }
-void update(Drawable_Mesh_2D_UV mesh, uint vb_size = NULL, byte* vb_data = NULL)
+void update(Drawable_Mesh_2D_UV mesh, uint vb_size = NULL, byte* vb_data = NULL, uint vb_offset = 0) // vb_data goes at vb_offset bytes into the buffer
 {
 	if (vb_size > 0)
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, vb_size, vb_data);
+		glBufferSubData(GL_ARRAY_BUFFER, vb_offset, vb_size, vb_data);
 	}
 }
 void draw(Drawable_Mesh_2D_UV mesh, uint num_instances = 1)
@@ -894,6 +1478,169 @@ void draw(Drawable_Mesh_2D_UV mesh, uint num_instances = 1)
 	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, num_instances);
 }
 
+// ------------------ Render Queue ----------------- //
+
+/* -- how 2 draw something --
+
+	Draw_Packet* packet = submit(queue, PASS_GEOMETRY, shader, mesh.VAO, mesh.num_indices, num_instances, position);
+	set_texture(packet, 0, texture);
+	...
+	draw(queue, PASS_GEOMETRY); // sorts the pass by its keys & draws it, skipping state that is already set
+*/
+
+// state set outside of the queue (eg. uniforms, the lighting pass) is fine, it forgets what was bound before
+// every pass. uniforms are part of a shader, so they can be set whenever before the pass is drawn
+
+#define MAX_DRAW_PACKETS    1024 // the packet index is the bottom 10 bits of a key
+#define MAX_PACKET_TEXTURES 3    // texture units 0 - 2
+
+#define PASS_GEOMETRY 0 // into the g buffer, grouped by shader & texture, then front to back
+#define PASS_GUI      1 // on top of everything, in the order it was submitted
+
+#define UNKNOWN_STATE 0xFFFFFFFF
+
+struct Packet_Texture { GLenum target; GLuint id; }; // id 0 = the unit isn't used
+
+struct Draw_Packet
+{
+	uint pass;
+	GLuint shader, VAO;
+	uint num_indices, num_instances;
+	Packet_Texture textures[MAX_PACKET_TEXTURES]; // [texture unit]
+	u16 depth; // distance to the camera, or when it was submitted for PASS_GUI
+};
+
+struct Render_Stats // for a whole frame
+{
+	uint draws;
+	uint shaders, textures, vertex_arrays; // state changes that were made
+	uint skipped; // state changes that weren't needed
+};
+
+struct Render_Queue
+{
+	vec3 view_pos;
+	uint num_packets;
+	Draw_Packet packets[MAX_DRAW_PACKETS];
+	uint64 keys[MAX_DRAW_PACKETS], scratch[MAX_DRAW_PACKETS];
+	Render_Stats stats;
+};
+
+void clear(Render_Queue* queue, vec3 view_pos) // at the start of a frame
+{
+	queue->view_pos = view_pos;
+	queue->num_packets = 0;
+	queue->stats = {};
+}
+Draw_Packet* submit(Render_Queue* queue, uint pass, Shader shader, GLuint VAO, uint num_indices, uint num_instances, vec3 position = vec3(0))
+{
+	if (num_instances == 0 || num_indices == 0) return NULL; // nothing to draw
+	if (queue->num_packets == MAX_DRAW_PACKETS) { out("ERROR : the render queue is full"); return NULL; }
+
+	Draw_Packet* packet = queue->packets + queue->num_packets++;
+	*packet = { pass, shader.id, VAO, num_indices, num_instances };
+
+	if (pass == PASS_GUI) packet->depth = queue->num_packets;
+	else packet->depth = glm::min(glm::distance(queue->view_pos, position) / DRAW_DISTANCE, 1.f) * 65535;
+
+	return packet;
+}
+void set_texture(Draw_Packet* packet, uint texture_unit, GLuint texture, GLenum target = GL_TEXTURE_2D)
+{
+	if (packet) packet->textures[texture_unit] = { target, texture }; // NULL = it wasn't submitted
+}
+
+// shader (12 bits) | texture 0 (12) | depth (16) | vertex array (12) | packet index (10). every chunk has its own
+// vertex array, so depth goes first to draw them front to back. gl names are small numbers, if 2 of them do
+// share their bottom bits they only end up sorted a little worse
+uint64 draw_key(Draw_Packet* packet, uint index)
+{
+	uint64 shader  = packet->shader & 0xFFF;
+	uint64 texture = packet->textures[0].id & 0xFFF;
+	uint64 VAO     = packet->VAO & 0xFFF;
+	if (packet->pass == PASS_GUI) shader = texture = VAO = 0; // only the order it was submitted in matters
+
+	return (shader << 52) | (texture << 40) | ((uint64)packet->depth << 24) | (VAO << 10) | index;
+}
+void radix_sort(uint64* keys, uint64* scratch, uint n) // a byte at a time, bytes that are all the same are skipped
+{
+	uint64* from = keys;
+	uint64* to   = scratch;
+
+	for (uint shift = 0; shift < 64; shift += 8)
+	{
+		uint counts[256] = {};
+		for (uint i = 0; i < n; i++) counts[(from[i] >> shift) & 255]++;
+		if (n == 0 || counts[(from[0] >> shift) & 255] == n) continue;
+
+		for (uint digit = 0, offset = 0; digit < 256; digit++)
+		{
+			uint count = counts[digit];
+			counts[digit] = offset;
+			offset += count;
+		}
+
+		for (uint i = 0; i < n; i++) to[counts[(from[i] >> shift) & 255]++] = from[i];
+
+		uint64* temp = from; from = to; to = temp;
+	}
+
+	if (from != keys) memcpy(keys, from, n * sizeof(uint64));
+}
+void draw(Render_Queue* queue, uint pass)
+{
+	uint n = 0;
+	for (uint i = 0; i < queue->num_packets; i++)
+		if (queue->packets[i].pass == pass) queue->keys[n++] = draw_key(queue->packets + i, i);
+
+	radix_sort(queue->keys, queue->scratch, n);
+
+	GLuint shader = UNKNOWN_STATE, VAO = UNKNOWN_STATE;
+	Packet_Texture textures[MAX_PACKET_TEXTURES];
+	for (uint unit = 0; unit < MAX_PACKET_TEXTURES; unit++) textures[unit] = { UNKNOWN_STATE, UNKNOWN_STATE };
+
+	Render_Stats* stats = &queue->stats;
+
+	for (uint i = 0; i < n; i++)
+	{
+		Draw_Packet* packet = queue->packets + (queue->keys[i] & (MAX_DRAW_PACKETS - 1));
+
+		if (packet->shader != shader)
+		{
+			glUseProgram(packet->shader);
+			shader = packet->shader;
+			stats->shaders++;
+		}
+		else stats->skipped++;
+
+		for (uint unit = 0; unit < MAX_PACKET_TEXTURES; unit++)
+		{
+			Packet_Texture texture = packet->textures[unit];
+			if (texture.id == 0) continue;
+
+			if (texture.id != textures[unit].id || texture.target != textures[unit].target)
+			{
+				glActiveTexture(GL_TEXTURE0 + unit);
+				glBindTexture(texture.target, texture.id);
+				textures[unit] = texture;
+				stats->textures++;
+			}
+			else stats->skipped++;
+		}
+
+		if (packet->VAO != VAO)
+		{
+			glBindVertexArray(packet->VAO);
+			VAO = packet->VAO;
+			stats->vertex_arrays++;
+		}
+		else stats->skipped++;
+
+		glDrawElementsInstanced(GL_TRIANGLES, packet->num_indices, GL_UNSIGNED_INT, 0, packet->num_instances);
+		stats->draws++;
+	}
+}
+
 // -------------------- Animation ------------------ //
 
 #define MAX_ANIM_BONES 16
@@ -915,23 +1662,24 @@ void load(Animation* anim, const char* path)
 {
 	*anim = {};
 	
-	FILE* read = fopen(path, "rb");
-	if (!read) { print("could not open animation file: %s\n", path); stop; return; }
+	byte* file = open_asset(path);
+	if (!file) { print("could not open animation file: %s\n", path); stop; return; }
 
 	// skeleton
-	fread(&anim->num_bones, sizeof(uint), 1, read);
-	fread(anim->parents   , sizeof(uint), anim->num_bones, read);
-	fread(anim->ibm       , sizeof(mat4), anim->num_bones, read);
+	byte* next = file;
+	anim->num_bones = *(uint*)next; next += sizeof(uint);
+	memcpy(anim->parents, next, anim->num_bones * sizeof(uint)); next += anim->num_bones * sizeof(uint);
+	memcpy(anim->ibm    , next, anim->num_bones * sizeof(mat4)); next += anim->num_bones * sizeof(mat4);
 
 	// animation keyframes
-	fread(&anim->num_frames, sizeof(uint), 1, read);
+	anim->num_frames = *(uint*)next; next += sizeof(uint);
 	for (int i = 0; i < anim->num_bones; i++)
 	{
 		anim->keyframes[i] = Alloc(mat4, anim->num_frames);
-		fread(anim->keyframes[i], sizeof(mat4), anim->num_frames, read);
+		memcpy(anim->keyframes[i], next, anim->num_frames * sizeof(mat4)); next += anim->num_frames * sizeof(mat4);
 	}
 
-	fclose(read);
+	close_asset(file);
 
 	anim->current_frame = 0;
 	anim->timer = 1.f / anim->num_frames;
@@ -1,8 +1,13 @@
 #include "items.h"
 
-extern uint give_player_item(Item* player_items, Item item); // is this bad?
+#define WORLD_ITEM_CAPACITY 4096 // default number of items that can be dropped in the world
+#define WORLD_ITEM_SIZE .25f // dropped items are drawn as a quarter block, see item.vert
+#define WORLD_ITEM_MERGE_RADIUS 1.f
+#define TERMINAL_VELOCITY 30.f
 
-#define MAX_WORLD_ITEMS 64 // items that can be dropped in the world
+// uniform grid for finding nearby items
+#define ITEM_GRID_CELL_SIZE 1 // in blocks, must be >= WORLD_ITEM_MERGE_RADIUS
+#define ITEM_GRID_CELLS 4096 // cells are hashed into this many buckets (must be a power of 2)
 
 struct World_Item // an item that has been dropped in the world
 {
@@ -11,83 +16,527 @@ struct World_Item // an item that has been dropped in the world
 	vec3 velocity;
 };
 
-void spawn(World_Item* items, Item item, vec3 position)
+struct World_Items
 {
-	for (uint i = 0; i < MAX_WORLD_ITEMS; i++)
+	uint count, capacity;
+	World_Item* items; // live items are packed into items[0 .. count]
+
+	// items in cell c are cell_items[cell_start[c] .. cell_start[c + 1]], rebuilt every update
+	uint cell_start[ITEM_GRID_CELLS + 1];
+	uint* cell_items;
+};
+
+void init(World_Items* items, uint capacity)
+{
+	items->count = 0;
+	items->capacity = capacity;
+	items->items = Alloc(World_Item, capacity);
+	items->cell_items = Alloc(uint, capacity);
+}
+void spawn(World_Items* items, Item item, vec3 position)
+{
+	if (item.type == NULL || items->count >= items->capacity) return;
+
+	items->items[items->count++] = { item, position, vec3(0, 1, 0) };
+}
+void remove(World_Items* items, uint index) // order is not preserved
+{
+	items->items[index] = items->items[--items->count];
+	items->items[items->count] = {};
+}
+
+// item bounding boxes (relative to World_Item.position)
+const vec3 ITEM_MIN = vec3(.5f - (WORLD_ITEM_SIZE / 2), 0, .5f - (WORLD_ITEM_SIZE / 2));
+const vec3 ITEM_MAX = vec3(.5f + (WORLD_ITEM_SIZE / 2), WORLD_ITEM_SIZE, .5f + (WORLD_ITEM_SIZE / 2));
+
+bool box_hits_blocks(Chunk_Lookup* lookup, u16* blocks, vec3 min, vec3 max)
+{
+	// a box that ends exactly on a block boundary is not inside the next block
+	ivec3 lo = ivec3(floor(min));
+	ivec3 hi = ivec3(floor(max - vec3(EPSILON)));
+
+	for (int x = lo.x; x <= hi.x; x++) {
+	for (int y = lo.y; y <= hi.y; y++) {
+	for (int z = lo.z; z <= hi.z; z++)
+	{
+		if (is_solid(get_block(lookup, blocks, ivec3(x, y, z)))) return true;
+	} } }
+
+	return false;
+}
+bool box_above_surface(Chunk_Lookup* lookup, u8* heights, vec3 min, vec3 max) // nothing solid below the box : it can't hit anything
+{
+	ivec3 lo = ivec3(floor(min));
+	ivec3 hi = ivec3(floor(max - vec3(EPSILON)));
+
+	for (int x = lo.x; x <= hi.x; x++) {
+	for (int z = lo.z; z <= hi.z; z++)
+	{
+		if (min.y < get_surface_height(lookup, heights, x, z)) return false;
+	} }
+
+	return true;
+}
+void move_item(Chunk_Lookup* lookup, u16* blocks, World_Item* item, float dtime)
+{
+	vec3 pos = item->position;
+	vec3 vel = item->velocity;
+
+	// a block was placed on top of the item, pop it out
+	if (box_hits_blocks(lookup, blocks, pos + ITEM_MIN, pos + ITEM_MAX))
+	{
+		item->position.y = floor(pos.y) + 1;
+		item->velocity = vec3(0);
+		return;
+	}
+
+	// sweep one axis at a time & stop flush against whatever gets hit
+	for (uint axis = 0; axis < 3; axis++)
+	{
+		vec3 next = pos;
+		next[axis] += vel[axis] * dtime;
+
+		if (box_hits_blocks(lookup, blocks, next + ITEM_MIN, next + ITEM_MAX) == false)
+		{
+			pos = next;
+			continue;
+		}
+
+		if (vel[axis] < 0) pos[axis] = glm::max(pos[axis], floor(next[axis] + ITEM_MIN[axis]) + 1 - ITEM_MIN[axis]);
+		else               pos[axis] = glm::min(pos[axis], floor(next[axis] + ITEM_MAX[axis]) - ITEM_MAX[axis]);
+
+		vel[axis] = 0;
+	}
+
+	item->position = pos;
+	item->velocity = vel;
+}
+
+ivec3 item_grid_coords(vec3 position) { return ivec3(floor(position / (float)ITEM_GRID_CELL_SIZE)); }
+uint item_grid_cell(ivec3 coords)
+{
+	uint hash = ((uint)coords.x * 73856093) ^ ((uint)coords.y * 19349663) ^ ((uint)coords.z * 83492791);
+	return hash & (ITEM_GRID_CELLS - 1);
+}
+void update_grid(World_Items* items)
+{
+	uint* cell_start = items->cell_start;
+	memset(cell_start, 0, sizeof(items->cell_start));
+
+	for (uint i = 0; i < items->count; i++)
+		cell_start[item_grid_cell(item_grid_coords(items->items[i].position))]++;
+
+	// running total : cell_start[c] = end of cell c
+	for (uint c = 1; c <= ITEM_GRID_CELLS; c++)
+		cell_start[c] += cell_start[c - 1];
+
+	// filling each cell from the back leaves cell_start[c] = start of cell c
+	for (uint i = items->count; i-- > 0;)
+		items->cell_items[--cell_start[item_grid_cell(item_grid_coords(items->items[i].position))]] = i;
+}
+void merge_items(World_Items* items) // combines identical stacks that are close to each other
+{
+	World_Item* list = items->items;
+
+	for (uint i = 0; i < items->count; i++)
+	{
+		if (list[i].item.type == NULL || list[i].item.count >= max_stack(list[i].item)) continue;
+
+		ivec3 coords = item_grid_coords(list[i].position);
+
+		for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+		for (int z = -1; z <= 1; z++)
+		{
+			uint cell = item_grid_cell(coords + ivec3(x, y, z));
+
+			for (uint n = items->cell_start[cell]; n < items->cell_start[cell + 1]; n++)
+			{
+				uint j = items->cell_items[n];
+				if (j <= i || list[j].item.type == NULL || list[j].item.count >= max_stack(list[j].item)) continue;
+
+				if (list[j].item.type != list[i].item.type || list[j].item.id != list[i].item.id) continue;
+
+				vec3 d = list[j].position - list[i].position;
+				if (dot(d, d) > WORLD_ITEM_MERGE_RADIUS * WORLD_ITEM_MERGE_RADIUS) continue;
+
+				uint moved = glm::min(list[j].item.count, max_stack(list[i].item) - list[i].item.count);
+				list[i].item.count += moved;
+				list[j].item.count -= moved;
+
+				if (list[j].item.count == 0) list[j].item = {};
+				if (list[i].item.count >= max_stack(list[i].item)) goto next_item;
+			}
+		} } }
+
+	next_item:;
+	}
+
+	for (uint i = items->count; i-- > 0;) // remove emptied stacks
+		if (list[i].item.type == NULL) remove(items, i);
+}
+
+// block entities : kept in step with the blocks through the chunk loader's entity log
+
+void drop_contents(Block_Entities* entities, Entity_Slot slot, World_Items* items)
+{
+	uint count;
+	Item* contents = entity_items(entities, slot, &count);
+
+	for (uint i = 0; i < count; i++)
+		spawn(items, contents[i], vec3(slot.pos));
+}
+void sync_entity(Block_Entities* entities, Chunk_Loader* chunks, World_Items* items, ivec3 pos) // matches the entity at 'pos' to the block there
+{
+	uint index = find_block(&chunks->lookup, pos);
+	Entity_Slot* slot = find_slot(entities, pos);
+
+	u16 block = (index == INVALID_BLOCK_INDEX) ? BLOCK_AIR : chunks->blocks[index];
+	if (slot->block == block) return;
+
+	if (slot->block)
+	{
+		// if the chunk was unloaded the entity is dropped with it, whatever it held is lost (chunks aren't saved to disk)
+		if (index != INVALID_BLOCK_INDEX) drop_contents(entities, *slot, items); // the block was replaced, whatever it held falls out
+		if (block_entity_type(slot->block) == ENTITY_PIPE) disconnect_pipe(entities, pos);
+		remove_entity(entities, slot);
+	}
+
+	if (block_entity_type(block) && create_entity(entities, pos, block, chunks->lookup.tiers[index / NUM_CHUNK_BLOCKS]) && block_entity_type(block) == ENTITY_PIPE)
+		connect_pipe(entities, pos);
+
+	touch_networks(entities, pos);
+}
+void update(Block_Entities* entities, Chunk_Loader* chunks, World_Items* items)
+{
+	Entity_Log* log = &chunks->entity_log;
+	Chunk_Lookup* lookup = &chunks->lookup;
+
+	// chunks were loaded / unloaded (or too much changed to be logged) : check every entity
+	if (lookup->x != entities->lookup_x || lookup->z != entities->lookup_z || log->overflow)
+	{
+		for (uint type = ENTITY_CHEST; type < NUM_ENTITY_TYPES; type++)
+		for (uint i = entities->counts[type]; i-- > 0;) // backwards, removing one moves the last into its place
+			sync_entity(entities, chunks, items, entity_pos(entities, type, i));
+
+		update_tiers(entities, lookup);
+		entities->lookup_x = lookup->x;
+		entities->lookup_z = lookup->z;
+	}
+
+	if (log->overflow) // & every block that should have one
+	{
+		for (uint i = 0; i < NUM_CHUNKS; i++)
+		{
+			Chunk chunk = chunks->loaded_chunks[i];
+
+			for (int y = 0; y < CHUNK_Y; y++) {
+			for (int z = 0; z < CHUNK_Z; z++) {
+			for (int x = 0; x < CHUNK_X; x++)
+			{
+				u16 block = chunks->blocks[BLOCK_INDEX(x, y, z, chunk.blocks_index)];
+				if (block_entity_type(block) == ENTITY_NONE) continue;
+
+				ivec3 pos = ivec3(chunk.x + x, y, chunk.z + z);
+				if (find_slot(entities, pos)->block != block)
+					sync_entity(entities, chunks, items, pos);
+			} } }
+		}
+	}
+	else
+	{
+		for (uint i = 0; i < log->count; i++)
+			sync_entity(entities, chunks, items, log->positions[i]);
+	}
+
+	log->count = 0;
+	log->overflow = false;
+
+	Transport* transport = &entities->transport; // items that had nowhere left to go
+	for (uint i = 0; i < transport->num_drops; i++)
+		spawn(items, transport->drops[i], vec3(transport->drop_pos[i]));
+	transport->num_drops = 0;
+}
+
+// simulation : loaded chunks are ticked at a rate set by their tier, within a time budget per tick.
+// chunk ticks that don't fit in the budget are owed & done on the next tick, unflowed fluid cells stay queued.
+
+#define TICK_TIME (1.f / TICKS_PER_SECOND) // seconds
+#define TICK_BUDGET 2000 // microseconds of simulation per tick
+#define MAX_TICKS_OWED 4 // per chunk, any more than that are dropped
+#define RANDOM_TICKS_PER_CHUNK 48 // random blocks updated every time a chunk is ticked
+#define FLUID_TICK_RATE 2 // fluids flow every 2nd tick
+
+struct Tick_Stats // per tier, for the last tick
+{
+	uint chunk_ticks, fluid_cells;
+	Timestamp time; // get_timestamp() units
+};
+
+struct Tick_Scheduler
+{
+	uint tick;
+	float timer;
+	u8 owed[NUM_CHUNKS]; // chunk ticks still to do, by blocks_index
+	uint cursor[NUM_TIERS]; // round robin through loaded_chunks, so running out of time doesn't always skip the same chunks
+	Tick_Stats stats[NUM_TIERS];
+};
+
+void random_tick(Chunk_Loader* chunks, ivec3 pos)
+{
+	Chunk_Lookup* lookup = &chunks->lookup;
+
+	uint above = find_block(lookup, pos + ivec3(0, 1, 0));
+	if (above == INVALID_BLOCK_INDEX) return;
+
+	u16 block_above = chunks->blocks[above];
+
+	switch (get_block(lookup, chunks->blocks, pos))
 	{
-		if (items[i].item.type == NULL)
+	case BLOCK_GRASS: { // dies when covered (leaves are grass blocks too, so not by those)
+		if (is_solid(block_above) && block_above != BLOCK_GRASS)
+			set_block(chunks, pos, BLOCK_DIRT);
+	} break;
+
+	case BLOCK_DIRT: { // grass spreads to lit dirt next to it
+		u8 light = chunks->light[above];
+		if (is_solid(block_above) || max(light >> 4, light & 0xF) < 9) break;
+
+		uint r = random_uint();
+		ivec3 from = pos + ivec3((int)(r % 3) - 1, (int)((r / 3) % 3) - 1, (int)((r / 9) % 3) - 1);
+
+		if (get_block(lookup, chunks->blocks, from) == BLOCK_GRASS)
+			set_block(chunks, pos, BLOCK_GRASS);
+	} break;
+	}
+}
+void tick_chunk(Chunk_Loader* chunks, Chunk chunk)
+{
+	for (uint i = 0; i < RANDOM_TICKS_PER_CHUNK; i++)
+	{
+		uint r = random_uint();
+		random_tick(chunks, ivec3(chunk.x + (r % CHUNK_X), (r >> 8) % CHUNK_Y, chunk.z + ((r >> 4) % CHUNK_Z)));
+	}
+}
+
+void tick(Tick_Scheduler* ticks, Chunk_Loader* chunks, Block_Entities* entities)
+{
+	Timestamp start = get_timestamp();
+	uint tick = ++ticks->tick;
+
+	for (uint i = 0; i < NUM_CHUNKS; i++)
+	{
+		u16 blocks_index = chunks->loaded_chunks[i].blocks_index;
+		uint rate = TIER_TICK_RATE[chunks->lookup.tiers[blocks_index]];
+
+		if (rate && (tick % rate) == 0 && ticks->owed[blocks_index] < MAX_TICKS_OWED)
+			ticks->owed[blocks_index]++;
+	}
+
+	for (uint tier = TIER_ACTIVE; tier <= TIER_BORDER; tier++) // active chunks get the budget first
+	{
+		Tick_Stats* stats = ticks->stats + tier;
+		*stats = {};
+
+		Timestamp tier_start = get_timestamp();
+
+		if ((tick % (FLUID_TICK_RATE * TIER_TICK_RATE[tier])) == 0)
+			stats->fluid_cells = tick_fluids(chunks, tier, start, TICK_BUDGET);
+
+		uint cursor = ticks->cursor[tier];
+		for (uint n = 0; n < NUM_CHUNKS; n++)
 		{
-			items[i].item = item;
-			items[i].position = position;
-			items[i].velocity = {0, 1, 0};
-			return;
+			if (calculate_microseconds_elapsed(start, get_timestamp()) > TICK_BUDGET) break;
+
+			uint i = (cursor + n) % NUM_CHUNKS;
+			Chunk chunk = chunks->loaded_chunks[i];
+			if (chunks->lookup.tiers[chunk.blocks_index] != tier || ticks->owed[chunk.blocks_index] == 0) continue;
+
+			tick_chunk(chunks, chunk);
+			ticks->owed[chunk.blocks_index]--;
+			ticks->cursor[tier] = i + 1;
+			stats->chunk_ticks++;
 		}
+
+		stats->time = get_timestamp() - tier_start;
 	}
+
+	tick_entities(entities);
+}
+void update(Tick_Scheduler* ticks, Chunk_Loader* chunks, Block_Entities* entities, float dtime)
+{
+	ticks->timer += dtime;
+	if (ticks->timer < TICK_TIME) return;
+
+	ticks->timer = glm::min(ticks->timer - TICK_TIME, TICK_TIME); // at most 1 tick per frame, don't try to catch up
+	tick(ticks, chunks, entities);
 }
 
 struct World
 {
 	Chunk_Loader chunks;
-	World_Item items[MAX_WORLD_ITEMS];
+	World_Items items;
+	Tick_Scheduler ticks;
+	Block_Entities entities;
 };
 
-void init(World* world, vec3 position)
+void init(World* world, vec3 position, uint seed = 0, uint max_items = WORLD_ITEM_CAPACITY)
 {
 	// without this, all chunks will have blocks_index = 0
 	for (uint i = 0; i < NUM_CHUNKS; i++)
 		world->chunks.loaded_chunks[i].blocks_index = i;
+
+	world->chunks.seed = seed;
+
+	init(&world->items, max_items);
 }
-void update(World* world, Camera camera, Mouse mouse, float dtime, Item* player_items, Audio* pops)
+void update(World* world, Camera camera, Mouse mouse, float dtime, Inventory* inventory, Item* player_items, Audio* pops)
 {
 	update_chunks(&world->chunks, camera.position);
+	update(&world->ticks, &world->chunks, &world->entities, dtime);
+	update(&world->entities, &world->chunks, &world->items);
 
 	// world item physics
-	World_Item* items = world->items;
-	for (uint i = 0; i < MAX_WORLD_ITEMS; i++)
+	World_Items* items = &world->items;
+	Chunk_Lookup lookup = world->chunks.lookup;
+
+	for (uint i = 0; i < items->count;)
 	{
-		if (items[i].item.type > 0)
+		World_Item* item = items->items + i;
+
+		vec3 dir = camera.position - item->position;
+		float distance_to_player = length(dir);
+
+		if (distance_to_player < 2)
 		{
-			vec3 dir = camera.position - items[i].position;
-			float distance_to_player = length(dir);
+			uint taken = give(inventory, player_items, item->item); // as much as fits
+			if (taken) play_audio(pops[random_uint() % 3]);
 
-			if (distance_to_player < 2)
+			item->item.count -= taken;
+			if (item->item.count == 0)
 			{
-				play_audio(pops[random_uint() % 3]);
-				if(give_player_item(player_items, items[i].item))
-					items[i] = {};
+				remove(items, i);
+				continue; // the last item was moved into this slot
 			}
-			else
-			{
-				if (distance_to_player < 4) // this should be else if
-					items[i].velocity += normalize(dir) * dtime * 2.f;
-				else
-					items[i].velocity *= vec3(0, 1, 0);
+		}
 
-				vec3 pos = items[i].position;
-				vec3 vel = items[i].velocity;
+		if (distance_to_player < 4)
+			item->velocity += normalize(dir) * dtime * 2.f;
+		else
+			item->velocity *= vec3(0, 1, 0);
 
-				pos += vel * dtime;
+		item->velocity.y = glm::max(item->velocity.y + (GRAVITY * dtime), -TERMINAL_VELOCITY);
 
-				if (get_block(&world->chunks, pos))
-				{
-					//if(ceil(pos.x) - pos.x > floor(pos.x) - pos.x)
+		// falling through open air is the common case, skip the block tests for it
+		vec3 next = item->position + (item->velocity * dtime);
+		vec3 min = glm::min(item->position, next) + ITEM_MIN;
+		vec3 max = glm::max(item->position, next) + ITEM_MAX;
 
-					//vel.x = (ceil(pos.x) - pos.x) * 30; // bounce force
-					vel.y = (ceil(pos.y) - pos.y) * 30; // bounce force
-					//vel.z = (ceil(pos.z) - pos.z) * 30; // bounce force
-				}
-				else
-					vel.y += GRAVITY * dtime;
+		if (box_above_surface(&lookup, world->chunks.heights, min, max))
+			item->position = next;
+		else
+			move_item(&lookup, world->chunks.blocks, item, dtime);
 
-				items[i].position = pos;
-				items[i].velocity = vel;
-			}
-		}
+		i++;
 	}
+
+	update_grid(items);
+	merge_items(items);
 }
 
 // rendering
 
+// block textures : every tile of the block atlas becomes a layer of a texture array with its own mips, & a
+// material table (read in solid.vert) says which layer each face of each block uses, so meshes only store block ids
+
+#define MAX_BLOCK_LAYERS	64
+#define NUM_MATERIALS	BLOCK_WATER // blocks below this are meshed as solid cubes
+
+struct Block_Material // RGBA8UI texel of the material table
+{
+	u8 layer;
+	u8 metalness, roughness; // 0 - 255
+	u8 unused;
+};
+
+struct Block_Textures
+{
+	uint tile_size, num_layers;
+	byte* texels; // num_layers mip chains, see build_mips()
+	Block_Material materials[NUM_MATERIALS][6]; // [block][face]
+};
+
+bool build(Block_Textures* textures, const char* atlas_path, const char* material_path) // tiles are square & in a row
+{
+	int width, height, material_width, material_height, num_channels;
+
+	uint atlas_size = 0, material_size = 0;
+	byte* atlas_file    = open_asset(atlas_path   , &atlas_size   );
+	byte* material_file = open_asset(material_path, &material_size);
+	if (atlas_file == NULL || material_file == NULL)
+	{
+		out("ERROR : '" << (atlas_file ? material_path : atlas_path) << "' NOT FOUND!");
+		close_asset(atlas_file);
+		close_asset(material_file);
+		return false;
+	}
+
+	stbi_set_flip_vertically_on_load(true); // same as load_texture()
+	byte* atlas     = stbi_load_from_memory(atlas_file   , atlas_size   , &width         , &height         , &num_channels, 4);
+	byte* materials = stbi_load_from_memory(material_file, material_size, &material_width, &material_height, &num_channels, 4);
+	close_asset(atlas_file);
+	close_asset(material_file);
+
+	if (atlas == NULL || materials == NULL || height == 0 || width < height)
+	{
+		out("ERROR : '" << atlas_path << "' or '" << material_path << "' is broken");
+		stbi_image_free(atlas);
+		stbi_image_free(materials);
+		return false;
+	}
+
+	uint tile = height;
+	uint chain = mip_chain_size(tile);
+
+	textures->tile_size = tile;
+	textures->num_layers = glm::min(width / tile, (uint)MAX_BLOCK_LAYERS);
+	textures->texels = Alloc(byte, textures->num_layers * chain);
+
+	for (uint t = 0; t < textures->num_layers; t++)
+	{
+		byte* layer = textures->texels + (t * chain);
+
+		for (uint y = 0; y < tile; y++)
+			memcpy(layer + (y * tile * 4), atlas + (((y * width) + (t * tile)) * 4), tile * 4);
+
+		build_mips(layer, tile);
+	}
+
+	// blocks used to be drawn with tile (block - 1) of the atlas, wrapping around it. the material texture was
+	// read with the same coordinates, so each tile gets the average of the part of it that tile covered
+	for (uint t = 0; t < textures->num_layers && t < NUM_MATERIALS; t++)
+	{
+		uint x0 = (t * material_width) / textures->num_layers;
+		uint x1 = glm::max(x0 + 1, ((t + 1) * material_width) / textures->num_layers);
+		uint metalness = 0, roughness = 0, count = 0;
+
+		for (uint y = 0; y < material_height; y++)
+		for (uint x = x0; x < x1; x++, count++)
+		{
+			metalness += materials[((y * material_width) + x) * 4 + 0];
+			roughness += materials[((y * material_width) + x) * 4 + 1];
+		}
+
+		for (uint block = t + 1; block < NUM_MATERIALS; block += textures->num_layers)
+		for (uint face = 0; face < 6; face++)
+			textures->materials[block][face] = { (u8)t, (u8)(metalness / count), (u8)(roughness / count) };
+	}
+
+	stbi_image_free(atlas);
+	stbi_image_free(materials);
+	return true;
+}
+
 struct Item_Drawable
 {
 	vec3 position;
@@ -96,7 +545,8 @@ struct Item_Drawable
 
 struct World_Renderer
 {
-	GLuint texture, material;
+	GLuint texture, material; // atlas, for world items
+	GLuint block_textures, material_table; // for terrain
 
 	// terrain
 	Shader solid_shader, fluid_shader;
@@ -104,27 +554,58 @@ struct World_Renderer
 
 	// world items
 	uint num_blocks; // what is this????
-	Item_Drawable blocks[MAX_WORLD_ITEMS]; // just for blocks
-	Item_Drawable items [MAX_WORLD_ITEMS]; // general purpose
+	Item_Drawable* blocks; // just for blocks
+	Item_Drawable* items;  // general purpose
 	Drawable_Mesh_UV block_mesh, item_mesh;
 	Shader block_shader;
 	mat3 transform;
 };
 
-void init(World_Renderer* renderer)
+bool reload_block_textures(Hot_Reload* reload) // the texture array can change size, so it is made again
+{
+	World_Renderer* renderer = (World_Renderer*)reload->target;
+
+	Block_Textures* textures = Alloc(Block_Textures, 1);
+	bool built = build(textures, reload->files[0].path, reload->files[1].path);
+
+	if (built)
+	{
+		glDeleteTextures(1, &renderer->block_textures);
+		glDeleteTextures(1, &renderer->material_table);
+		renderer->block_textures = make_texture_array(textures->texels, textures->tile_size, textures->num_layers);
+		renderer->material_table = make_uint_texture((u8*)textures->materials, 6, NUM_MATERIALS);
+	}
+
+	free(textures->texels);
+	free(textures);
+	return built;
+}
+
+void init(World_Renderer* renderer, uint max_items = WORLD_ITEM_CAPACITY)
 {
 	renderer->texture  = load_texture("assets/textures/block_atlas.bmp");
 	renderer->material = load_texture("assets/textures/materials.bmp"  );
 
+	Block_Textures* textures = Alloc(Block_Textures, 1);
+	build(textures, "assets/textures/block_atlas.bmp", "assets/textures/materials.bmp");
+	renderer->block_textures = make_texture_array(textures->texels, textures->tile_size, textures->num_layers);
+	renderer->material_table = make_uint_texture((u8*)textures->materials, 6, NUM_MATERIALS);
+	free(textures->texels);
+	free(textures);
+	watch(&hot_reloader, reload_block_textures, renderer, 0, "assets/textures/block_atlas.bmp", "assets/textures/materials.bmp");
+
 	// terrain
 	for (uint i = 0; i < 9; i++)
 		init(renderer->chunks + i);
 
-	load(&renderer->solid_shader, "assets/shaders/chunk/solid.vert", "assets/shaders/mesh_uv.frag");
+	load(&renderer->solid_shader, "assets/shaders/chunk/solid.vert", "assets/shaders/chunk/solid.frag");
 	load(&renderer->fluid_shader, "assets/shaders/chunk/fluid.vert", "assets/shaders/mesh.frag");
 
 	// world items
-	load(&renderer->block_mesh, "assets/meshes/block.mesh_uv", sizeof(renderer->blocks));
+	renderer->blocks = Alloc(Item_Drawable, max_items);
+	renderer->items  = Alloc(Item_Drawable, max_items);
+
+	load(&renderer->block_mesh, "assets/meshes/block.mesh_uv", max_items * sizeof(Item_Drawable));
 	mesh_add_attrib_vec3 (3, sizeof(Item_Drawable), 0); // world position
 	mesh_add_attrib_float(4, sizeof(Item_Drawable), sizeof(vec3)); // texture offset
 
@@ -134,18 +615,29 @@ void update(World_Renderer* renderer, World* world, float dtime)
 {
 	// terrain
 	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++) // TODO : we don't need to render chunks the player can't see
-		update(renderer->chunks + i, world->chunks.active[i], world->chunks.blocks);
+	{
+		Chunk chunk = world->chunks.active[i];
+
+		// only remesh chunks that changed (or that moved into this slot)
+		if (renderer->chunks[i].chunk_id == chunk.id && world->chunks.dirty[chunk.blocks_index] == false)
+			continue;
+
+		update(renderer->chunks + i, chunk, &world->chunks);
+		world->chunks.dirty[chunk.blocks_index] = false;
+	}
 
 	// world items
 	static float timer = 0; timer = (timer > TWOPI) ? 0 : timer + (TWOPI * dtime) / 5;
 	float offset = .05f + (sinf(timer * 2.f) * .05f);
 
 	renderer->transform = mat3(.25) * mat3(rotate(timer, vec3(0, 1, 0)));
+	bind(renderer->block_shader);
+	set_mat3(renderer->block_shader, UNIFORM_TRANSFORM, renderer->transform);
 
-	World_Item* items = world->items;
+	World_Item* items = world->items.items;
 
 	uint num_blocks = 0;
-	for (uint i = 0; i < MAX_WORLD_ITEMS; i++)
+	for (uint i = 0; i < world->items.count; i++)
 	{
 		switch (items[i].item.type)
 		{
@@ -159,30 +651,59 @@ void update(World_Renderer* renderer, World* world, float dtime)
 	renderer->num_blocks = num_blocks;
 	update(renderer->block_mesh, num_blocks * sizeof(Item_Drawable), (byte*)renderer->blocks);
 }
-void draw(World_Renderer* renderer, mat4 proj_view, float dtime)
+void draw(World_Renderer* renderer, Render_Queue* queue) // proj_view & time come from the frame uniforms
 {
 	// terrain
-	bind(renderer->solid_shader);
-	set_mat4(renderer->solid_shader, "proj_view", proj_view);
-	bind_texture(renderer->texture, 0);
-	bind_texture(renderer->material, 1);
-
-	for (uint i = 0; i < 9; i++) // draw solids
-		draw(renderer->chunks[i].solid_mesh, renderer->chunks[i].num_solids);
+	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++)
+	{
+		Chunk_Renderer* chunk_renderer = renderer->chunks + i;
+		Chunk chunk = {}; chunk.id = chunk_renderer->chunk_id;
+		vec3 center = vec3((int)chunk.x + (CHUNK_X / 2), CHUNK_Y / 2, (int)chunk.z + (CHUNK_Z / 2)); // coords are stored unsigned
 
-	static float timer = 0; timer += .25f * dtime;
-	bind(renderer->fluid_shader);
-	set_mat4(renderer->fluid_shader, "proj_view", proj_view);
-	set_float(renderer->fluid_shader, "timer", timer);
+		Drawable_Mesh_UV solids = chunk_renderer->solid_mesh;
+		Draw_Packet* packet = submit(queue, PASS_GEOMETRY, renderer->solid_shader, solids.VAO, solids.num_indices, chunk_renderer->num_solids, center);
+		set_texture(packet, 0, renderer->block_textures, GL_TEXTURE_2D_ARRAY);
+		set_texture(packet, 2, renderer->material_table);
 
-	for (uint i = 0; i < 9; i++) // draw fluids
-		draw(renderer->chunks[i].fluid_mesh, renderer->chunks[i].num_fluids);
+		Drawable_Mesh fluids = chunk_renderer->fluid_mesh;
+		submit(queue, PASS_GEOMETRY, renderer->fluid_shader, fluids.VAO, fluids.num_indices, chunk_renderer->num_fluids, center);
+	}
 
 	// world items
-	bind(renderer->block_shader);
-	set_mat4(renderer->block_shader, "proj_view", proj_view);
-	set_mat3(renderer->block_shader, "transform", renderer->transform);
-	bind_texture(renderer->texture , 0);
-	bind_texture(renderer->material, 1);
-	draw(renderer->block_mesh, renderer->num_blocks);
+	Drawable_Mesh_UV blocks = renderer->block_mesh;
+	Draw_Packet* packet = submit(queue, PASS_GEOMETRY, renderer->block_shader, blocks.VAO, blocks.num_indices, renderer->num_blocks);
+	set_texture(packet, 0, renderer->texture);
+	set_texture(packet, 1, renderer->material);
+}
+
+// lights : furnaces & machines glow while they are working
+
+#define LIGHT_DISTANCE 128.f // blocks, lights further from the camera than this are left out
+
+void gather_lights(Light_Clusters* clusters, Block_Entities* entities, vec3 view_pos) // every frame
+{
+	clear(clusters);
+
+	auto in_range = [view_pos](vec3 position) { vec3 d = position - view_pos; return dot(d, d) < LIGHT_DISTANCE * LIGHT_DISTANCE; };
+
+	for (uint i = 0; i < entities->counts[ENTITY_FURNACE]; i++)
+	{
+		Furnace* furnace = entities->furnaces + i;
+		vec3 position = vec3(furnace->pos) + vec3(.5);
+		if (furnace->busy && in_range(position)) add_light(clusters, position, 8, vec3(1, .55, .2), 2);
+	}
+
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++)
+	{
+		Machine* machine = entities->machines + i;
+		vec3 position = vec3(machine->pos) + vec3(.5);
+		if (!machine->busy || !in_range(position)) continue;
+
+		switch (machine->block)
+		{
+		case BLOCK_GENERATOR: add_light(clusters, position, 8, vec3(1, .55, .2), 2); break;
+		case BLOCK_SMELTER  : add_light(clusters, position, 8, vec3(1, .4, .1), 2 * machine->power); break;
+		default: if (machine->power > 0) add_light(clusters, position, 5, vec3(.4, .7, 1), machine->power);
+		}
+	}
 }
\ No newline at end of file
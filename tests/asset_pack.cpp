@@ -0,0 +1,113 @@
+#include <proprietary/boilerplate.h>
+#include "test.h"
+
+// asset pack : every asset in assets/pack.txt is packed into tests/bin/assets.pack, then loaded & touched (every
+// cache line) the way startup does, from loose files & from the pack. the first load of each is the cold one for
+// this process (the pack isn't mapped yet, nothing has been read) & the best of the runs after it is the warm one.
+// the os file cache isn't emptied, so a cold disk is slower still for both. every packed asset has to match its
+// file byte for byte, be ASSET_ALIGNMENT aligned & followed by a 0, & assets that aren't packed still load.
+// a listed file that doesn't exist is left out of the pack & missing from both the same way
+
+#define LIST_PATH "assets/pack.txt"
+#define PACK_PATH "tests/bin/assets.pack"
+#define WARM_RUNS 50
+#define MAX_PATHS 256
+
+char* paths[MAX_PATHS];
+uint num_paths;
+
+uint64 touch(byte* asset, uint size) // what a loader does to it, at the least
+{
+	uint64 sum = 0;
+	for (uint i = 0; i < size; i += 64) sum += asset[i];
+	return sum;
+}
+Timestamp load_startup_assets(uint* bytes, uint* missing, uint64* sum)
+{
+	Timestamp start = get_timestamp();
+	*bytes = *missing = 0;
+	for (uint i = 0; i < num_paths; i++)
+	{
+		uint size = 0;
+		byte* asset = open_asset(paths[i], &size);
+		if (!asset) { (*missing)++; continue; }
+
+		*sum += touch(asset, size);
+		*bytes += size;
+		close_asset(asset);
+	}
+
+	return get_timestamp() - start;
+}
+float ms(Timestamp time) { return calculate_microseconds_elapsed(0, time) / 1000.f; }
+
+int main()
+{
+	char* list = (char*)read_file(LIST_PATH);
+	expect(list != NULL);
+	if (!list) return finish("asset_pack");
+
+	for (char* line = strtok(list, "\r\n"); line && num_paths < MAX_PATHS; line = strtok(NULL, "\r\n")) // like pack_assets()
+	{
+		while (*line == ' ' || *line == '\t') line++;
+		if (*line != '#' && *line != 0) paths[num_paths++] = line;
+	}
+
+	expect(pack_assets(LIST_PATH, PACK_PATH));
+
+	uint bytes = 0, missing = 0, pack_missing = 0;
+	uint64 loose_sum = 0, pack_sum = 0;
+
+	// cold : the first time in this process, the loose files before the pack is even opened
+	Timestamp loose_cold = load_startup_assets(&bytes, &missing, &loose_sum);
+
+	Timestamp start = get_timestamp();
+	expect(open_asset_pack(PACK_PATH));
+	Timestamp pack_cold = (get_timestamp() - start) + load_startup_assets(&bytes, &pack_missing, &pack_sum);
+	expect(pack_missing == missing && pack_sum == loose_sum);
+
+	print("%u assets (%u missing), %u bytes. cold : loose files %.3f ms, the pack (mapping it too) %.3f ms\n", num_paths - missing, missing, bytes, ms(loose_cold), ms(pack_cold));
+
+	// warm : the best of the runs after that, with the pack taken away for the loose files
+	Asset_Pack pack = asset_pack;
+	Timestamp loose_warm = ~0ull, pack_warm = ~0ull;
+	for (uint run = 0; run < WARM_RUNS; run++)
+	{
+		uint64 sum = 0;
+		asset_pack = {};
+		loose_warm = glm::min(loose_warm, load_startup_assets(&bytes, &missing, &sum));
+		asset_pack = pack;
+		pack_warm  = glm::min(pack_warm,  load_startup_assets(&bytes, &missing, &sum));
+	}
+
+	print("warm : loose files %.3f ms, the pack %.3f ms (best of %u)\n", ms(loose_warm), ms(pack_warm), WARM_RUNS);
+	expect(pack_warm < loose_warm);
+
+	// the packed assets are the files
+	uint mismatched = 0, packed = 0;
+	for (uint i = 0; i < num_paths; i++)
+	{
+		uint packed_size = 0, file_size = 0;
+		byte* file = read_file(paths[i], &file_size);
+		if (!file) { mismatched += find_asset(paths[i]) != NULL; continue; }
+		byte* asset = open_asset(paths[i], &packed_size);
+
+		packed += find_asset(paths[i]) != NULL;
+		mismatched += !asset || packed_size != file_size || memcmp(asset, file, file_size + 1) || ((uintptr_t)asset & (ASSET_ALIGNMENT - 1));
+
+		close_asset(asset);
+		free(file);
+	}
+
+	print("%u of %u packed, %u that don't match their file\n", packed, num_paths - missing, mismatched);
+	expect(packed == num_paths - missing && mismatched == 0);
+
+	// not in the pack : read from its file, & given back with free()
+	uint size = 0;
+	byte* loose = open_asset("assets/textures/palette.bmp", &size);
+	expect(find_asset("assets/textures/palette.bmp") == NULL && loose && size > 0);
+	close_asset(loose);
+	expect(open_asset("assets/nothing.here") == NULL);
+
+	return finish("asset_pack");
+}
@@ -0,0 +1,26 @@
+@echo off
+rem builds & runs every test in this folder, from a visual studio developer command prompt.
+rem run it from the folder the game runs in (the tests read assets/ like the game does) :
+rem     tests\build.bat              every test
+rem     tests\build.bat particles    just tests\particles.cpp
+
+setlocal enabledelayedexpansion
+set tests=%~dp0
+set failed=0
+set pattern=%1
+if "%pattern%"=="" set pattern=*
+
+if not exist "%tests%bin" mkdir "%tests%bin"
+
+for %%f in ("%tests%%pattern%.cpp") do (
+	cl /nologo /std:c++17 /O2 /EHsc /W1 /I "%tests%..\src" /I "%tests%..\dependencies" "%%f" /Fo"%tests%bin\\" /Fe"%tests%bin\%%~nf.exe" /link /LIBPATH:"%tests%..\dependencies" > "%tests%bin\%%~nf.log"
+	if errorlevel 1 (
+		echo %%~nf : DOES NOT BUILD, see tests\bin\%%~nf.log
+		set failed=1
+	) else (
+		"%tests%bin\%%~nf.exe"
+		if errorlevel 1 set failed=1
+	)
+)
+
+exit /b %failed%
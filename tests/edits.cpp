@@ -0,0 +1,190 @@
+#include "chunk.h"
+#include "test.h"
+
+// block edits : explosions of radius 8, 12 & 16 are blown into generated terrain across chunk borders with
+// fill_sphere(). every block whose center is inside the sphere has to be air, nothing outside it may change, &
+// the chunks that touch it (or are next to it) have to be marked dirty, more may be if the light in them changed.
+// then a build script of boxes, cylinders & spheres is applied as one batch & block by block with set_block() :
+// the blocks, surface & light have to come out the same. both are timed against doing it block by block, like
+// fill_sphere() did before batches (kept below, it only reaches the chunk the center is in)
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+#define TIMING_RUNS  10
+
+Chunk_Loader* chunks;
+Chunk_Loader* original; // the world before any edit, every run starts from it
+
+void fill_sphere_per_block(Chunk_Loader* chunks, vec3 sphere_pos, float radius, u16 block) // what batches replaced
+{
+	uint chunk_x = (uint)sphere_pos.x & 0xFFF0;
+	uint chunk_z = (uint)sphere_pos.z & 0xFFF0;
+
+	vec3 local_sphere_pos = sphere_pos - vec3(chunk_x, 0, chunk_z) - vec3(.5);
+
+	for (uint x = 0; x < CHUNK_X; ++x) {
+	for (uint z = 0; z < CHUNK_Z; ++z) {
+	for (uint y = 0; y < CHUNK_Y; ++y)
+	{
+		if (length(vec3(x, y, z) - local_sphere_pos) < radius)
+			set_block(chunks, vec3(x, y, z) + vec3(chunk_x, 0, chunk_z), block);
+	} } }
+}
+void apply_per_block(Edit_Batch* batch, Chunk_Loader* chunks) // the same edits, one set_block() at a time
+{
+	for (uint e = 0; e < batch->num_edits; e++)
+	{
+		Block_Edit edit = batch->edits[e];
+
+		ivec3 min, max;
+		get_bounds(edit, &min, &max);
+
+		for (int y = min.y; y <= max.y; y++) {
+		for (int z = min.z; z <= max.z; z++) {
+		for (int x = min.x; x <= max.x; x++)
+		{
+			ivec3 pos = ivec3(x, y, z);
+			if (get_block(&chunks->lookup, chunks->blocks, pos) != edit.block && inside(edit, vec3(pos) + vec3(.5)))
+				set_block(chunks, pos, edit.block);
+		} } }
+	}
+
+	batch->num_edits = 0;
+}
+
+Edit_Batch build_script(ivec3 base) // a walled keep with 4 round towers
+{
+	Edit_Batch batch = {};
+	add_box(&batch, base + ivec3(-2, -1, -2), base + ivec3(26, 0, 26), BLOCK_STONE); // foundation
+	add_box(&batch, base + ivec3(0, 1, 0), base + ivec3(24, 8, 24), BLOCK_BRICK);
+	add_box(&batch, base + ivec3(1, 1, 1), base + ivec3(23, 8, 23), BLOCK_AIR); // hollow
+	add_box(&batch, base + ivec3(10, 1, 0), base + ivec3(14, 5, 0), BLOCK_AIR); // gate
+
+	for (int i = 0; i < 4; i++)
+	{
+		vec3 corner = vec3(base) + vec3((i & 1) ? 24.5f : .5f, 1, (i & 2) ? 24.5f : .5f);
+		add_cylinder(&batch, corner, 3.5f, 14, BLOCK_STONE);
+		add_cylinder(&batch, corner + vec3(0, 1, 0), 2.5f, 12, BLOCK_AIR);
+		add_sphere(&batch, corner + vec3(0, 15, 0), 3.5f, BLOCK_BRICK); // roof
+	}
+
+	add_box(&batch, base + ivec3(6, 1, 6), base + ivec3(18, 18, 18), BLOCK_STONE); // keep
+	add_box(&batch, base + ivec3(7, 1, 7), base + ivec3(17, 17, 17), BLOCK_AIR);
+	add_sphere(&batch, vec3(base) + vec3(12.5f, 19, 12.5f), 6, BLOCK_WATER); // a cistern on the roof
+	add_sphere(&batch, vec3(base) + vec3(-6, 4, 12), 5, BLOCK_AIR); // a hole in the hill next to it
+
+	return batch;
+}
+
+bool overlaps(Chunk_Lookup* lookup, uint lx, uint lz, ivec3 min, ivec3 max)
+{
+	int x = lookup->x + (lx * CHUNK_X), z = lookup->z + (lz * CHUNK_Z);
+	return x <= max.x && x + CHUNK_X - 1 >= min.x && z <= max.z && z + CHUNK_Z - 1 >= min.z;
+}
+
+int main()
+{
+	chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+	update_chunks(chunks, SCENE_CENTER);
+
+	original = Alloc(Chunk_Loader, 1);
+	memset(chunks->dirty, 0, sizeof(chunks->dirty));
+	memcpy(original, chunks, sizeof(Chunk_Loader));
+
+	Chunk_Lookup* lookup = &chunks->lookup;
+	Chunk center = chunks->active[4];
+
+	// explosions, centered near a chunk corner so they always cross into the chunks around it
+	float radii[3] = { 8, 12, 16 };
+	for (uint r = 0; r < 3; r++)
+	{
+		float radius = radii[r];
+		int height = get_surface_height(chunks, center.x + 14, center.z + 2);
+		vec3 blast = vec3(center.x + 14.3f, height + .6f, center.z + 2.7f);
+
+		Timestamp batched = ~0ull, per_block = ~0ull;
+		for (uint run = 0; run < TIMING_RUNS; run++)
+		{
+			memcpy(chunks, original, sizeof(Chunk_Loader));
+			Timestamp start = get_timestamp();
+			fill_sphere_per_block(chunks, blast, radius, BLOCK_AIR);
+			per_block = glm::min(per_block, get_timestamp() - start);
+
+			memcpy(chunks, original, sizeof(Chunk_Loader));
+			start = get_timestamp();
+			fill_sphere(chunks, blast, radius, BLOCK_AIR);
+			batched = glm::min(batched, get_timestamp() - start);
+		}
+
+		ivec3 min = ivec3(floor(blast - vec3(radius))), max = ivec3(floor(blast + vec3(radius)));
+		uint wrong = 0, removed = 0;
+		for (int y = 0; y < CHUNK_Y; y++) {
+		for (int z = min.z - 4; z <= max.z + 4; z++) {
+		for (int x = min.x - 4; x <= max.x + 4; x++)
+		{
+			ivec3 pos = ivec3(x, y, z);
+			vec3 d = vec3(pos) + vec3(.5) - blast;
+			u16 before = get_block(&original->lookup, original->blocks, pos);
+			u16 expected = (dot(d, d) < radius * radius) ? BLOCK_AIR : before;
+			u16 block = get_block(lookup, chunks->blocks, pos);
+
+			wrong += block != expected;
+			removed += block != before;
+		} } }
+
+		uint missed = 0, num_dirty = 0;
+		for (uint lx = 0; lx < LOADED_CHUNKS_WIDTH; lx++) {
+		for (uint lz = 0; lz < LOADED_CHUNKS_WIDTH; lz++)
+		{
+			u16 index = lookup->blocks_index[lx + (lz * LOADED_CHUNKS_WIDTH)];
+			missed += !chunks->dirty[index] && overlaps(lookup, lx, lz, min - ivec3(1, 0, 1), max + ivec3(1, 0, 1));
+			num_dirty += chunks->dirty[index];
+		} }
+
+		print("radius %2.0f : %5u blocks removed, %u wrong, %2u chunks dirty (%u missed) : %7.0f us, block by block %8.0f us (one chunk)\n",
+			radius, removed, wrong, num_dirty, missed, (float)calculate_microseconds_elapsed(0, batched), (float)calculate_microseconds_elapsed(0, per_block));
+		expect(removed > 0 && wrong == 0);
+		expect(num_dirty > 1 && missed == 0);
+	}
+
+	// the build script, on the ground across the border of the center chunk
+	ivec3 base = ivec3(center.x + 4, get_surface_height(chunks, center.x + 16, center.z + 16), center.z + 4);
+
+	Chunk_Loader* per_block = Alloc(Chunk_Loader, 1);
+	Timestamp batched_time = ~0ull, per_block_time = ~0ull;
+	uint num_edits = 0, left = 0;
+	for (uint run = 0; run < TIMING_RUNS; run++)
+	{
+		memcpy(per_block, original, sizeof(Chunk_Loader));
+		Edit_Batch batch = build_script(base);
+		num_edits = batch.num_edits;
+		Timestamp start = get_timestamp();
+		apply_per_block(&batch, per_block);
+		per_block_time = glm::min(per_block_time, get_timestamp() - start);
+
+		memcpy(chunks, original, sizeof(Chunk_Loader));
+		batch = build_script(base);
+		start = get_timestamp();
+		apply(&batch, chunks);
+		batched_time = glm::min(batched_time, get_timestamp() - start);
+		left += batch.num_edits;
+	}
+
+	uint changed = 0;
+	for (uint i = 0; i < NUM_CHUNKS * NUM_CHUNK_BLOCKS; i++) changed += chunks->blocks[i] != original->blocks[i];
+
+	bool same_blocks  = memcmp(chunks->blocks,  per_block->blocks,  sizeof(chunks->blocks))  == 0;
+	bool same_heights = memcmp(chunks->heights, per_block->heights, sizeof(chunks->heights)) == 0;
+	bool same_surface = memcmp(chunks->surface, per_block->surface, sizeof(chunks->surface)) == 0;
+	bool same_light   = memcmp(chunks->light,   per_block->light,   sizeof(chunks->light))   == 0;
+
+	print("build script : %u edits, %u blocks changed : batched %.0f us, block by block %.0f us\n", num_edits, changed,
+		(float)calculate_microseconds_elapsed(0, batched_time), (float)calculate_microseconds_elapsed(0, per_block_time));
+	print("               same blocks %d, heights %d, surface %d, light %d\n", same_blocks, same_heights, same_surface, same_light);
+	expect(changed > 1000 && left == 0);
+	expect(same_blocks && same_heights && same_surface && same_light);
+
+	return finish("edits");
+}
@@ -0,0 +1,168 @@
+#include "world.h"
+#include "test.h"
+
+// block entities : a chest is placed, emptied through get_next_item() & broken, then 100k machines are placed
+// with set_block() in a generated world & synced like the world does every frame. the hash & the dense arrays
+// have to agree with each other & with the blocks after that, after 20k machines are broken or replaced, after
+// an edit too big for the entity log & after the player moves & chunks unload. times lookups that hit & miss
+// against scanning the array, a pass over every machine, & what the syncing costs per entity
+
+#define SCENE_SEED     11
+#define SCENE_CENTER   vec3(116, 48, 116)
+#define NUM_MACHINES   100000
+#define NUM_LOOKUPS    1000000
+#define NUM_SCANS      1000
+#define NUM_CHURNED    20000
+
+World* world;
+
+bool consistent(Block_Entities* entities, Chunk_Loader* chunks) // every slot points at an entity at its position, on a block of its type
+{
+	uint used = 0;
+	for (uint i = 0; i < ENTITY_HASH_SIZE; i++)
+	{
+		Entity_Slot slot = entities->slots[i];
+		if (slot.block == BLOCK_AIR) continue;
+
+		used++;
+		if (find_slot(entities, slot.pos) != entities->slots + i) return false;
+		if (entity_pos(entities, block_entity_type(slot.block), slot.index) != slot.pos) return false;
+		if (get_block(&chunks->lookup, chunks->blocks, slot.pos) != slot.block) return false;
+	}
+
+	uint total = 0;
+	for (uint type = ENTITY_CHEST; type < NUM_ENTITY_TYPES; type++) total += entities->counts[type];
+	return total == used;
+}
+Timestamp sync_entities() // what update(World*) does with the entity log every frame
+{
+	Timestamp start = get_timestamp();
+	update(&world->entities, &world->chunks, &world->items);
+	return get_timestamp() - start;
+}
+Timestamp place(ivec3 pos, u16 block) // the sync when the entity log is full, like it would be once a frame
+{
+	set_block(&world->chunks, pos, block);
+	return (world->chunks.entity_log.count == ENTITY_LOG_SIZE) ? sync_entities() : 0;
+}
+float ns(Timestamp time, uint count) { return (calculate_microseconds_elapsed(0, time) * 1000.f) / count; }
+
+int main()
+{
+	world = Alloc(World, 1);
+	init(world, SCENE_CENTER, SCENE_SEED);
+	Chunk_Loader* chunks = &world->chunks;
+	Block_Entities* entities = &world->entities;
+	update_chunks(chunks, SCENE_CENTER);
+	sync_entities();
+
+	ivec3 corner = ivec3(chunks->lookup.x, 0, chunks->lookup.z);
+
+	// a chest, from placing it to breaking it
+	ivec3 chest_pos = corner + ivec3(50, 60, 50);
+	place(chest_pos, BLOCK_CHEST);
+	sync_entities();
+
+	Chest* chest = get_chest(entities, chest_pos);
+	expect(chest != NULL);
+	if (chest) set_slot(&chest->inventory, chest->items, 3, Item{ ITEM_BLOCK, BLOCK_STONE, 5 });
+
+	Item taken = get_next_item(entities, chest_pos);
+	expect(taken.count == 1 && chest && chest->items[3].count == 4);
+
+	place(chest_pos, BLOCK_AIR);
+	sync_entities();
+	expect(get_chest(entities, chest_pos) == NULL);
+	expect(world->items.count == 1 && world->items.items[0].item.count == 4);
+
+	// 100k machines, in the air so nothing is in the way, 7 blocks apart along x
+	ivec3* positions = Alloc(ivec3, NUM_MACHINES);
+	uint num_positions = 0;
+	for (int y = 70; y < CHUNK_Y; y++) {
+	for (int z = 0; z < LOADED_CHUNKS_WIDTH * CHUNK_Z; z++) {
+	for (int x = 0; x < LOADED_CHUNKS_WIDTH * CHUNK_X; x += 7)
+	{
+		if (num_positions < NUM_MACHINES) positions[num_positions++] = corner + ivec3(x, y, z);
+	} } }
+	expect(num_positions == NUM_MACHINES);
+
+	Timestamp synced = 0;
+	for (uint i = 0; i < NUM_MACHINES; i++) synced += place(positions[i], BLOCK_CRUSHER + (i % 3));
+	synced += sync_entities();
+
+	print("%u machines placed, syncing %.0f ns per entity, consistent %d\n", entities->counts[ENTITY_MACHINE], ns(synced, NUM_MACHINES), consistent(entities, chunks));
+	expect(entities->counts[ENTITY_MACHINE] == NUM_MACHINES);
+	expect(consistent(entities, chunks));
+
+	// lookups
+	uint hits = 0, misses = 0, found = 0;
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < NUM_LOOKUPS; i++) hits += get_machine(entities, positions[(i * 7919) % NUM_MACHINES]) != NULL;
+	Timestamp hit_time = get_timestamp() - start;
+
+	start = get_timestamp();
+	for (uint i = 0; i < NUM_LOOKUPS; i++) misses += get_machine(entities, positions[i % NUM_MACHINES] + ivec3(3, 0, 0)) == NULL;
+	Timestamp miss_time = get_timestamp() - start;
+
+	start = get_timestamp();
+	for (uint i = 0; i < NUM_SCANS; i++)
+	{
+		ivec3 pos = positions[(i * 7919) % NUM_MACHINES];
+		for (uint m = 0; m < entities->counts[ENTITY_MACHINE]; m++)
+			if (entities->machines[m].pos == pos) { found++; break; }
+	}
+	Timestamp scan_time = get_timestamp() - start;
+
+	uint probes = 0, longest = 0;
+	for (uint i = 0; i < ENTITY_HASH_SIZE; i++)
+	{
+		if (entities->slots[i].block == BLOCK_AIR) continue;
+		uint probe = (i - entity_hash(entities->slots[i].pos)) & (ENTITY_HASH_SIZE - 1);
+		probes += probe;
+		longest = glm::max(longest, probe);
+	}
+
+	print("lookups : %.1f ns hit, %.1f ns miss, scanning the array %.0f ns. probes %.2f on average, %u at most, %.2f load\n",
+		ns(hit_time, NUM_LOOKUPS), ns(miss_time, NUM_LOOKUPS), ns(scan_time, NUM_SCANS), probes / (float)NUM_MACHINES, longest, NUM_MACHINES / (float)ENTITY_HASH_SIZE);
+	expect(hits == NUM_LOOKUPS && misses == NUM_LOOKUPS && found == NUM_SCANS);
+
+	// a pass over every machine
+	start = get_timestamp();
+	for (uint run = 0; run < 100; run++)
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++)
+		entities->machines[i].progress++;
+	print("a pass over every machine : %.0f us\n", calculate_microseconds_elapsed(start, get_timestamp()) / 100.f);
+
+	// broken & replaced
+	synced = 0;
+	for (uint i = 0; i < NUM_CHURNED; i++) synced += place(positions[(i * 104729) % NUM_MACHINES], (i & 1) ? BLOCK_AIR : BLOCK_WASHER);
+	synced += sync_entities();
+	print("%u broken or replaced : syncing %.0f ns per change, %u machines, consistent %d\n", NUM_CHURNED, ns(synced, NUM_CHURNED), entities->counts[ENTITY_MACHINE], consistent(entities, chunks));
+	expect(entities->counts[ENTITY_MACHINE] < NUM_MACHINES);
+	expect(consistent(entities, chunks));
+
+	// too much for the log : every loaded block is checked
+	Edit_Batch batch = {};
+	add_box(&batch, corner + ivec3(0, 70, 0), corner + ivec3((LOADED_CHUNKS_WIDTH * CHUNK_X) - 1, 80, (LOADED_CHUNKS_WIDTH * CHUNK_Z) - 1), BLOCK_AIR);
+	apply(&batch, chunks);
+	expect(chunks->entity_log.overflow);
+
+	float rescan_ms = calculate_microseconds_elapsed(0, sync_entities()) / 1000.f;
+	print("rescan after the log overflowed : %.2f ms, %u machines, consistent %d\n", rescan_ms, entities->counts[ENTITY_MACHINE], consistent(entities, chunks));
+	expect(consistent(entities, chunks));
+
+	// the player moves 3 chunks, the machines in the chunks left behind go with them
+	uint before = entities->counts[ENTITY_MACHINE];
+	update_chunks(chunks, SCENE_CENTER + vec3(3 * CHUNK_X, 0, 0));
+	float unload_ms = calculate_microseconds_elapsed(0, sync_entities()) / 1000.f;
+
+	start = get_timestamp();
+	for (uint i = 0; i < 1000; i++) sync_entities();
+	float idle_ns = microseconds_since(start); // us for 1000 = ns for one
+
+	print("moving : %.2f ms, %u -> %u machines, consistent %d. a sync with nothing to do %.0f ns\n", unload_ms, before, entities->counts[ENTITY_MACHINE], consistent(entities, chunks), idle_ns);
+	expect(entities->counts[ENTITY_MACHINE] < before);
+	expect(consistent(entities, chunks));
+
+	return finish("entities");
+}
@@ -0,0 +1,184 @@
+#include <proprietary/boilerplate.h>
+#include "test.h"
+
+// file i/o : a 64 MB file & 2000 files of 4 KB are written to tests/bin & read back through read_file(), a
+// File_View & read_async(), & a File_Writer writes a file in uneven pieces with padding in between. everything
+// has to come back byte for byte, followed by a 0, & missing files have to fail without crashing. then times
+// the big file & the small files through each of those against fopen() & fread(), like the loaders did before,
+// & writing 64 MB in 4 KB pieces through File_Writer against fwrite(). the best of 3, with the os file cache
+// warm (it isn't emptied, a cold disk is slower for all of them). the files are deleted after
+
+#define BIG_SIZE   (64 * 1024 * 1024)
+#define NUM_SMALL  2000
+#define SMALL_SIZE 4096
+#define NUM_RUNS   3
+
+#define BIG_PATH    "tests/bin/file_io_big.bin"
+#define OUT_PATH    "tests/bin/file_io_out.bin"
+#define WRITER_PATH "tests/bin/file_io_writer.bin"
+
+char small_paths[NUM_SMALL][64];
+uint64 sum; // so nothing that is read can be left out
+
+void touch(const byte* memory, uint64 size) { for (uint64 i = 0; i < size; i += 4096) sum += memory[i]; }
+float ms(Timestamp time) { return calculate_microseconds_elapsed(0, time) / 1000.f; }
+
+uint finish_request(File_Request* request, byte* expected) // problems, then gives it back
+{
+	wait(request);
+	uint problems = request->state != REQUEST_DONE || request->size != SMALL_SIZE || memcmp(request->memory, expected, SMALL_SIZE) || request->memory[SMALL_SIZE] != 0;
+	touch(request->memory, request->size);
+	free(request->memory);
+	release(request);
+	return problems;
+}
+uint read_small_async(byte* data) // keeps as many requests in flight as there is room for
+{
+	static File_Request* requests[NUM_SMALL];
+	uint issued = 0, problems = 0;
+
+	for (uint done = 0; done < NUM_SMALL; done++)
+	{
+		while (issued < NUM_SMALL && (requests[issued] = read_async(small_paths[issued]))) issued++;
+		problems += finish_request(requests[done], data + (done * SMALL_SIZE));
+	}
+
+	return problems;
+}
+
+int main()
+{
+	byte* data = Alloc(byte, BIG_SIZE);
+	for (uint i = 0; i < BIG_SIZE; i++) data[i] = (byte)((i * 2654435761u) >> 24);
+
+	// round trips
+	expect(write_file(BIG_PATH, data, BIG_SIZE));
+
+	uint size = 0;
+	byte* read = read_file(BIG_PATH, &size);
+	expect(read && size == BIG_SIZE && memcmp(read, data, BIG_SIZE) == 0 && read[BIG_SIZE] == 0);
+	free(read);
+
+	File_View view;
+	expect(open_view(&view, BIG_PATH) && view.size == BIG_SIZE && memcmp(view.memory, data, BIG_SIZE) == 0);
+	close_view(&view);
+
+	File_Writer writer;
+	expect(open_writer(&writer, WRITER_PATH));
+	uint64 written = 0;
+	for (uint i = 0; i < 5000; i++)
+	{
+		uint piece = (i * 7919) % 9000;
+		write(&writer, data, piece);
+		pad(&writer, 64);
+		written = (written + piece + 63) & ~63ull;
+	}
+	write(&writer, data, FILE_WRITE_BUFFER_SIZE * 3); // bigger than the buffer
+	written += FILE_WRITE_BUFFER_SIZE * 3;
+	expect(close_writer(&writer));
+
+	read = read_file(WRITER_PATH, &size);
+	expect(read && size == written && memcmp(read + size - (FILE_WRITE_BUFFER_SIZE * 3), data, FILE_WRITE_BUFFER_SIZE * 3) == 0);
+	free(read);
+
+	expect(read_file("tests/bin/file_io_missing.bin") == NULL);
+	expect(!open_view(&view, "tests/bin/file_io_missing.bin"));
+
+	uint problems = 0;
+	for (uint i = 0; i < NUM_SMALL; i++)
+	{
+		snprintf(small_paths[i], 64, "tests/bin/file_io_%04u.bin", i);
+		problems += !write_file(small_paths[i], data + (i * SMALL_SIZE), SMALL_SIZE);
+	}
+	problems += read_small_async(data);
+
+	File_Request* missing = read_async("tests/bin/file_io_missing.bin");
+	wait(missing);
+	problems += missing->state != REQUEST_FAILED;
+	release(missing);
+
+	print("%u small files written & read back on the file threads : %u problems\n", NUM_SMALL, problems);
+	expect(problems == 0);
+
+	// throughput, the best of NUM_RUNS
+	Timestamp big_fread = ~0ull, big_read_file = ~0ull, big_view = ~0ull;
+	Timestamp small_fread = ~0ull, small_read_file = ~0ull, small_async = ~0ull;
+	Timestamp out_fwrite = ~0ull, out_writer = ~0ull;
+
+	for (uint run = 0; run < NUM_RUNS; run++)
+	{
+		Timestamp start = get_timestamp();
+		FILE* file = fopen(BIG_PATH, "rb");
+		byte* memory = (byte*)malloc(BIG_SIZE + 1);
+		fread(memory, 1, BIG_SIZE, file);
+		fclose(file);
+		touch(memory, BIG_SIZE);
+		free(memory);
+		big_fread = glm::min(big_fread, get_timestamp() - start);
+
+		start = get_timestamp();
+		memory = read_file(BIG_PATH, &size);
+		touch(memory, size);
+		free(memory);
+		big_read_file = glm::min(big_read_file, get_timestamp() - start);
+
+		start = get_timestamp();
+		open_view(&view, BIG_PATH);
+		touch(view.memory, view.size);
+		close_view(&view);
+		big_view = glm::min(big_view, get_timestamp() - start);
+
+		start = get_timestamp();
+		for (uint i = 0; i < NUM_SMALL; i++)
+		{
+			byte small[SMALL_SIZE];
+			file = fopen(small_paths[i], "rb");
+			fread(small, 1, SMALL_SIZE, file);
+			fclose(file);
+			touch(small, SMALL_SIZE);
+		}
+		small_fread = glm::min(small_fread, get_timestamp() - start);
+
+		start = get_timestamp();
+		for (uint i = 0; i < NUM_SMALL; i++)
+		{
+			memory = read_file(small_paths[i], &size);
+			touch(memory, size);
+			free(memory);
+		}
+		small_read_file = glm::min(small_read_file, get_timestamp() - start);
+
+		start = get_timestamp();
+		problems += read_small_async(data);
+		small_async = glm::min(small_async, get_timestamp() - start);
+
+		start = get_timestamp();
+		file = fopen(OUT_PATH, "wb");
+		for (uint i = 0; i < BIG_SIZE; i += SMALL_SIZE) fwrite(data + i, 1, SMALL_SIZE, file);
+		fclose(file);
+		out_fwrite = glm::min(out_fwrite, get_timestamp() - start);
+
+		start = get_timestamp();
+		open_writer(&writer, OUT_PATH);
+		for (uint i = 0; i < BIG_SIZE; i += SMALL_SIZE) write(&writer, data + i, SMALL_SIZE);
+		problems += !close_writer(&writer);
+		out_writer = glm::min(out_writer, get_timestamp() - start);
+	}
+
+	print("64 MB file : fread() %.1f ms, read_file() %.1f ms, a File_View touching every page %.1f ms\n", ms(big_fread), ms(big_read_file), ms(big_view));
+	print("%u x 4 KB files : fopen() & fread() %.1f ms, read_file() %.1f ms, read_async() on %u threads %.1f ms\n", NUM_SMALL, ms(small_fread), ms(small_read_file), NUM_FILE_THREADS, ms(small_async));
+	print("writing 64 MB in 4 KB pieces : fwrite() %.1f ms, File_Writer %.1f ms\n", ms(out_fwrite), ms(out_writer));
+	expect(problems == 0);
+
+	read = read_file(OUT_PATH, &size);
+	expect(read && size == BIG_SIZE && memcmp(read, data, BIG_SIZE) == 0);
+	free(read);
+
+	remove(BIG_PATH);
+	remove(OUT_PATH);
+	remove(WRITER_PATH);
+	for (uint i = 0; i < NUM_SMALL; i++) remove(small_paths[i]);
+
+	if (sum == 1) print("\n");
+	return finish("file_io");
+}
@@ -0,0 +1,91 @@
+#include "world.h"
+#include "test.h"
+
+// fluids : a dam break. a reservoir of water sources is walled in on a flat floor dug into generated terrain,
+// then the wall is removed & the water is ticked until nothing is queued anymore. the water has to come to rest
+// (re-evaluating every cell afterwards changes nothing) within a bounded number of ticks, & has to have spread
+// over the floor. prints how many fluid ticks per second that is
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+#define FLOOR_SIZE   40 // blocks per side
+#define MAX_TICKS    1000
+
+uint queued_cells(Chunk_Loader* chunks)
+{
+	Fluid_Queue* queue = chunks->fluids.queues + TIER_ACTIVE;
+	return queue->tail - queue->head;
+}
+
+void tick_until_rest(Chunk_Loader* chunks, uint* ticks, uint* peak_queue, Timestamp* time, Timestamp* worst)
+{
+	*ticks = 0; *peak_queue = 0; *time = 0; *worst = 0;
+
+	while (queued_cells(chunks) && *ticks < MAX_TICKS)
+	{
+		*peak_queue = max(*peak_queue, queued_cells(chunks));
+
+		Timestamp start = get_timestamp();
+		tick_fluids(chunks, TIER_ACTIVE, start, 1000000); // no budget, this is about how long all of it takes
+		Timestamp elapsed = get_timestamp() - start;
+
+		*time += elapsed;
+		*worst = max(*worst, elapsed);
+		(*ticks)++;
+	}
+}
+
+int main()
+{
+	Chunk_Loader* chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+	update_chunks(chunks, SCENE_CENTER);
+
+	// the floor & the air above it are in the active chunks (the 3 x 3 around the player, 32 to 80 from the corner)
+	ivec3 corner = ivec3(chunks->lookup.x + 36, 40, chunks->lookup.z + 36);
+
+	Edit_Batch batch = {};
+	add_box(&batch, corner - ivec3(0, 1, 0), corner + ivec3(FLOOR_SIZE, -1, FLOOR_SIZE), BLOCK_STONE); apply(&batch, chunks);
+	add_box(&batch, corner, corner + ivec3(FLOOR_SIZE, 30, FLOOR_SIZE), BLOCK_AIR); apply(&batch, chunks);
+	add_box(&batch, corner + ivec3(11, 0, 0), corner + ivec3(11, 10, FLOOR_SIZE), BLOCK_STONE); apply(&batch, chunks); // dam
+	add_box(&batch, corner, corner + ivec3(10, 10, FLOOR_SIZE), BLOCK_WATER); apply(&batch, chunks); // reservoir
+
+	uint ticks, peak_queue;
+	Timestamp time, worst;
+	tick_until_rest(chunks, &ticks, &peak_queue, &time, &worst);
+	print("behind the dam : %u ticks to come to rest\n", ticks);
+	expect(queued_cells(chunks) == 0);
+
+	Timestamp start = get_timestamp();
+	for (int z = 0; z <= FLOOR_SIZE; z++) {
+	for (int y = 0; y <= 10; y++)
+		set_block(chunks, corner + ivec3(11, y, z), BLOCK_AIR);
+	}
+	print("dam removed    : %.0f us\n", microseconds_since(start));
+
+	tick_until_rest(chunks, &ticks, &peak_queue, &time, &worst);
+	float tick_us = calculate_microseconds_elapsed(0, time) / (float)ticks;
+	print("dam break      : %u ticks to come to rest, at most %u cells queued\n", ticks, peak_queue);
+	print("                 %.1f us per tick, %.0f us worst, %.0f ticks/s\n", tick_us, (float)calculate_microseconds_elapsed(0, worst), 1000000 / tick_us);
+	expect(ticks < MAX_TICKS);
+
+	// at rest : no cell would change if it was looked at again
+	uint changed = 0, wet_floor = 0;
+	for (int x = 0; x <= FLOOR_SIZE; x++) {
+	for (int z = 0; z <= FLOOR_SIZE; z++) {
+	for (int y = 0; y <= 30; y++)
+	{
+		uint index = find_block(&chunks->lookup, corner + ivec3(x, y, z));
+		u16 before = chunks->blocks[index];
+		update_fluid(chunks, index);
+		changed += chunks->blocks[index] != before;
+		if (y == 0 && x > 11) wet_floor += is_fluid(before);
+	} } }
+
+	print("after          : %u cells changed when looked at again, %u floor blocks past the dam are wet\n", changed, wet_floor);
+	expect(changed == 0);
+	expect(wet_floor == (MAX_FLOW_LEVEL - 1) * (FLOOR_SIZE + 1)); // flows through where the dam was & MAX_FLOW_LEVEL - 1 blocks past it
+
+	return finish("fluid");
+}
@@ -0,0 +1,96 @@
+#include "gui.h"
+#include "test.h"
+
+// gui hit testing : for every screen, the grid lookup in gui_item_index() has to find the same slot as testing
+// every icon with mouse_in_quad() in order, over a dense grid of cursor positions covering the whole screen
+// (& a bit past it) plus the exact corners & edges of every icon. the slot being dragged is never hit, so each
+// position is tested again while dragging whatever was found there. also times both lookups
+
+#define CURSOR_STEPS 700 // cursor positions per axis, from -1.05 to 1.05
+
+int linear_item_index(GUI_Layout* layout, Mouse mouse, int selected_index) // what the grid replaced
+{
+	for (uint i = 0; i < layout->num_icons; i++)
+		if (layout->slots[i] != selected_index && mouse_in_quad(layout->icons[i], mouse)) return layout->slots[i];
+
+	return -1;
+}
+
+uint num_lookups, num_hits, num_wrong;
+
+void compare(GUI_Renderer* gui, Mouse mouse)
+{
+	GUI_Layout* layout = gui->layouts + gui->screen;
+
+	int slot = linear_item_index(layout, mouse, -1);
+	num_wrong += gui_item_index(gui, mouse, -1) != slot;
+	num_lookups++;
+
+	if (slot < 0) return;
+	num_hits++;
+
+	// dragging the slot that is under the mouse : whatever is under it (usually nothing) is found instead
+	num_wrong += gui_item_index(gui, mouse, slot) != linear_item_index(layout, mouse, slot);
+	num_lookups++;
+}
+
+int main()
+{
+	GUI_Renderer* gui = Alloc(GUI_Renderer, 1);
+	for (uint screen = 0; screen < NUM_GUI_SCREENS; screen++) init(gui->layouts + screen, screen);
+
+	for (uint screen = 0; screen < NUM_GUI_SCREENS; screen++)
+	{
+		gui->screen = screen;
+		GUI_Layout* layout = gui->layouts + screen;
+		num_lookups = num_hits = num_wrong = 0;
+
+		Mouse mouse = {};
+		for (uint y = 0; y < CURSOR_STEPS; y++) {
+		for (uint x = 0; x < CURSOR_STEPS; x++)
+		{
+			mouse.norm_x = -1.05 + (x * 2.1 / (CURSOR_STEPS - 1));
+			mouse.norm_y = -1.05 + (y * 2.1 / (CURSOR_STEPS - 1));
+			compare(gui, mouse);
+		} }
+
+		for (uint i = 0; i < layout->num_icons; i++) // corners, edges & centers, where rounding could go wrong
+		{
+			Icon_Drawable icon = layout->icons[i];
+			for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				mouse.norm_x = icon.position.x + (dx * icon.scale.x);
+				mouse.norm_y = icon.position.y + (dy * icon.scale.y);
+				compare(gui, mouse);
+			} }
+		}
+
+		print("screen %u : %3u icons, %u lookups, %u hits, %u differ from the linear scan\n", screen, layout->num_icons, num_lookups, num_hits, num_wrong);
+		expect(num_wrong == 0);
+		expect(num_hits > 0);
+	}
+
+	// timing on the inventory, the screen with the most icons
+	gui->screen = GUI_INVENTORY;
+	GUI_Layout* layout = gui->layouts + GUI_INVENTORY;
+
+	Mouse mice[1024] = {};
+	for (uint i = 0; i < 1024; i++) { mice[i].norm_x = randfns(i, 1); mice[i].norm_y = randfns(i, 2); }
+
+	volatile int sink = 0;
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < 1000000; i++) sink += linear_item_index(layout, mice[i % 1024], -1);
+	float linear_us = microseconds_since(start);
+
+	start = get_timestamp();
+	for (uint i = 0; i < 1000000; i++) sink += gui_item_index(gui, mice[i % 1024], -1);
+	float grid_us = microseconds_since(start);
+
+	uint most = 0;
+	for (uint c = 0; c < GUI_GRID_CELLS * GUI_GRID_CELLS; c++) most = max(most, (uint)(layout->cell_start[c + 1] - layout->cell_start[c]));
+
+	print("inventory : %.1f ns per linear scan, %.1f ns per grid lookup, at most %u icons in a cell\n", linear_us / 1000, grid_us / 1000, most);
+
+	return finish("gui_hit");
+}
@@ -0,0 +1,117 @@
+#include <proprietary/boilerplate.h>
+#include "test.h"
+
+// hot reloading : files are really written & watched through File_Watch, the reload itself is a fake that
+// only counts. frames are simulated (update() is given the frame time), the files are polled for real.
+// a change has to be reloaded once, HOT_RELOAD_DELAY after the last write of a burst, & a reload that fails
+// has to leave the old thing alone. the files are written to tests/bin, which build.bat makes
+
+#define FRAME_TIME (1 / 60.f)
+
+struct Fake_Asset
+{
+	uint version, reloads;
+	bool broken; // the next reload fails
+};
+
+bool fake_reload(Hot_Reload* reload)
+{
+	Fake_Asset* asset = (Fake_Asset*)reload->target;
+	if (asset->broken) return false;
+
+	asset->version++;
+	asset->reloads++;
+	return true;
+}
+
+void save(const char* path, const char* text) // then waits a bit, so the next write gets another time
+{
+	write_file(path, text, strlen(text));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+void run(Hot_Reloader* reloader, float seconds)
+{
+	for (float time = 0; time < seconds; time += FRAME_TIME) update(reloader, FRAME_TIME);
+}
+
+int main()
+{
+	const char* vert = "tests/bin/hot_reload.vert";
+	const char* frag = "tests/bin/hot_reload.frag";
+	const char* bmp  = "tests/bin/hot_reload.bmp";
+	save(vert, "1"); save(frag, "1"); save(bmp, "1");
+
+	Hot_Reloader* reloader = Alloc(Hot_Reloader, 1);
+	Fake_Asset shader = {}, texture = {};
+	expect(watch(reloader, fake_reload, &shader, 0, vert, frag) != NULL);
+	expect(watch(reloader, fake_reload, &texture, 0, bmp) != NULL);
+
+	run(reloader, 2);
+	print("nothing saved   : %u + %u reloads\n", shader.reloads, texture.reloads);
+	expect(shader.reloads == 0 && texture.reloads == 0);
+
+	// one save : reloaded once, after the delay (& at most one poll later than that)
+	save(frag, "2");
+	float waited = 0;
+	while (shader.reloads == 0 && waited < 2) { update(reloader, FRAME_TIME); waited += FRAME_TIME; }
+	run(reloader, 1);
+	print("one save        : reloaded after %.3f s, %u reloads\n", waited, shader.reloads);
+	expect(waited >= HOT_RELOAD_DELAY);
+	expect(waited <= HOT_RELOAD_DELAY + HOT_RELOAD_POLL_TIME + (2 * FRAME_TIME));
+	expect(shader.reloads == 1);
+	expect(texture.reloads == 0); // only what changed
+
+	// an editor saving in 3 steps 0.1 s apart : still one reload, after the last step
+	save(vert, "3a"); run(reloader, .1f);
+	save(vert, "3ab"); run(reloader, .1f);
+	save(vert, "3abc"); run(reloader, .25f);
+	expect(shader.reloads == 1); // the delay started over at every step
+	run(reloader, 1);
+	print("3 step save     : %u reloads in total\n", shader.reloads);
+	expect(shader.reloads == 2);
+
+	// a save that doesn't load keeps the old one, fixing it reloads
+	shader.broken = true;
+	save(frag, "broken"); run(reloader, 1);
+	expect(shader.version == 2);
+	expect(reloader->num_failed == 1);
+
+	shader.broken = false;
+	save(frag, "fixed"); run(reloader, 1);
+	print("broken, fixed   : version %u, %u failed\n", shader.version, reloader->num_failed);
+	expect(shader.version == 3);
+	expect(reloader->num_failed == 1);
+
+	// deleting doesn't reload, the file coming back does (editors that save by replacing the file)
+	remove(bmp); run(reloader, 1);
+	expect(texture.reloads == 0);
+	save(bmp, "2"); run(reloader, 1);
+	print("deleted, back   : %u reloads\n", texture.reloads);
+	expect(texture.reloads == 1);
+
+	// cost : a full set of watched files, over a second of frames & on the frames that poll
+	Hot_Reloader* many = Alloc(Hot_Reloader, 1);
+	Fake_Asset* assets = Alloc(Fake_Asset, MAX_HOT_RELOADS);
+	char paths[MAX_HOT_RELOADS][64];
+	for (uint i = 0; i < MAX_HOT_RELOADS; i++)
+	{
+		snprintf(paths[i], 64, "tests/bin/hot_reload_%02u.txt", i);
+		write_file(paths[i], "x", 1);
+		watch(many, fake_reload, assets + i, 0, paths[i]);
+	}
+
+	Timestamp start = get_timestamp();
+	run(many, 1);
+	float frame_us = microseconds_since(start) / 60;
+
+	start = get_timestamp();
+	for (uint i = 0; i < 100; i++) { many->poll_timer = 0; update(many, FRAME_TIME); }
+	float poll_us = microseconds_since(start) / 100;
+
+	print("%u files        : %.2f us per frame, %.1f us on a frame that polls\n", MAX_HOT_RELOADS, frame_us, poll_us);
+
+	for (uint i = 0; i < MAX_HOT_RELOADS; i++) remove(paths[i]);
+	remove(vert); remove(frag); remove(bmp);
+
+	return finish("hot_reload");
+}
@@ -0,0 +1,123 @@
+#include "player.h"
+#include "test.h"
+
+// gui frames : update(GUI_Renderer*) runs against a fake glBufferSubData that counts what is uploaded. an idle
+// hud frame & an idle inventory frame have to upload nothing, picking an item up has to upload its one icon,
+// dragging an icon uploads only that icon every frame & dropping it puts it back where the layout has it.
+// draw() has to ask for as many instances as there are quads & icons on the screen. times an idle hud frame
+// against rebuilding & uploading the whole hud every frame, like update() did before layouts (kept below)
+
+#define HUD         0 // screen 0, nothing open
+#define IDLE_FRAMES 100000
+
+uint uploads, uploaded_bytes;
+
+void APIENTRY fake_BindBuffer(GLenum, GLuint) {}
+void APIENTRY fake_BufferSubData(GLenum, GLintptr, GLsizeiptr size, const void*) { uploads++; uploaded_bytes += (uint)size; }
+
+void update_hud_every_frame(GUI_Renderer* renderer, Item* player_items) // the hud part of what layouts replaced
+{
+	memset(renderer->quads, 0, sizeof(renderer->quads));
+	memset(renderer->icons, 0, sizeof(renderer->icons));
+
+	uint num_quads = 0, num_icons = 0;
+	vec2 scale = vec2(.3, .5);
+	vec3 color = vec3(.1);
+
+	for (uint i = 0; i < NUM_HOTBAR_ITEMS; i++)
+		renderer->icons[num_icons++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f, icon_tex(player_items[i].id) };
+
+	renderer->quads[num_quads++] = { vec2(-.66 + (0 * .12), -.799), scale / 5.6f, vec3(.3) };
+	for (uint i = 0; i < 12; i++)
+		renderer->quads[num_quads++] = { vec2(-.66 + (i * .12), -.799), scale / 6.f, vec3(.2) };
+	renderer->quads[num_quads++] = { vec2(0, -.8), vec2(.735, .12), color };
+
+	for (uint i = 0; i < 10; i++)
+		renderer->quads[num_quads++] = { vec2(-.7 + (i * .06), -.63), scale / 12.f, vec3(.4, 0, 0) };
+	for (uint i = 0; i < 10; i++)
+		renderer->quads[num_quads++] = { vec2(.7 - (i * .06), -.63), scale / 12.f, vec3(.513, .309, .086) };
+	renderer->quads[num_quads++] = { {}, scale / 150.f, vec3(.5) };
+
+	update(renderer->quad_mesh, MAX_GUI_QUADS * sizeof(Quad_Drawable), (byte*)renderer->quads);
+	update(renderer->icon_mesh, MAX_GUI_QUADS * sizeof(Icon_Drawable), (byte*)renderer->icons);
+}
+
+int main()
+{
+	__glewBindBuffer    = fake_BindBuffer;
+	__glewBufferSubData = fake_BufferSubData;
+
+	GUI_Renderer* gui = Alloc(GUI_Renderer, 1); // init() without the meshes, shaders & texture
+	for (uint screen = 0; screen < NUM_GUI_SCREENS; screen++) init(gui->layouts + screen, screen);
+	gui->screen = INVALID;
+	gui->dragged_icon = INVALID;
+
+	Player* player = Alloc(Player, 1);
+	init(player);
+	Mouse mouse = {};
+
+	// the hud
+	update(gui, mouse, player->items, HUD, -1, player->crafting);
+	print("first hud frame : %u uploads, %u bytes, %u quads & %u icons\n", uploads, uploaded_bytes, gui->num_quads, gui->num_icons);
+	expect(uploads > 0 && gui->num_quads == gui->layouts[HUD].num_quads && gui->num_icons == gui->layouts[HUD].num_icons);
+
+	uploads = uploaded_bytes = 0;
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < IDLE_FRAMES; i++) update(gui, mouse, player->items, HUD, -1, player->crafting);
+	float idle_ns = (microseconds_since(start) * 1000) / IDLE_FRAMES;
+	uint idle_uploads = uploads;
+
+	uploads = uploaded_bytes = 0;
+	start = get_timestamp();
+	for (uint i = 0; i < IDLE_FRAMES; i++) update_hud_every_frame(gui, player->items);
+	float rebuilt_ns = (microseconds_since(start) * 1000) / IDLE_FRAMES;
+
+	print("idle hud frame : %.0f ns & %u uploads, rebuilding it every frame : %.0f ns & %u bytes uploaded\n", idle_ns, idle_uploads, rebuilt_ns, uploaded_bytes / IDLE_FRAMES);
+	expect(idle_uploads == 0);
+
+	gui->screen = INVALID; // the buffers were overwritten
+	update(gui, mouse, player->items, HUD, -1, player->crafting);
+
+	// something is picked up into the hotbar
+	uploads = uploaded_bytes = 0;
+	give(&player->storage, player->items, Item{ ITEM_BLOCK, BLOCK_SAND, 1 });
+	update(gui, mouse, player->items, HUD, -1, player->crafting);
+	print("pickup : %u uploads, %u bytes\n", uploads, uploaded_bytes);
+	expect(uploads == 1 && uploaded_bytes == sizeof(Icon_Drawable));
+
+	// the inventory
+	uploads = uploaded_bytes = 0;
+	update(gui, mouse, player->items, GUI_INVENTORY, -1, player->crafting);
+	GUI_Layout* inventory = gui->layouts + GUI_INVENTORY;
+	print("inventory opened : %u uploads, %u bytes, %u quads & %u icons\n", uploads, uploaded_bytes, gui->num_quads, gui->num_icons);
+	expect(gui->num_quads == inventory->num_quads && gui->num_icons == inventory->num_icons);
+
+	uploads = 0;
+	for (uint i = 0; i < 1000; i++) update(gui, mouse, player->items, GUI_INVENTORY, -1, player->crafting);
+	expect(uploads == 0);
+
+	// an icon dragged for 100 frames, then dropped
+	uint dragged_slot = NUM_HOTBAR_ITEMS + 4, icon = inventory->slot_icons[dragged_slot];
+	uploads = uploaded_bytes = 0;
+	for (uint i = 0; i < 100; i++)
+	{
+		mouse.norm_x = -.5f + (i * .01f);
+		update(gui, mouse, player->items, GUI_INVENTORY, dragged_slot, player->crafting);
+	}
+	print("dragging for 100 frames : %u uploads, %u bytes\n", uploads, uploaded_bytes);
+	expect(uploads == 100 && uploaded_bytes == 100 * sizeof(Icon_Drawable));
+	expect(gui->icons[icon].position == vec2(mouse.norm_x, mouse.norm_y));
+
+	uploads = 0;
+	update(gui, mouse, player->items, GUI_INVENTORY, -1, player->crafting);
+	expect(uploads == 1 && gui->icons[icon].position == inventory->icons[icon].position);
+
+	// drawn with as many instances as there are on the screen
+	Render_Queue* queue = Alloc(Render_Queue, 1);
+	clear(queue, vec3(0));
+	draw(gui, queue);
+	expect(queue->num_packets == 2);
+	expect(queue->packets[0].num_instances == inventory->num_icons && queue->packets[1].num_instances == inventory->num_quads);
+
+	return finish("hud");
+}
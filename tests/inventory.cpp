@@ -0,0 +1,199 @@
+#include "player.h"
+#include "test.h"
+
+// inventories : 200k random gives, takes & shift-clicks between a player & a chest, checked after every one
+// against the items themselves : the empty bitmap & the index have to match the slots, no stack may go over
+// max_stack(), & give() may only leave something over if there really was no room for it. then 4096 pickups a
+// tick go into a player's inventory, emptied every 8 ticks (it fills up long before that), timed against the
+// linear search give_player_item() did (kept below) & a linear search that merges like give() does. also times
+// pickups into a full inventory & emptying a chest into the player
+
+#define NUM_OPERATIONS   200000
+#define PICKUPS_PER_TICK 4096
+#define NUM_TICKS        200
+
+uint num_rolls;
+uint roll(uint max) { return random_uint(num_rolls++, 41) % max; } // [0, max)
+
+uint give_player_item(Item* player_items, Item item) // what the world item pickup used to do
+{
+	for (uint i = 0; i < NUM_PLAYER_ITEMS; i++)
+	{
+		if (player_items[i].type == NULL)
+		{
+			player_items[i] = item;
+			return item.count;
+		}
+	}
+
+	return 0;
+}
+uint give_linear(Item* items, Item item) // merges first like give(), by searching every slot
+{
+	uint left = item.count, max = max_stack(item);
+	for (uint i = 0; i < NUM_PLAYER_ITEMS && left; i++)
+	{
+		if (items[i].type != item.type || items[i].id != item.id || items[i].count >= max) continue;
+		uint moved = glm::min(left, max - items[i].count);
+		items[i].count += moved;
+		left -= moved;
+	}
+	for (uint i = 0; i < NUM_PLAYER_ITEMS && left; i++)
+	{
+		if (items[i].type != NULL) continue;
+		items[i] = item;
+		items[i].count = glm::min(left, max);
+		left -= items[i].count;
+	}
+
+	return item.count - left;
+}
+
+bool consistent(Inventory* inventory, Item* items)
+{
+	for (uint i = 0; i < inventory->num_slots; i++)
+	{
+		bool empty = items[i].type == NULL;
+		if (empty != (bool)((inventory->empty >> i) & 1)) return false;
+		if (!empty && (items[i].count == 0 || items[i].count > max_stack(items[i]))) return false;
+		if (!empty && !((find_entry(inventory, item_key(items[i]))->slots >> i) & 1)) return false;
+	}
+
+	for (uint h = 0; h < INVENTORY_INDEX_SIZE; h++)
+	for (uint64 slots = inventory->index[h].slots; slots; slots &= slots - 1)
+		if (item_key(items[glm::findLSB(slots)]) != inventory->index[h].key) return false;
+
+	return true;
+}
+uint count_of(Item* items, uint num_slots, Item item)
+{
+	uint count = 0;
+	for (uint i = 0; i < num_slots; i++) if (items[i].type == item.type && items[i].id == item.id) count += items[i].count;
+	return count;
+}
+bool has_room(Item* items, uint num_slots, Item item)
+{
+	for (uint i = 0; i < num_slots; i++)
+		if (items[i].type == NULL || (items[i].type == item.type && items[i].id == item.id && items[i].count < max_stack(item))) return true;
+
+	return false;
+}
+Item random_item()
+{
+	uint kind = roll(12);
+	return (kind < 10) ? Item{ ITEM_BLOCK, 1 + kind, 1 + roll(8) } : Item{ ITEM_TOOL, kind - 9, 1 };
+}
+
+int main()
+{
+	// random operations, checked against the items
+	Item player_items[NUM_PLAYER_ITEMS] = {}, chest_items[NUM_CHEST_ITEMS] = {};
+	Inventory player, chest;
+	init(&player, player_items, NUM_PLAYER_ITEMS);
+	init(&chest, chest_items, NUM_CHEST_ITEMS);
+
+	uint problems = 0;
+	for (uint i = 0; i < NUM_OPERATIONS; i++)
+	{
+		Item item = random_item();
+		uint before = count_of(player_items, NUM_PLAYER_ITEMS, item);
+
+		switch (roll(6))
+		{
+		case 0:
+		case 1: {
+			uint given = give(&player, player_items, item);
+			problems += count_of(player_items, NUM_PLAYER_ITEMS, item) != before + given;
+			problems += given < item.count && has_room(player_items, NUM_PLAYER_ITEMS, item);
+		} break;
+		case 2: problems += take(&player, player_items, item) != glm::min(before, item.count); break;
+		case 3: transfer(&player, player_items, roll(NUM_PLAYER_ITEMS), &chest, chest_items); break;
+		case 4: transfer(&chest, chest_items, roll(NUM_CHEST_ITEMS), &player, player_items, slot_mask(0, NUM_HOTBAR_ITEMS)); break;
+		case 5: if (roll(50) == 0) transfer_all(&chest, chest_items, &player, player_items); break;
+		}
+
+		problems += !consistent(&player, player_items) || !consistent(&chest, chest_items);
+	}
+	print("%u random operations : %u problems\n", NUM_OPERATIONS, problems);
+	expect(problems == 0);
+
+	// pickups
+	Item* pickups = Alloc(Item, PICKUPS_PER_TICK);
+	for (uint i = 0; i < PICKUPS_PER_TICK; i++) pickups[i] = Item{ ITEM_BLOCK, 1 + roll(16), 1 };
+
+	Player* p = Alloc(Player, 1);
+	init(p);
+
+	Timestamp indexed = 0, linear = 0, merging = 0;
+	uint taken_indexed = 0, taken_linear = 0, taken_merging = 0;
+	Item items[NUM_PLAYER_ITEMS];
+
+	for (uint t = 0; t < NUM_TICKS; t++)
+	{
+		if (t % 8 == 0) for (uint i = 0; i < NUM_PLAYER_ITEMS; i++) set_slot(&p->storage, p->items, i, {});
+		Timestamp start = get_timestamp();
+		for (uint i = 0; i < PICKUPS_PER_TICK; i++) taken_indexed += give(&p->storage, p->items, pickups[i]);
+		indexed += get_timestamp() - start;
+	}
+	for (uint t = 0; t < NUM_TICKS; t++)
+	{
+		if (t % 8 == 0) memset(items, 0, sizeof(items));
+		Timestamp start = get_timestamp();
+		for (uint i = 0; i < PICKUPS_PER_TICK; i++) taken_linear += give_player_item(items, pickups[i]);
+		linear += get_timestamp() - start;
+	}
+	for (uint t = 0; t < NUM_TICKS; t++)
+	{
+		if (t % 8 == 0) memset(items, 0, sizeof(items));
+		Timestamp start = get_timestamp();
+		for (uint i = 0; i < PICKUPS_PER_TICK; i++) taken_merging += give_linear(items, pickups[i]);
+		merging += get_timestamp() - start;
+	}
+
+	uint total = NUM_TICKS * PICKUPS_PER_TICK;
+	print("%u pickups a tick : give() %.1f ns each (%u of %u taken), give_player_item() %.1f ns (%u taken), merging linear search %.1f ns (%u taken)\n", PICKUPS_PER_TICK,
+		(calculate_microseconds_elapsed(0, indexed) * 1000.f) / total, taken_indexed, total,
+		(calculate_microseconds_elapsed(0, linear ) * 1000.f) / total, taken_linear,
+		(calculate_microseconds_elapsed(0, merging) * 1000.f) / total, taken_merging);
+	expect(taken_indexed == (NUM_TICKS / 8) * NUM_PLAYER_ITEMS * MAX_STACK_SIZE && taken_merging == taken_indexed); // full within 8 ticks
+	expect(consistent(&p->storage, p->items));
+
+	// a full inventory : every pickup is turned down
+	for (uint i = 0; i < NUM_PLAYER_ITEMS; i++)
+	{
+		set_slot(&p->storage, p->items, i, Item{ ITEM_BLOCK, 100 + i, MAX_STACK_SIZE });
+		items[i] = p->items[i];
+	}
+
+	uint turned_down = 0;
+	Timestamp start = get_timestamp();
+	for (uint t = 0; t < 100; t++)
+	for (uint i = 0; i < PICKUPS_PER_TICK; i++) turned_down += give(&p->storage, p->items, pickups[i]) == 0;
+	float full_ns = (microseconds_since(start) * 1000) / (100 * PICKUPS_PER_TICK);
+
+	start = get_timestamp();
+	for (uint t = 0; t < 100; t++)
+	for (uint i = 0; i < PICKUPS_PER_TICK; i++) turned_down += give_linear(items, pickups[i]) == 0;
+	float full_linear_ns = (microseconds_since(start) * 1000) / (100 * PICKUPS_PER_TICK);
+
+	print("full inventory : give() %.1f ns per pickup turned down, merging linear search %.1f ns\n", full_ns, full_linear_ns);
+	expect(turned_down == 2 * 100 * PICKUPS_PER_TICK);
+
+	// a chest emptied into the player
+	for (uint i = 0; i < NUM_PLAYER_ITEMS; i++) set_slot(&p->storage, p->items, i, {});
+	for (uint i = 0; i < NUM_CHEST_ITEMS; i++) set_slot(&chest, chest_items, i, Item{ ITEM_BLOCK, 1 + (i % 16), 1 + roll(30) });
+
+	uint in_chest = 0;
+	for (uint i = 0; i < NUM_CHEST_ITEMS; i++) in_chest += chest_items[i].count;
+
+	start = get_timestamp();
+	uint moved = transfer_all(&chest, chest_items, &p->storage, p->items);
+	float move_us = microseconds_since(start);
+
+	uint used = NUM_PLAYER_ITEMS - glm::bitCount(p->storage.empty);
+	print("chest -> player : %u items in %.1f us, in %u slots\n", moved, move_us, used);
+	expect(moved == in_chest && first_item(&chest) == INVALID);
+	expect(used < NUM_CHEST_ITEMS && consistent(&p->storage, p->items));
+
+	return finish("inventory");
+}
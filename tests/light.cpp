@@ -0,0 +1,173 @@
+#include "world.h"
+#include "test.h"
+
+// lighting : after every kind of edit (single blocks, batches, a roof over a whole area, loading new chunks)
+// the incrementally updated light has to be exactly what a plain flood fill of the whole world gives.
+// a light queue that overflows has to be noticed & the light rebuilt instead of silently losing nodes.
+// also times how long the light takes for each kind of edit
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+
+#define FLOOD_SIZE (1 << 22) // ring buffer, more than every loaded block for both channels
+
+u8* reference; // NUM_CHUNKS * NUM_CHUNK_BLOCKS
+uint* nodes;   // FLOOD_SIZE, for the flood fill
+
+uint wrong_light(Chunk_Loader* chunks) // number of blocks whose light isn't what a flood fill from scratch gives
+{
+	memset(reference, 0, NUM_CHUNKS * NUM_CHUNK_BLOCKS);
+	uint head = 0, tail = 0;
+
+	for (uint b = 0; b < NUM_CHUNKS; b++) {
+	for (uint column = 0; column < CHUNK_X * CHUNK_Z; column++)
+	{
+		for (int y = CHUNK_Y - 1; y >= 0; y--) // straight down from the sky
+		{
+			uint index = (b * NUM_CHUNK_BLOCKS) + column + (y * CHUNK_X * CHUNK_Z);
+			if (is_solid(chunks->blocks[index])) break;
+
+			reference[index] = MAX_LIGHT << 4;
+			nodes[tail++ % FLOOD_SIZE] = index | (LIGHT_SKY << 23);
+		}
+		for (uint y = 0; y < CHUNK_Y; y++)
+		{
+			uint index = (b * NUM_CHUNK_BLOCKS) + column + (y * CHUNK_X * CHUNK_Z);
+			uint level = light_emitted(chunks->blocks[index]);
+			if (level == 0) continue;
+
+			reference[index] |= level;
+			nodes[tail++ % FLOOD_SIZE] = index | (LIGHT_BLOCK << 23);
+		}
+	} }
+
+	while (head < tail)
+	{
+		uint node = nodes[head++ % FLOOD_SIZE];
+		uint index = node & 0x7FFFFF, channel = node >> 23;
+		uint level = (reference[index] >> (channel * 4)) & 0xF;
+
+		for (uint face = 0; face < 6; face++)
+		{
+			uint next = neighbor(&chunks->lookup, index, face);
+			if (next == INVALID_BLOCK_INDEX || is_solid(chunks->blocks[next])) continue;
+
+			uint next_level = light_through(level, channel, face);
+			if (((reference[next] >> (channel * 4)) & 0xF) >= next_level) continue;
+
+			reference[next] = (reference[next] & ~(0xF << (channel * 4))) | (next_level << (channel * 4));
+			nodes[tail++ % FLOOD_SIZE] = next | (channel << 23);
+			assert(tail - head <= FLOOD_SIZE);
+		}
+	}
+
+	uint wrong = 0;
+	for (uint i = 0; i < NUM_CHUNKS * NUM_CHUNK_BLOCKS; i++) wrong += reference[i] != chunks->light[i];
+	return wrong;
+}
+
+bool queues_empty(Chunk_Loader* chunks)
+{
+	Light_Queue* adds = &chunks->light_adds;
+	Light_Queue* removals = &chunks->light_removals;
+	return adds->head == adds->tail && removals->head == removals->tail && !adds->overflow && !removals->overflow;
+}
+
+int main()
+{
+	reference = Alloc(u8, NUM_CHUNKS * NUM_CHUNK_BLOCKS);
+	nodes = Alloc(uint, FLOOD_SIZE);
+
+	Chunk_Loader* chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+
+	Timestamp start = get_timestamp();
+	update_chunks(chunks, SCENE_CENTER);
+	print("load %u chunks      : %8.0f us (generation included)\n", NUM_CHUNKS, microseconds_since(start));
+	expect(wrong_light(chunks) == 0);
+
+	int x0 = chunks->lookup.x, z0 = chunks->lookup.z;
+
+	// single blocks : furnaces (block light), holes & stone (sky light), at & under the surface
+	u16 placed[3] = { BLOCK_FURNACE, BLOCK_AIR, BLOCK_STONE };
+	float total_us = 0, worst_us = 0;
+	for (uint i = 0; i < 300; i++)
+	{
+		int x = x0 + 16 + (random_uint(i, 1) % 80), z = z0 + 16 + (random_uint(i, 2) % 80);
+		uint height = chunks->heights[column_of(find_block(&chunks->lookup, ivec3(x, 0, z)))];
+		int y = (i & 1) ? height : random_uint(i, 3) % glm::max(height, 1u);
+
+		start = get_timestamp();
+		set_block(chunks, ivec3(x, y, z), placed[i % 3]);
+		float us = microseconds_since(start);
+		total_us += us;
+		worst_us = glm::max(worst_us, us);
+	}
+	print("set_block          : %8.1f us on average, %.0f us worst\n", total_us / 300, worst_us);
+	expect(wrong_light(chunks) == 0);
+	expect(queues_empty(chunks));
+
+	// batches : craters & filled spheres, with a brick roof over part of them every now & then
+	total_us = 0;
+	for (uint i = 0; i < 100; i++)
+	{
+		Edit_Batch batch = {};
+		vec3 center = vec3(x0 + 20 + (random_uint(i, 4) % 70), 10 + (random_uint(i, 5) % 50), z0 + 20 + (random_uint(i, 6) % 70));
+		add_sphere(&batch, center, 2.f + (random_uint(i, 7) % 8), (i & 1) ? BLOCK_AIR : BLOCK_STONE);
+		if (i % 10 == 0) add_box(&batch, ivec3(x0 + 30, 60, z0 + 30), ivec3(x0 + 60, 61, z0 + 60), BLOCK_BRICK);
+
+		start = get_timestamp();
+		apply(&batch, chunks);
+		total_us += microseconds_since(start);
+	}
+	print("apply (sphere)     : %8.0f us on average\n", total_us / 100);
+	expect(wrong_light(chunks) == 0);
+
+	// taking the roof off lets the sky back into everything under it
+	{
+		Edit_Batch batch = {};
+		add_box(&batch, ivec3(x0 + 30, 60, z0 + 30), ivec3(x0 + 60, 61, z0 + 60), BLOCK_AIR);
+		start = get_timestamp();
+		apply(&batch, chunks);
+		print("remove a 31x31 roof: %8.0f us\n", microseconds_since(start));
+		expect(wrong_light(chunks) == 0);
+	}
+
+	// moving a chunk over loads 7 new ones, lit against the chunks that are already there
+	start = get_timestamp();
+	update_chunks(chunks, SCENE_CENTER + vec3(CHUNK_X, 0, 0));
+	print("load 7 new chunks  : %8.0f us (generation included)\n", microseconds_since(start));
+	expect(wrong_light(chunks) == 0);
+
+	// a full queue drops the node & remembers it, nothing that was queued before is overwritten
+	{
+		Light_Queue* queue = &chunks->light_adds;
+		queue->head = queue->tail = 5; // not at the start, so the ring wraps
+		for (uint i = 0; i <= LIGHT_QUEUE_SIZE; i++) push_light(queue, i, LIGHT_BLOCK);
+		expect(queue->overflow);
+		expect(queue->tail - queue->head == LIGHT_QUEUE_SIZE);
+
+		uint index, channel, level, in_order = 0;
+		for (uint i = 0; pop_light(queue, &index, &channel, &level); i++) in_order += index == i;
+		expect(in_order == LIGHT_QUEUE_SIZE);
+		queue->overflow = false;
+	}
+
+	// what a lost wave leaves behind (light where there should be none, none where there should be light)
+	// is thrown away by the rebuild the next edit does when it sees the overflow
+	{
+		memset(chunks->light + (4 * NUM_CHUNK_BLOCKS), 0, NUM_CHUNK_BLOCKS);
+		memset(chunks->light + (9 * NUM_CHUNK_BLOCKS), 0xFF, NUM_CHUNK_BLOCKS / 2);
+		expect(wrong_light(chunks) != 0);
+
+		chunks->light_removals.overflow = true;
+		start = get_timestamp();
+		set_block(chunks, ivec3(x0 + 50, 70, z0 + 50), BLOCK_STONE);
+		print("rebuild all light  : %8.0f us\n", microseconds_since(start));
+		expect(wrong_light(chunks) == 0);
+		expect(queues_empty(chunks));
+	}
+
+	return finish("light");
+}
@@ -0,0 +1,130 @@
+#include "renderer.h"
+#include "test.h"
+
+// clustered lighting : 10k point lights around the camera are binned without gl (bin_lights() with the view &
+// projection is everything but the upload). for random points on the screen, every light that reaches the point
+// has to be in the list of the cluster the point is in, like the lighting shader would look it up. the light
+// threads have to give the same lists as running the jobs one after another. also times culling & binning
+
+#define NUM_TEST_LIGHTS 10000
+#define TIMING_RUNS     200
+
+uint cluster_of(mat4 proj_view, vec3 point) // INVALID if the point isn't in any cluster
+{
+	vec4 clip = proj_view * vec4(point, 1);
+	if (clip.w <= .1f) return INVALID;
+
+	vec2 ndc = vec2(clip) / clip.w;
+	if (fabsf(ndc.x) >= 1 || fabsf(ndc.y) >= 1) return INVALID;
+
+	float depth = clip.w; // view space distance along the view direction
+	uint slice = (depth < LIGHT_NEAR) ? 0 : 1 + (uint)(logf(depth / LIGHT_NEAR) / logf(LIGHT_FAR / LIGHT_NEAR) * (LIGHT_CLUSTERS_Z - 1));
+	if (slice >= LIGHT_CLUSTERS_Z) return INVALID;
+
+	uvec2 tile = uvec2(((ndc * .5f) + .5f) * vec2(LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y));
+	return tile.x + (tile.y * LIGHT_CLUSTERS_X) + (slice * LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y);
+}
+
+uint64 hash_lists(Light_Clusters* clusters)
+{
+	uint64 hash = hash_bytes(clusters->clusters, sizeof(clusters->clusters));
+	for (uint job = 0; job < NUM_LIGHT_JOBS; job++)
+		hash = hash_bytes(clusters->indices + (job * JOB_LIGHT_INDICES), clusters->num_indices[job] * sizeof(u16), hash);
+
+	return hash;
+}
+
+int main()
+{
+	Light_Clusters* clusters = Alloc(Light_Clusters, 1);
+
+	vec3 eye = vec3(0, 64, 0), front = normalize(vec3(1, -.2f, .3f));
+	mat4 proj = perspective(FOV, 16.f / 9, .1f, DRAW_DISTANCE);
+	mat4 view = lookAt(eye, eye + front, vec3(0, 1, 0));
+
+	clear(clusters);
+	for (uint i = 0; i < NUM_TEST_LIGHTS; i++) // within 128 blocks of the camera, 3 to 10 blocks wide
+	{
+		vec3 offset = vec3(randfns(i, 1) * 128, randfns(i, 2) * 32, randfns(i, 3) * 128);
+		add_light(clusters, eye + offset, 6.5f + (randfns(i, 4) * 3.5f), vec3(1, .5, .2));
+	}
+
+	bin_lights(clusters, view, proj); // starts the light threads
+	uint64 threaded = hash_lists(clusters);
+
+	Timestamp ranges = 0, serial = 0, with_threads = 0;
+	for (uint run = 0; run < TIMING_RUNS; run++)
+	{
+		Timestamp start = get_timestamp();
+		find_light_ranges(clusters, view, proj);
+		Timestamp found = get_timestamp();
+		for (uint job = 0; job < NUM_LIGHT_JOBS; job++) bin_lights(clusters, job);
+		Timestamp binned = get_timestamp();
+		bin_lights(clusters, view, proj);
+
+		ranges += found - start;
+		serial += binned - found;
+		with_threads += get_timestamp() - binned;
+	}
+
+	for (uint job = 0; job < NUM_LIGHT_JOBS; job++) bin_lights(clusters, job);
+	expect(hash_lists(clusters) == threaded); // jobs one after another give the same lists
+
+	uint indices = 0, dropped = 0, lit = 0, most = 0;
+	for (uint job = 0; job < NUM_LIGHT_JOBS; job++) { indices += clusters->num_indices[job]; dropped += clusters->dropped[job]; }
+	for (uint c = 0; c < NUM_LIGHT_CLUSTERS; c++) { lit += clusters->clusters[c].y > 0; most = glm::max(most, clusters->clusters[c].y); }
+
+	print("%u lights : %u visible, %u indices (%u dropped), %u / %u clusters lit, at most %u lights in one\n",
+		NUM_TEST_LIGHTS, clusters->num_visible, indices, dropped, lit, NUM_LIGHT_CLUSTERS, most);
+	print("culling & ranges                    : %6.0f us\n", calculate_microseconds_elapsed(0, ranges) / (float)TIMING_RUNS);
+	print("binning, %u jobs one after another   : %6.0f us\n", NUM_LIGHT_JOBS, calculate_microseconds_elapsed(0, serial) / (float)TIMING_RUNS);
+	print("bin_lights() with the light threads : %6.0f us (%u cpus)\n", calculate_microseconds_elapsed(0, with_threads) / (float)TIMING_RUNS, std::thread::hardware_concurrency());
+
+	expect(clusters->num_visible > 0 && clusters->num_visible < NUM_TEST_LIGHTS);
+	expect(dropped == 0);
+
+	// every light that reaches a point has to be in that point's cluster
+	mat4 proj_view = proj * view;
+	uint points = 0, checked = 0, missing = 0;
+	for (uint n = 0; n < 200000; n++)
+	{
+		vec3 point = eye + vec3(randfns(n, 5) * 150, randfns(n, 6) * 50, randfns(n, 7) * 150);
+		uint cluster = cluster_of(proj_view, point);
+		if (cluster == INVALID) continue;
+
+		points++;
+		uvec2 list = clusters->clusters[cluster];
+
+		for (uint i = 0; i < clusters->num_lights; i++)
+		{
+			Point_Light light = clusters->lights[i];
+			if (distance(point, light.position) >= light.radius * .999f) continue; // (not right on the edge)
+
+			bool found = false;
+			for (uint k = 0; k < list.y && !found; k++) found = clusters->indices[list.x + k] == i;
+
+			checked++;
+			missing += !found;
+		}
+	}
+	print("%u points on the screen, %u lights reaching them, %u missing from their cluster\n", points, checked, missing);
+	expect(checked > 1000);
+	expect(missing == 0);
+
+	// a light right in front of the camera touches every tile of the nearest slice
+	clear(clusters);
+	add_light(clusters, eye + front, 4, vec3(1));
+	bin_lights(clusters, view, proj);
+	Light_Range range = clusters->visible[0];
+	expect(clusters->num_visible == 1);
+	expect(range.x0 == 0 && range.x1 == LIGHT_CLUSTERS_X - 1 && range.y0 == 0 && range.y1 == LIGHT_CLUSTERS_Y - 1 && range.z0 == 0);
+
+	// behind the camera & past LIGHT_FAR : not lit
+	clear(clusters);
+	add_light(clusters, eye - (front * 20.f), 4, vec3(1));
+	add_light(clusters, eye + (front * (LIGHT_FAR + 20)), 4, vec3(1));
+	bin_lights(clusters, view, proj);
+	expect(clusters->num_visible == 0);
+
+	return finish("light_clusters");
+}
@@ -0,0 +1,233 @@
+#include "items.h"
+#include "test.h"
+
+// machines : random furnace & machine states are run for n ticks with one advance() & with n advances of one
+// tick, at partial power & with fuel that runs out part way, & have to end up exactly the same. then 2 copies of
+// a small power grid are ticked through a brownout, one with the machines in an active chunk & one with them in
+// a border chunk (stepped every 4th tick) : both have to make the same. a machine off any grid does nothing.
+// also times 100k machines ticked every tick against being stepped by tier, with idle ones skipped
+
+#define NUM_STATES      20000 // of each kind
+#define LONG_SKIP       20000 // ticks, the longest skip
+#define NUM_MACHINES    100000
+#define TIMING_TICKS    2000
+
+uint num_rolls;
+uint roll(uint max) { return random_uint(num_rolls++, 40) % max; } // [0, max)
+
+bool same(Item a, Item b) { return a.type == b.type && a.id == b.id && a.count == b.count; }
+Item some(uint type, uint id, uint count) { return count ? Item{ type, id, count } : Item{}; }
+
+bool same(Furnace* a, Furnace* b)
+{
+	return same(a->in, b->in) && same(a->out, b->out) && same(a->fuel, b->fuel) && a->progress == b->progress && a->burn == b->burn && a->busy == b->busy;
+}
+bool same(Machine* a, Machine* b)
+{
+	return same(a->in, b->in) && same(a->out, b->out) && a->progress == b->progress && a->burn == b->burn && a->busy == b->busy;
+}
+
+Item machine_input(u16 block, uint count)
+{
+	switch (block)
+	{
+	case BLOCK_CRUSHER: return some(ITEM_BLOCK, BLOCK_IRON_ORE, count);
+	case BLOCK_WASHER : return some(ITEM_RESOURCE, RESOURCE_CRUSHED_IRON_ORE, count);
+	case BLOCK_SMELTER: return some(ITEM_INGOT, INGOT_IRON, count);
+	default: return some(ITEM_RESOURCE, RESOURCE_COAL, count); // generator
+	}
+}
+
+// a power grid : a generator & 3 smelters on a line of wire, the last smelter & the generator in 'tier'
+struct Grid { ivec3 generator, smelters[3]; };
+
+Grid build_grid(Block_Entities* entities, int z, u8 tier)
+{
+	Grid grid;
+	for (int x = 0; x < 6; x++)
+	{
+		create_entity(entities, ivec3(x, 70, z), BLOCK_WIRE);
+		connect_pipe(entities, ivec3(x, 70, z));
+	}
+
+	grid.generator = ivec3(0, 71, z);
+	create_entity(entities, grid.generator, BLOCK_GENERATOR, tier);
+
+	uint ore[3] = { 2, 5, 64 }; // the first 2 run out of work soon, the power goes up when they do
+	for (int i = 0; i < 3; i++)
+	{
+		grid.smelters[i] = ivec3(1 + i, 71, z);
+		create_entity(entities, grid.smelters[i], BLOCK_SMELTER, (i == 2) ? tier : TIER_ACTIVE);
+		store_item(entities, grid.smelters[i], Item{ ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE, ore[i] });
+	}
+
+	return grid;
+}
+
+int main()
+{
+	load_recipes(&recipes, "assets/recipes.txt");
+
+	// skipping ahead against ticking
+	uint furnaces_differ = 0, machines_differ = 0, ran_out = 0, partial = 0;
+	const u16 blocks[4] = { BLOCK_CRUSHER, BLOCK_WASHER, BLOCK_SMELTER, BLOCK_GENERATOR };
+
+	for (uint i = 0; i < NUM_STATES; i++)
+	{
+		uint ticks = 1 + roll((i < NUM_STATES / 2) ? 400 : LONG_SKIP);
+
+		Furnace furnace = {};
+		furnace.in = some(ITEM_BLOCK, BLOCK_IRON_ORE, roll(65));
+		if (roll(3)) furnace.out = some(ITEM_INGOT, INGOT_IRON, 1 + roll(64));
+		if (roll(4)) furnace.fuel = roll(2) ? some(ITEM_RESOURCE, RESOURCE_COAL, 1 + roll(3)) : some(ITEM_BLOCK, BLOCK_WOOD, 1 + roll(3));
+		furnace.burn = roll(3) ? roll(400) : 0;
+		furnace.progress = roll(200 * PROGRESS_SCALE);
+
+		uint fuel = furnace.burn + (furnace.fuel.count * fuel_ticks(furnace.fuel));
+		ran_out += furnace.in.type && fuel < ticks;
+
+		Furnace ticked = furnace;
+		advance(&furnace, ticks);
+		for (uint t = 1; t <= ticks; t++) advance(&ticked, t);
+		furnaces_differ += !same(&furnace, &ticked);
+
+		Machine machine = {};
+		machine.block = blocks[roll(4)];
+		machine.power = roll(257) / 256.f; // 0 to 1
+		machine.in = machine_input(machine.block, roll(65));
+
+		if (machine.block == BLOCK_GENERATOR)
+		{
+			machine.in.count = glm::min(machine.in.count, roll(4)); // little enough to run out
+			if (machine.in.count == 0) machine.in = {};
+			machine.burn = roll(500);
+			ran_out += machine.burn + (machine.in.count * fuel_ticks(machine.in)) < ticks;
+		}
+		else
+		{
+			Process_Recipe* recipe = find_recipe(&recipes, machine.block, machine.in);
+			if (recipe && roll(2)) { machine.out = recipe->out; machine.out.count = 1 + roll(60); }
+			if (recipe) machine.progress = roll((uint)(recipe->time * TICKS_PER_SECOND) * PROGRESS_SCALE);
+			partial += machine.power > 0 && machine.power < 1;
+		}
+
+		Machine stepped = machine;
+		advance(&machine, ticks);
+		for (uint t = 1; t <= ticks; t++) advance(&stepped, t);
+		machines_differ += !same(&machine, &stepped);
+	}
+
+	print("%u furnaces & %u machines skipped up to %u ticks : %u & %u differ from ticking (%u ran out of fuel, %u at partial power)\n",
+		NUM_STATES, NUM_STATES, LONG_SKIP, furnaces_differ, machines_differ, ran_out, partial);
+	expect(furnaces_differ == 0 && machines_differ == 0);
+	expect(ran_out > 1000 && partial > 1000);
+
+	// a brownout : the grid starts short of power, gets enough once 2 smelters are done, then the fuel runs out
+	Block_Entities* entities = Alloc(Block_Entities, 1);
+	Grid active = build_grid(entities, 0, TIER_ACTIVE);
+	Grid border = build_grid(entities, 10, TIER_BORDER);
+
+	ivec3 off_grid = ivec3(20, 71, 20);
+	create_entity(entities, off_grid, BLOCK_SMELTER);
+	store_item(entities, off_grid, Item{ ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE, 10 });
+
+	uint short_ticks = 0, full_ticks = 0, dark_ticks = 0, out_tick = 0;
+	for (uint t = 0; t < 1500; t++)
+	{
+		if (t == 5) // the fuel runs out at an odd tick
+		{
+			store_item(entities, active.generator, Item{ ITEM_BLOCK, BLOCK_WOOD, 2 });
+			store_item(entities, border.generator, Item{ ITEM_BLOCK, BLOCK_WOOD, 2 });
+		}
+		if (t == 1200) // & comes back
+		{
+			store_item(entities, active.generator, Item{ ITEM_RESOURCE, RESOURCE_COAL, 1 });
+			store_item(entities, border.generator, Item{ ITEM_RESOURCE, RESOURCE_COAL, 1 });
+		}
+
+		tick_entities(entities);
+
+		float power = get_machine(entities, active.smelters[2])->power;
+		short_ticks += power > 0 && power < 1;
+		full_ticks  += power == 1;
+		dark_ticks  += power == 0;
+		if (power == 0 && full_ticks && !out_tick) out_tick = entities->tick;
+	}
+
+	Machine* a = get_machine(entities, active.smelters[2]);
+	Machine* b = get_machine(entities, border.smelters[2]);
+	advance(a, entities->tick);
+	advance(b, entities->tick);
+
+	print("brownout : %u ticks short of power, %u full, %u without (from tick %u)\n", short_ticks, full_ticks, dark_ticks, out_tick);
+	print("           active smelter made %u, border smelter made %u, progress %u & %u\n", a->out.count, b->out.count, a->progress, b->progress);
+	expect(short_ticks > 0 && full_ticks > 0 && dark_ticks > 0);
+	expect(out_tick % TIER_TICK_RATE[TIER_BORDER] != 0);
+	expect(same(a, b));
+	expect(same(get_machine(entities, active.generator), get_machine(entities, border.generator)));
+
+	Machine* unpowered = get_machine(entities, off_grid);
+	advance(unpowered, entities->tick);
+	expect(unpowered->in.count == 10 && unpowered->out.type == 0 && unpowered->progress == 0);
+
+	// 100k machines at full power : every one every tick, against stepping by tier & skipping idle ones
+	free(entities);
+	entities = Alloc(Block_Entities, 1);
+
+	for (uint i = 0; i < NUM_MACHINES; i++) // tiers in the same proportions as the loaded chunks
+	{
+		u8 tier = (i % NUM_CHUNKS < NUM_ACTIVE_CHUNKS) ? TIER_ACTIVE : (i % NUM_CHUNKS < NUM_ACTIVE_CHUNKS + NUM_BORDER_CHUNKS) ? TIER_BORDER : TIER_PRIMED;
+		create_entity(entities, ivec3(i % 300, 70 + ((i / 300) % 50), i / 15000), BLOCK_CRUSHER + (i % 3), tier);
+	}
+
+	uint64 outputs[2] = {};
+	Timestamp times[2] = {};
+	for (uint run = 0; run < 2; run++)
+	{
+		for (uint i = 0; i < NUM_MACHINES; i++) // a quarter of them have nothing to do
+		{
+			Machine* machine = entities->machines + i;
+			machine->in = machine_input(machine->block, (i % 4) ? MAX_STACK_SIZE : 0);
+			machine->out = {};
+			machine->progress = 0;
+			machine->power = 1;
+			machine->tick = entities->tick;
+			advance(machine, entities->tick);
+		}
+
+		Timestamp start = get_timestamp();
+		for (uint t = 0; t < TIMING_TICKS; t++)
+		{
+			uint tick = ++entities->tick;
+			for (uint i = 0; i < NUM_MACHINES; i++)
+			{
+				Machine* machine = entities->machines + i;
+				uint rate = TIER_TICK_RATE[machine->tier];
+				if (run == 0 || (machine->busy && rate && (tick % rate) == 0)) advance(machine, tick);
+			}
+		}
+		times[run] = get_timestamp() - start;
+
+		for (uint i = 0; i < NUM_MACHINES; i++)
+		{
+			advance(entities->machines + i, entities->tick); // catches up the skipped ones
+			outputs[run] += entities->machines[i].out.count;
+		}
+	}
+
+	print("%u machines : %.2f ms per tick ticking every one, %.2f ms stepped by tier, %llu & %llu made\n", NUM_MACHINES,
+		calculate_microseconds_elapsed(0, times[0]) / (1000.f * TIMING_TICKS), calculate_microseconds_elapsed(0, times[1]) / (1000.f * TIMING_TICKS), outputs[0], outputs[1]);
+	expect(outputs[0] == outputs[1]);
+
+	uint primed = 0;
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < NUM_MACHINES; i++)
+	{
+		if (entities->machines[i].tier != TIER_PRIMED) continue;
+		advance(entities->machines + i, entities->tick + 100000);
+		primed++;
+	}
+	print("catching up %u primed machines by 100000 ticks : %.2f ms\n", primed, microseconds_since(start) / 1000);
+
+	return finish("machines");
+}
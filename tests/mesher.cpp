@@ -0,0 +1,203 @@
+#include "chunk.h"
+#include "test.h"
+
+// chunk meshing : times update(Chunk_Renderer*) on the active chunks of a generated world against the mesher
+// from before ambient occlusion was baked in (kept below, like it was apart from the block id), so the cost of
+// the ao can be checked against the 20% it was allowed. then blocks are placed up in the air, in the middle of a
+// chunk & across a chunk border, & the ao of their top face corners has to be what init_ao_tables() says
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+#define TIMING_RUNS  30 // per chunk, the best one counts
+
+void APIENTRY fake_BindBuffer(GLenum, GLuint) {}
+void APIENTRY fake_BufferSubData(GLenum, GLintptr, GLsizeiptr, const void*) {}
+
+void update_without_ao(Chunk_Renderer* renderer, Chunk chunk, Chunk_Loader* chunks) // what the ao mesher replaced
+{
+	u16* blocks = chunks->blocks;
+
+	Solid_Drawable* solid_mem = renderer->solids;
+	Fluid_Drawable* fluid_mem = renderer->fluids;
+
+	uint num_solids = 0, num_fluids = 0;
+
+	for (uint x = 0; x < CHUNK_X; ++x) {
+	for (uint z = 0; z < CHUNK_Z; ++z) {
+	for (uint y = 0; y < CHUNK_Y; ++y)
+	{
+		uint index = BLOCK_INDEX(x, y, z, chunk.blocks_index);
+
+		// if block is surrounded, don't draw it
+		if (y > 0 && x > 0 && z > 0 && y < CHUNK_Y - 1 && x < 15 && z < 15)
+		{
+			if (  blocks[index + 1]   >= BLOCK_WATER || blocks[index - 1]   >= BLOCK_WATER
+				|| blocks[index + 16]  >= BLOCK_WATER || blocks[index - 16]  >= BLOCK_WATER
+				|| blocks[index + 256] >= BLOCK_WATER || blocks[index - 256] >= BLOCK_WATER)
+			{
+				goto draw_block;
+			}
+
+			if (blocks[index + 1] && blocks[index - 1]
+				&& blocks[index + 16] && blocks[index - 16]
+				&& blocks[index + 256] && blocks[index - 256])
+			{
+				continue;
+			}
+		}
+
+		draw_block:
+
+		u16 block = blocks[index];
+		if (block == BLOCK_AIR) continue;
+
+		vec3 position = vec3(x, y, z) + vec3(chunk.x, 0, chunk.z);
+
+		if (block < BLOCK_WATER)
+		{
+			solid_mem->position = position;
+			solid_mem->block = block;
+			solid_mem->light[0] = solid_mem->light[1] = 0;
+
+			for (uint face = 0; face < 6; face++)
+			{
+				uint next = neighbor(&chunks->lookup, index, face);
+
+				u8 light = (next != INVALID_BLOCK_INDEX) ? chunks->light[next] : (face == FACE_NEG_Y) ? 0 : MAX_LIGHT << 4;
+				solid_mem->light[face / 4] |= light << ((face % 4) * 8);
+			}
+
+			solid_mem++;
+			num_solids++;
+		}
+		else if (is_fluid(block))
+		{
+			fluid_mem->position = position;
+			fluid_mem++;
+			num_fluids++;
+		}
+	} } }
+
+	renderer->chunk_id   = chunk.id;
+	renderer->num_solids = num_solids;
+	renderer->num_fluids = num_fluids;
+	update(renderer->solid_mesh, num_solids * sizeof(Solid_Drawable), (byte*)renderer->solids);
+	update(renderer->fluid_mesh, num_fluids * sizeof(Fluid_Drawable), (byte*)renderer->fluids);
+}
+
+Timestamp best_time(void (*mesher)(Chunk_Renderer*, Chunk, Chunk_Loader*), Chunk_Renderer* renderer, Chunk chunk, Chunk_Loader* chunks)
+{
+	Timestamp best = ~0ull;
+	for (uint run = 0; run < TIMING_RUNS; run++)
+	{
+		Timestamp start = get_timestamp();
+		mesher(renderer, chunk, chunks);
+		best = glm::min(best, get_timestamp() - start);
+	}
+
+	return best;
+}
+
+uint corner_ao(bool side_1, bool side_2, bool diagonal) // the classic 3 neighbour ao, 3 = not occluded
+{
+	return (side_1 && side_2) ? 0 : 3 - (side_1 + side_2 + diagonal);
+}
+uint top_corner(Chunk_Renderer* renderer, ivec3 pos, uint corner) // ao of a corner of the top face of the block at 'pos'
+{
+	for (uint i = 0; i < renderer->num_solids; i++)
+	{
+		if (renderer->solids[i].position != vec3(pos)) continue;
+
+		uint top = renderer->solids[i].ao[FACE_POS_Y / 4] >> ((FACE_POS_Y % 4) * 8);
+		return (top >> (corner * 2)) & 3;
+	}
+
+	return INVALID;
+}
+
+int main()
+{
+	__glewBindBuffer    = fake_BindBuffer;
+	__glewBufferSubData = fake_BufferSubData;
+
+	Chunk_Loader* chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+	update_chunks(chunks, SCENE_CENTER);
+
+	Chunk_Renderer* renderer = Alloc(Chunk_Renderer, 1);
+	init_ao_tables();
+
+	Timestamp before = 0, after = 0;
+	uint solids_before = 0, solids_after = 0;
+	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++)
+	{
+		Chunk chunk = chunks->active[i];
+		before += best_time(update_without_ao, renderer, chunk, chunks);
+		solids_before += renderer->num_solids;
+		after += best_time(update, renderer, chunk, chunks);
+		solids_after += renderer->num_solids;
+	}
+
+	float before_us = calculate_microseconds_elapsed(0, before) / (float)NUM_ACTIVE_CHUNKS;
+	float after_us  = calculate_microseconds_elapsed(0, after ) / (float)NUM_ACTIVE_CHUNKS;
+	print("before ao : %6.1f us per chunk, %u blocks drawn\n", before_us, solids_before / NUM_ACTIVE_CHUNKS);
+	print("with ao   : %6.1f us per chunk, %u blocks drawn (%+.0f%%)\n", after_us, solids_after / NUM_ACTIVE_CHUNKS, ((after_us / before_us) - 1) * 100);
+	expect(solids_after > 0 && solids_after <= solids_before); // the apron only hides more
+
+	// the table against the rule, for every mask
+	const ivec2 AROUND[8] = { ivec2(-1,-1), ivec2(0,-1), ivec2(1,-1), ivec2(-1,0), ivec2(1,0), ivec2(-1,1), ivec2(0,1), ivec2(1,1) };
+	uint wrong = 0;
+	for (uint mask = 0; mask < 256; mask++) {
+	for (uint corner = 0; corner < 4; corner++)
+	{
+		ivec2 uv = ivec2((corner & 1) ? 1 : -1, (corner & 2) ? 1 : -1);
+		bool side_1 = false, side_2 = false, diagonal = false;
+
+		for (uint bit = 0; bit < 8; bit++)
+		{
+			if ((mask & (1 << bit)) == 0) continue;
+			side_1   |= AROUND[bit] == ivec2(uv.x, 0);
+			side_2   |= AROUND[bit] == ivec2(0, uv.y);
+			diagonal |= AROUND[bit] == uv;
+		}
+
+		wrong += ((ao_table[mask] >> (corner * 2)) & 3) != corner_ao(side_1, side_2, diagonal);
+	} }
+	expect(wrong == 0);
+
+	// blocks in the air : the top face's corners are (-x -z, +x -z, -x +z, +x +z)
+	Chunk chunk = chunks->active[4];
+	int height = 100;
+	ivec3 middle = ivec3(chunk.x + 5, height, chunk.z + 5);
+	ivec3 border = ivec3(chunk.x + CHUNK_X - 1, height, chunk.z + 10); // its +x side is in the next chunk
+	ivec3 up = ivec3(0, 1, 0);
+
+	set_block(chunks, middle, BLOCK_STONE);
+	set_block(chunks, middle + up + ivec3(1, 0, 0), BLOCK_STONE); // +x side
+	set_block(chunks, middle + up + ivec3(0, 0, 1), BLOCK_STONE); // +z side
+	set_block(chunks, middle + up + ivec3(-1, 0, -1), BLOCK_STONE); // -x -z diagonal
+
+	set_block(chunks, border, BLOCK_STONE);
+	set_block(chunks, border + up + ivec3(1, 0, 1), BLOCK_STONE); // +x +z diagonal, in the next chunk
+
+	update(renderer, chunk, chunks);
+
+	uint expected[2][4] = {
+		{ corner_ao(false, false, true), corner_ao(true, false, false), corner_ao(false, true, false), corner_ao(true, true, false) },
+		{ corner_ao(false, false, false), corner_ao(false, false, false), corner_ao(false, false, false), corner_ao(false, false, true) },
+	};
+	ivec3 blocks[2] = { middle, border };
+	const char* names[2] = { "middle", "border" };
+
+	for (uint b = 0; b < 2; b++)
+	{
+		uint found[4];
+		for (uint corner = 0; corner < 4; corner++) found[corner] = top_corner(renderer, blocks[b], corner);
+
+		print("%s : top corners %u %u %u %u, expected %u %u %u %u\n", names[b], found[0], found[1], found[2], found[3], expected[b][0], expected[b][1], expected[b][2], expected[b][3]);
+		for (uint corner = 0; corner < 4; corner++) expect(found[corner] == expected[b][corner]);
+	}
+
+	return finish("mesher");
+}
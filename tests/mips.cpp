@@ -0,0 +1,136 @@
+#include "world.h"
+#include "test.h"
+
+// mip chains : the sse2 downsample() has to give exactly what the plain 2x2 box filter below gives, for every
+// size from 2 to 1024 (the smallest ones only go through the scalar tail). a flat colour has to stay flat all
+// the way down & a 1 pixel checkerboard of 0 & 255 has to give 128 below mip 0. then the block textures are
+// built from the real atlas & uploaded through make_texture_array() to fake glTexImage3D / glTexSubImage3D,
+// which check that every mip of every layer arrives. the rest of its gl calls are opengl32's & do nothing
+// without a context. times the mips, build() & the upload
+
+#define MAX_TEST_SIZE 1024
+#define TIMING_RUNS   20
+
+void downsample_reference(byte* dst, const byte* src, uint size)
+{
+	uint half = size / 2;
+	for (uint y = 0; y < half; y++) {
+	for (uint x = 0; x < half; x++) {
+	for (uint c = 0; c < 4; c++)
+	{
+		uint a = src[((((2 * y)    ) * size) + (2 * x)    ) * 4 + c], b = src[((((2 * y)    ) * size) + (2 * x) + 1) * 4 + c];
+		uint d = src[((((2 * y) + 1) * size) + (2 * x)    ) * 4 + c], e = src[((((2 * y) + 1) * size) + (2 * x) + 1) * 4 + c];
+		dst[((y * half) + x) * 4 + c] = (a + b + d + e + 2) / 4;
+	} } }
+}
+
+// what was uploaded, per mip of each layer (only kept, so the upload is timed without checking it)
+uint num_uploads, uploaded_layers, uploaded_size;
+const void* uploads[16][MAX_BLOCK_LAYERS];
+
+void APIENTRY fake_TexImage3D(GLenum, GLint, GLint, GLsizei width, GLsizei, GLsizei depth, GLint, GLenum, GLenum, const void*)
+{
+	if (uploaded_size == 0) { uploaded_size = width; uploaded_layers = depth; }
+}
+void APIENTRY fake_TexSubImage3D(GLenum, GLint level, GLint, GLint, GLint layer, GLsizei width, GLsizei height, GLsizei, GLenum, GLenum, const void* pixels)
+{
+	num_uploads++;
+	uploads[level][layer] = pixels;
+}
+
+int main()
+{
+	__glewTexImage3D    = fake_TexImage3D;
+	__glewTexSubImage3D = fake_TexSubImage3D;
+
+	byte* src      = Alloc(byte, MAX_TEST_SIZE * MAX_TEST_SIZE * 4);
+	byte* fast     = Alloc(byte, MAX_TEST_SIZE * MAX_TEST_SIZE);
+	byte* expected = Alloc(byte, MAX_TEST_SIZE * MAX_TEST_SIZE);
+
+	// sse2 against the reference : random texels, then the values where rounding could go wrong
+	uint sizes = 0, differ = 0;
+	for (uint size = 2; size <= MAX_TEST_SIZE; size *= 2, sizes++) {
+	for (uint pattern = 0; pattern < 4; pattern++)
+	{
+		for (uint i = 0; i < size * size * 4; i++)
+		{
+			uint n = random_uint(i, size + pattern);
+			switch (pattern)
+			{
+			case 0: src[i] = (byte)n; break;
+			case 1: src[i] = 255; break; // the sum overflows 8 bits
+			case 2: src[i] = (n & 1) ? 1 : 2; break; // sums ending in .5 after the divide
+			case 3: src[i] = (n & 1) ? 254 : 255; break;
+			}
+		}
+
+		downsample(fast, src, size);
+		downsample_reference(expected, src, size);
+		differ += memcmp(fast, expected, (size / 2) * (size / 2) * 4) != 0;
+	} }
+	print("downsample : %u sizes x 4 patterns, %u differ from the reference\n", sizes, differ);
+	expect(differ == 0);
+
+	// a flat colour stays flat, the chain ends at 1 x 1
+	uint size = 128, chain = mip_chain_size(size);
+	byte* layer = Alloc(byte, chain);
+	for (uint i = 0; i < size * size; i++) { layer[i * 4] = 200; layer[(i * 4) + 1] = 17; layer[(i * 4) + 2] = 3; layer[(i * 4) + 3] = 255; }
+	build_mips(layer, size);
+
+	uint not_flat = 0;
+	for (uint i = 0; i < chain / 4; i++)
+		not_flat += layer[i * 4] != 200 || layer[(i * 4) + 1] != 17 || layer[(i * 4) + 2] != 3 || layer[(i * 4) + 3] != 255;
+
+	expect(num_mips(size) == 8);
+	expect(chain == ((128 * 128) + (64 * 64) + (32 * 32) + (16 * 16) + (8 * 8) + (4 * 4) + (2 * 2) + 1) * 4);
+	expect(not_flat == 0);
+
+	// a checkerboard of 0 & 255 : (0 + 255 + 0 + 255 + 2) / 4 = 128, & stays there
+	for (uint y = 0; y < size; y++)
+	for (uint x = 0; x < size; x++)
+		memset(layer + (((y * size) + x) * 4), ((x ^ y) & 1) ? 255 : 0, 4);
+	build_mips(layer, size);
+
+	uint not_grey = 0;
+	for (uint i = size * size * 4; i < chain; i++) not_grey += layer[i] != 128;
+	print("flat colour : %u texels changed, checkerboard : %u texels below mip 0 aren't 128\n", not_flat, not_grey);
+	expect(not_grey == 0);
+
+	// the mips of a big layer, sse2 against the reference
+	Timestamp fast_time = 0, reference_time = 0;
+	for (uint run = 0; run < TIMING_RUNS; run++)
+	{
+		Timestamp start = get_timestamp();
+		downsample(fast, src, MAX_TEST_SIZE);
+		Timestamp middle = get_timestamp();
+		downsample_reference(expected, src, MAX_TEST_SIZE);
+		fast_time += middle - start;
+		reference_time += get_timestamp() - middle;
+	}
+	print("%u x %u -> %u : %.0f us, reference %.0f us\n", MAX_TEST_SIZE, MAX_TEST_SIZE, MAX_TEST_SIZE / 2,
+		calculate_microseconds_elapsed(0, fast_time) / (float)TIMING_RUNS, calculate_microseconds_elapsed(0, reference_time) / (float)TIMING_RUNS);
+
+	// the real block textures
+	Block_Textures* textures = Alloc(Block_Textures, 1);
+	Timestamp start = get_timestamp();
+	expect(build(textures, "assets/textures/block_atlas.bmp", "assets/textures/materials.bmp"));
+	float build_ms = microseconds_since(start) / 1000;
+
+	uint tile = textures->tile_size, layers = textures->num_layers, mips = num_mips(tile);
+	start = get_timestamp();
+	make_texture_array(textures->texels, tile, layers);
+	float upload_ms = microseconds_since(start) / 1000;
+
+	uint wrong = 0;
+	for (uint l = 0; l < layers; l++)
+	for (uint mip = 0, mip_size = tile, offset = 0; mip < mips; mip++, offset += mip_size * mip_size * 4, mip_size /= 2)
+		wrong += uploads[mip][l] != textures->texels + (l * mip_chain_size(tile)) + offset;
+
+	print("block textures : %u layers of %u x %u, build() %.2f ms, make_texture_array() %.2f ms, %u uploads (%u wrong)\n",
+		layers, tile, tile, build_ms, upload_ms, num_uploads, wrong);
+	expect(layers > 0 && uploaded_size == tile && uploaded_layers == layers);
+	expect(num_uploads == layers * mips);
+	expect(wrong == 0);
+
+	return finish("mips");
+}
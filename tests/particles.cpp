@@ -0,0 +1,78 @@
+#define MAX_PARTICLES 10240
+#include "world.h"
+#include "test.h"
+
+// particle collision : 10k debris, sparks & blood dropped onto generated terrain with a fixed seed.
+// none of them may end up inside a block or fall through the world, blood (which sticks) has to come to rest
+// on the ground, & running the same scene twice has to give exactly the same particles. the target is 1 ms
+// per update for all of them
+
+#define SCENE_SEED   1234
+#define SCENE_FRAMES 1200 // 20 seconds
+#define SCENE_CENTER vec3(116, 0, 116)
+
+float ground_height(Chunk_Loader* chunks, vec3 position) // top of the highest solid block under 'position'
+{
+	for (int y = CHUNK_Y - 1; y >= 0; y--)
+		if (is_solid(get_block(&chunks->lookup, chunks->blocks, ivec3(floor(position.x), y, floor(position.z))))) return y + 1.f;
+
+	return 0;
+}
+
+void run_scene(Particle_Emitter* emitter, Chunk_Loader* chunks, float* update_us)
+{
+	*emitter = {};
+
+	uint types[3] = { PARTICLE_DEBRIS, PARTICLE_SPARK, PARTICLE_BLOOD };
+	for (uint i = 0; i < MAX_PARTICLES; i++) // 16 bursts 4 blocks above the ground, spread over the scene
+	{
+		vec3 burst = SCENE_CENTER + vec3(((i % 16) % 4) * 6.f - 8.5f, 0, ((i % 16) / 4) * 6.f - 8.5f);
+		burst.y = ground_height(chunks, burst) + 4;
+		vec3 velocity = vec3(randfns(i, 1), randfns(i, 2), randfns(i, 3)) * 4.f;
+		emitter->particles[i] = { types[i % 3], burst, velocity, 0, 100 };
+	}
+
+	Timestamp start = get_timestamp();
+	for (uint frame = 0; frame < SCENE_FRAMES; frame++) update(emitter, chunks, 1 / 60.f);
+	*update_us = microseconds_since(start) / SCENE_FRAMES;
+}
+
+int main()
+{
+	Chunk_Loader* chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+	update_chunks(chunks, SCENE_CENTER);
+
+	Particle_Emitter* emitter = Alloc(Particle_Emitter, 1);
+	float update_us = 0;
+	run_scene(emitter, chunks, &update_us);
+
+	uint inside = 0, fell_out = 0, resting = 0, floating = 0;
+	for (uint i = 0; i < MAX_PARTICLES; i++)
+	{
+		Particle particle = emitter->particles[i];
+		ivec3 block = ivec3(floor(particle.position));
+
+		if (is_solid(get_block(&chunks->lookup, chunks->blocks, block))) inside++;
+		if (particle.position.y < 1) fell_out++;
+		if (particle.type != PARTICLE_BLOOD) continue; // debris & sparks can still be bouncing
+
+		bool on_ground = is_solid(get_block(&chunks->lookup, chunks->blocks, block - ivec3(0, 1, 0)));
+		if (on_ground && particle.velocity.y == 0) resting++;
+		else floating++;
+	}
+
+	print("%u particles, %u inside blocks, %u fell out, %u blood resting, %u not\n", MAX_PARTICLES, inside, fell_out, resting, floating);
+	print("update : %.0f us per frame (target 1000 us)\n", update_us);
+
+	expect(inside == 0);
+	expect(fell_out == 0);
+	expect(floating == 0);
+
+	uint64 first = hash_bytes(emitter->particles, sizeof(emitter->particles));
+	run_scene(emitter, chunks, &update_us);
+	expect(hash_bytes(emitter->particles, sizeof(emitter->particles)) == first); // deterministic
+
+	return finish("particles");
+}
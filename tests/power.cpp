@@ -0,0 +1,187 @@
+#include "items.h"
+#include "test.h"
+
+// power grids : a synthetic factory of 400 grids, each a line of 40 wires with 20 machines along one side
+// & 2 generators & 2 solar panels along the other, a third of the generators without fuel. every machine
+// has to get what its grid's supply & demand say it should, every tick for 1000 ticks while they run out of work.
+// then a wire is cut in the middle of a grid, put back, & a machine is replaced : the grids have to be right
+// again on the next tick. times tick_power() & a whole tick_entities(), & the cut & rejoin
+
+#define NUM_GRIDS      400
+#define GRID_LENGTH    40 // wires
+#define GRID_MACHINES  20
+#define NUM_TICKS      1000
+
+Block_Entities* entities;
+
+void place(ivec3 pos, u16 block) // like a synced set_block()
+{
+	create_entity(entities, pos, block);
+	if (block == BLOCK_WIRE) connect_pipe(entities, pos);
+	touch_networks(entities, pos);
+}
+void remove(ivec3 pos)
+{
+	Entity_Slot* slot = find_slot(entities, pos);
+	if (slot->block == BLOCK_WIRE) disconnect_pipe(entities, pos);
+	remove_entity(entities, slot);
+	touch_networks(entities, pos);
+}
+
+void power_tick() // tick_entities(), with the grids stopped after tick_power() to be checked
+{
+	entities->tick++;
+	tick_transport(entities);
+	tick_power(entities);
+}
+void step_machines() // the rest of tick_entities(), every machine is in an active chunk
+{
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++)
+		if (entities->machines[i].busy) advance(entities->machines + i, entities->tick);
+}
+
+uint wrong_power(uint* num_grids, uint* partial) // machines whose power isn't what the totals of their grid say
+{
+	static float supply[MAX_NETWORKS], demand[MAX_NETWORKS];
+	memset(supply, 0, sizeof(supply));
+	memset(demand, 0, sizeof(demand));
+
+	Transport* transport = &entities->transport;
+	Machine* machines = entities->machines;
+	uint num_machines = entities->counts[ENTITY_MACHINE];
+
+	for (uint i = 0; i < num_machines; i++)
+	{
+		Network* grid = transport->networks + machines[i].grid;
+		if (grid->block != BLOCK_WIRE || grid->generation != machines[i].grid_generation) continue;
+
+		supply[machines[i].grid] += power_supply(machines + i);
+		if (machines[i].busy) demand[machines[i].grid] += power_demand(machines[i].block);
+	}
+
+	uint wrong = 0;
+	*num_grids = *partial = 0;
+	for (uint i = 0; i < transport->num_networks; i++) *num_grids += transport->networks[i].block == BLOCK_WIRE;
+
+	for (uint i = 0; i < num_machines; i++)
+	{
+		Network* grid = transport->networks + machines[i].grid;
+		bool on_grid = grid->block == BLOCK_WIRE && grid->generation == machines[i].grid_generation;
+
+		float expected = 0;
+		if (on_grid) expected = (supply[machines[i].grid] >= demand[machines[i].grid]) ? 1 : supply[machines[i].grid] / demand[machines[i].grid];
+
+		wrong += machines[i].power != expected;
+		*partial += power_demand(machines[i].block) > 0 && expected > 0 && expected < 1;
+	}
+
+	return wrong;
+}
+
+int main()
+{
+	load_recipes(&recipes, "assets/recipes.txt");
+	entities = Alloc(Block_Entities, 1);
+
+	const u16 consumers[3] = { BLOCK_CRUSHER, BLOCK_WASHER, BLOCK_SMELTER };
+	const Item inputs[3] = { { ITEM_BLOCK, BLOCK_IRON_ORE, 0 }, { ITEM_RESOURCE, RESOURCE_CRUSHED_IRON_ORE, 0 }, { ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE, 0 } };
+
+	ivec3 first = ivec3(0, 70, 1);
+	for (uint g = 0; g < NUM_GRIDS; g++) // 4 side by side, 25 rows of those, 4 layers
+	{
+		ivec3 start = ivec3((g % 4) * (GRID_LENGTH + 10), 70 + ((g / 100) * 2), 1 + (((g / 4) % 25) * 3));
+		for (int x = 0; x < GRID_LENGTH; x++) place(start + ivec3(x, 0, 0), BLOCK_WIRE);
+
+		for (uint m = 0; m < GRID_MACHINES; m++)
+		{
+			uint kind = (g + m) % 3;
+			ivec3 pos = start + ivec3(2 * m, 0, 1);
+			place(pos, consumers[kind]);
+
+			Item input = inputs[kind]; input.count = 1 + (((g * 7) + (m * 13)) % MAX_STACK_SIZE); // some run out of work long before the others
+			store_item(entities, pos, input);
+		}
+
+		for (int i = 0; i < 4; i++) place(start + ivec3(1 + (10 * i), 0, -1), (i < 2) ? BLOCK_GENERATOR : BLOCK_SOLAR_PANEL);
+		for (int i = 0; i < 2; i++)
+			if ((g + i) % 3) store_item(entities, start + ivec3(1 + (10 * i), 0, -1), Item{ ITEM_RESOURCE, RESOURCE_COAL, 64 });
+	}
+
+	Timestamp start = get_timestamp();
+	power_tick(); // routes every grid
+	float first_ms = microseconds_since(start) / 1000;
+
+	uint num_grids, partial;
+	uint wrong = wrong_power(&num_grids, &partial);
+	step_machines();
+
+	print("%u grids, %u machines : the first tick (routing every grid) %.2f ms, %u with the wrong power, %u at partial power\n",
+		num_grids, entities->counts[ENTITY_MACHINE], first_ms, wrong, partial);
+	expect(num_grids == NUM_GRIDS && wrong == 0 && partial > 1000);
+
+	Timestamp power_time = 0, tick_time = 0;
+	uint ticks_wrong = 0;
+	for (uint t = 0; t < NUM_TICKS; t++)
+	{
+		entities->tick++;
+		tick_transport(entities);
+		start = get_timestamp();
+		tick_power(entities);
+		power_time += get_timestamp() - start;
+
+		ticks_wrong += wrong_power(&num_grids, &partial) != 0;
+		step_machines();
+	}
+	for (uint t = 0; t < 100; t++)
+	{
+		start = get_timestamp();
+		tick_entities(entities);
+		tick_time += get_timestamp() - start;
+	}
+
+	uint busy = 0;
+	for (uint i = 0; i < entities->counts[ENTITY_MACHINE]; i++) busy += entities->machines[i].busy && power_demand(entities->machines[i].block) > 0;
+
+	print("tick_power() %.1f us, tick_entities() %.1f us, %u ticks with a machine at the wrong power, %u machines still busy\n",
+		calculate_microseconds_elapsed(0, power_time) / (float)NUM_TICKS, calculate_microseconds_elapsed(0, tick_time) / 100.f, ticks_wrong, busy);
+	expect(ticks_wrong == 0);
+
+	// the first grid is cut between its generators & its solar panels, then put back
+	ivec3 cut = first + ivec3(15, 0, 0);
+	Machine* left  = get_machine(entities, first + ivec3(2 * 2, 0, 1));
+	Machine* right = get_machine(entities, first + ivec3(2 * 12, 0, 1));
+
+	start = get_timestamp();
+	remove(cut);
+	power_tick();
+	float cut_us = microseconds_since(start);
+
+	wrong = wrong_power(&num_grids, &partial);
+	print("cut : %u grids (%.0f us), %u wrong, the 2 halves on grids %u & %u\n", num_grids, cut_us, wrong, left->grid, right->grid);
+	expect(num_grids == NUM_GRIDS + 1 && wrong == 0 && left->grid != right->grid);
+	step_machines();
+
+	start = get_timestamp();
+	place(cut, BLOCK_WIRE);
+	power_tick();
+	float rejoin_us = microseconds_since(start);
+
+	wrong = wrong_power(&num_grids, &partial);
+	print("put back : %u grids (%.0f us), %u wrong\n", num_grids, rejoin_us, wrong);
+	expect(num_grids == NUM_GRIDS && wrong == 0 && left->grid == right->grid);
+	step_machines();
+
+	// a machine replaced : the new one is on the grid from the next tick
+	ivec3 replaced = first + ivec3(2 * 5, 0, 1);
+	remove(replaced);
+	place(replaced, BLOCK_SMELTER);
+	store_item(entities, replaced, Item{ ITEM_RESOURCE, RESOURCE_WASHED_IRON_ORE, 10 });
+	power_tick();
+
+	Machine* smelter = get_machine(entities, replaced);
+	Network* grid = entities->transport.networks + smelter->grid;
+	expect(grid->block == BLOCK_WIRE && grid->generation == smelter->grid_generation && smelter->power > 0);
+	expect(wrong_power(&num_grids, &partial) == 0);
+
+	return finish("power");
+}
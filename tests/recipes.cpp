@@ -0,0 +1,118 @@
+#include "items.h"
+#include "test.h"
+
+// recipes : the shipped recipes.txt has to load without errors & give what the file says, then a generated file
+// of 10k recipes (5k machine, 5k crafting) is written to tests/bin & loaded. every one of them has to be found
+// again, crafting shapes anywhere in the grid, & machines that don't take an item must not match it. times the
+// load & both lookups, which shouldn't get slower with more recipes
+
+#define NUM_GENERATED    5000 // of each kind
+#define NUM_LOOKUPS      1000000
+#define GENERATED_PATH   "tests/bin/recipes_10k.txt"
+#define GENERATED_TYPE   7 // not a real item type, so nothing clashes with the shipped recipes
+
+const u16 MACHINES[3] = { BLOCK_CRUSHER, BLOCK_WASHER, BLOCK_FURNACE };
+const char* MACHINE_NAMES[3] = { "crusher", "washer", "furnace" };
+
+Item generated(uint id, uint count = 1) { return Item{ GENERATED_TYPE, id, count }; }
+
+void crafting_grid(uint i, uint shift, Item* grid) // the generated crafting recipe i, moved 'shift' cells right
+{
+	uint a = 1000 + (i % 70), b = 1000 + ((i / 70) % 70), c = 2000 + i;
+	uint shape[4] = { a, b, c, b }; // 2 x 2
+
+	for (uint n = 0; n < 9; n++) grid[n] = {};
+	for (uint n = 0; n < 4; n++) grid[(n % 2) + shift + ((n / 2) * 3)] = generated(shape[n]);
+}
+
+int main()
+{
+	Recipes* recipes = Alloc(Recipes, 1);
+
+	// the shipped file
+	load_recipes(recipes, "assets/recipes.txt");
+	print("recipes.txt : %u machine & %u crafting recipes\n", recipes->num_process, recipes->num_crafting);
+	expect(recipes->num_process > 0 && recipes->num_crafting > 0);
+
+	Process_Recipe* crush = find_recipe(recipes, BLOCK_CRUSHER, Item{ ITEM_BLOCK, BLOCK_IRON_ORE, 1 });
+	expect(crush && crush->out.type == ITEM_RESOURCE && crush->out.id == RESOURCE_CRUSHED_IRON_ORE && crush->out.count == 2);
+	Process_Recipe* steel = find_recipe(recipes, BLOCK_SMELTER, Item{ ITEM_INGOT, INGOT_IRON, 1 });
+	expect(steel && steel->in.count == 4 && steel->out.id == INGOT_STEEL);
+	expect(find_recipe(recipes, BLOCK_WASHER, Item{ ITEM_BLOCK, BLOCK_IRON_ORE, 1 }) == NULL);
+
+	Item grid[9] = {};
+	grid[4] = grid[5] = grid[7] = grid[8] = Item{ ITEM_BLOCK, BLOCK_WOOD, 1 }; // 2 x 2 in the bottom right
+	expect(craft(recipes, grid).id == BLOCK_CRAFTING);
+	grid[0] = Item{ ITEM_BLOCK, BLOCK_WOOD, 1 }; // doesn't fit any shape anymore
+	expect(craft(recipes, grid).type == 0);
+
+	// the generated file
+	FILE* file = fopen(GENERATED_PATH, "w");
+	for (uint i = 0; i < NUM_GENERATED; i++)
+		fprintf(file, "%s %u:%u*%u = %u:%u*2 5\n", MACHINE_NAMES[i % 3], GENERATED_TYPE, 1000 + i, 1 + (i % 4), GENERATED_TYPE, 20000 + i);
+	for (uint i = 0; i < NUM_GENERATED; i++)
+	{
+		uint a = 1000 + (i % 70), b = 1000 + ((i / 70) % 70), c = 2000 + i;
+		fprintf(file, "craft 8:%u = %u:%u %u:%u / %u:%u %u:%u\n", c, GENERATED_TYPE, a, GENERATED_TYPE, b, GENERATED_TYPE, c, GENERATED_TYPE, b);
+	}
+	fclose(file);
+
+	Timestamp start = get_timestamp();
+	load_recipes(recipes, GENERATED_PATH);
+	float load_us = microseconds_since(start);
+	print("%u recipes   : loaded in %.2f ms\n", 2 * NUM_GENERATED, load_us / 1000);
+	expect(recipes->num_process == NUM_GENERATED && recipes->num_crafting == NUM_GENERATED);
+	expect(find_recipe(recipes, BLOCK_CRUSHER, Item{ ITEM_BLOCK, BLOCK_IRON_ORE, 1 }) == NULL); // loading starts over
+
+	uint missing = 0, wrong = 0;
+	for (uint i = 0; i < NUM_GENERATED; i++)
+	{
+		Process_Recipe* recipe = find_recipe(recipes, MACHINES[i % 3], generated(1000 + i));
+		missing += !recipe || recipe->out.id != 20000 + i || recipe->in.count != 1 + (i % 4);
+		wrong += find_recipe(recipes, MACHINES[(i + 1) % 3], generated(1000 + i)) != NULL;
+
+		crafting_grid(i, i % 2, grid);
+		Item out = craft(recipes, grid);
+		missing += out.type != 8 || out.id != 2000 + i;
+	}
+	print("              %u not found, %u found for the wrong machine\n", missing, wrong);
+	expect(missing == 0);
+	expect(wrong == 0);
+
+	// lookups, spread over the tables so they don't stay in one cache line
+	uint hits = 0;
+	start = get_timestamp();
+	for (uint n = 0; n < NUM_LOOKUPS; n++)
+	{
+		uint i = (n * 7919) % NUM_GENERATED;
+		hits += find_recipe(recipes, MACHINES[i % 3], generated(1000 + i)) != NULL;
+	}
+	float machine_us = microseconds_since(start);
+
+	uint misses = 0;
+	start = get_timestamp();
+	for (uint n = 0; n < NUM_LOOKUPS; n++)
+	{
+		uint i = (n * 7919) % NUM_GENERATED;
+		misses += find_recipe(recipes, MACHINES[(i + 1) % 3], generated(1000 + i)) == NULL;
+	}
+	float miss_us = microseconds_since(start);
+
+	uint matches = 0;
+	start = get_timestamp();
+	for (uint n = 0; n < NUM_LOOKUPS; n++)
+	{
+		uint i = (n * 104729) % NUM_GENERATED;
+		crafting_grid(i, 0, grid);
+		matches += craft(recipes, grid).id == 2000 + i;
+	}
+	float craft_us = microseconds_since(start);
+
+	print("machine lookup : %.1f ns, miss : %.1f ns, crafting match : %.1f ns\n",
+		machine_us * 1000 / NUM_LOOKUPS, miss_us * 1000 / NUM_LOOKUPS, craft_us * 1000 / NUM_LOOKUPS);
+	expect(hits == NUM_LOOKUPS && misses == NUM_LOOKUPS && matches == NUM_LOOKUPS);
+
+	remove(GENERATED_PATH);
+
+	return finish("recipes");
+}
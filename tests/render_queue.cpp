@@ -0,0 +1,191 @@
+#include "gui.h"
+#include "test.h"
+
+#include <algorithm>
+
+// render queue : draws go to fake gl that records every state change & the order things are drawn in.
+// a frame like the game's has to draw everything that isn't empty once, grouped by shader, solid chunks front to
+// back & the gui in the order it was submitted, with no more state changes than the stats say. the radix sort
+// has to agree with std::sort. glBindTexture() comes from opengl32 & can't be swapped, so textures are only
+// counted through Render_Stats. also times a full queue being submitted & sorted
+
+#define MAX_RECORDED 4096
+
+uint programs, vertex_arrays, draws;
+GLuint bound_program, bound_VAO;
+GLuint drawn_programs[MAX_RECORDED], drawn_VAOs[MAX_RECORDED];
+
+void APIENTRY fake_UseProgram(GLuint program) { programs++; bound_program = program; }
+void APIENTRY fake_BindVertexArray(GLuint VAO) { vertex_arrays++; bound_VAO = VAO; }
+void APIENTRY fake_ActiveTexture(GLenum) {}
+void APIENTRY fake_DrawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei)
+{
+	if (draws < MAX_RECORDED) { drawn_programs[draws] = bound_program; drawn_VAOs[draws] = bound_VAO; }
+	draws++;
+}
+
+void reset(Render_Queue* queue, vec3 view_pos)
+{
+	clear(queue, view_pos);
+	programs = vertex_arrays = draws = 0;
+}
+
+// what drawing in the order things were submitted would have cost
+uint unsorted_changes(Render_Queue* queue, uint* shaders, uint* textures, uint* VAOs)
+{
+	*shaders = *textures = *VAOs = 0;
+	GLuint shader = UNKNOWN_STATE, texture = UNKNOWN_STATE, VAO = UNKNOWN_STATE;
+
+	for (uint i = 0; i < queue->num_packets; i++)
+	{
+		Draw_Packet* packet = queue->packets + i;
+		if (packet->shader != shader) { shader = packet->shader; (*shaders)++; }
+		if (packet->textures[0].id != texture) { texture = packet->textures[0].id; (*textures)++; }
+		if (packet->VAO != VAO) { VAO = packet->VAO; (*VAOs)++; }
+	}
+
+	return *shaders + *textures + *VAOs;
+}
+
+void game_frame(Render_Queue* queue, int origin) // the 3 x 3 chunks start at (origin, origin)
+{
+	World_Renderer* world = Alloc(World_Renderer, 1);
+	Particle_Renderer* particles = Alloc(Particle_Renderer, 1);
+	GUI_Renderer* gui = Alloc(GUI_Renderer, 1);
+
+	world->solid_shader.id = 3; world->fluid_shader.id = 4; world->block_shader.id = 5;
+	world->block_textures = 10; world->material_table = 11; world->texture = 12; world->material = 13;
+
+	for (uint i = 0; i < NUM_ACTIVE_CHUNKS; i++) // 3 x 3 chunks, 3 of them without water
+	{
+		Chunk chunk = {};
+		chunk.x = origin + ((i % 3) * CHUNK_X);
+		chunk.z = origin + ((i / 3) * CHUNK_Z);
+
+		Chunk_Renderer* chunk_renderer = world->chunks + i;
+		chunk_renderer->chunk_id = chunk.id;
+		chunk_renderer->solid_mesh = { 20 + i, 0, 0, 6 };
+		chunk_renderer->fluid_mesh = { 40 + i, 0, 0, 6 };
+		chunk_renderer->num_solids = 100;
+		chunk_renderer->num_fluids = (i < 6) ? 50 : 0;
+	}
+	world->block_mesh = { 60, 0, 0, 36 };
+	world->num_blocks = 0; // nothing on the ground
+	particles->shader.id = 6;
+	particles->cube = { 61, 0, 0, 36 };
+	gui->icon_shader.id = 7; gui->quad_shader.id = 8;
+	gui->icon_mesh.VAO = 62; gui->quad_mesh.VAO = 63;
+	gui->texture = 14;
+	gui->num_icons = 10; gui->num_quads = 40;
+
+	vec3 camera = vec3(origin + 40, 64, origin + 40); // over the last chunk
+	reset(queue, camera);
+	draw(particles, queue);
+	draw(world, queue);
+	draw(gui, queue);
+
+	uint shaders, textures, VAOs;
+	unsorted_changes(queue, &shaders, &textures, &VAOs);
+
+	draw(queue, PASS_GEOMETRY);
+	draw(queue, PASS_GUI);
+
+	Render_Stats stats = queue->stats;
+	print("game frame at %3d : %u draws, %u shaders, %u textures, %u vertex arrays, %u skipped\n", origin, stats.draws, stats.shaders, stats.textures, stats.vertex_arrays, stats.skipped);
+	print("  unsorted : %u shaders, %u textures, %u vertex arrays\n", shaders, textures, VAOs);
+
+	expect(stats.draws == 1 + 9 + 6 + 2); // particles, solids, fluids, gui (the empty fluids & items aren't drawn)
+	expect(draws == stats.draws);
+	expect(programs == stats.shaders);
+	expect(vertex_arrays == stats.vertex_arrays);
+	expect(stats.shaders == 5); // geometry : particles, solids & fluids. gui : icons & quads
+	expect(stats.shaders < shaders);
+
+	// every shader is used in one run, solids go front to back
+	uint runs = 1;
+	for (uint i = 1; i < draws; i++) runs += drawn_programs[i] != drawn_programs[i - 1];
+	expect(runs == stats.shaders);
+
+	float last_distance = 0;
+	uint solids = 0, out_of_order = 0;
+	for (uint i = 0; i < draws; i++)
+	{
+		if (drawn_programs[i] != world->solid_shader.id) continue;
+
+		Chunk chunk = {}; chunk.id = world->chunks[drawn_VAOs[i] - 20].chunk_id;
+		float distance = glm::distance(camera, vec3((int)chunk.x + (CHUNK_X / 2), CHUNK_Y / 2, (int)chunk.z + (CHUNK_Z / 2)));
+		out_of_order += distance < last_distance;
+		last_distance = distance;
+		solids++;
+	}
+	expect(solids == 9);
+	expect(out_of_order == 0);
+
+	// the gui comes last, icons then quads
+	expect(drawn_VAOs[draws - 2] == 62 && drawn_VAOs[draws - 1] == 63);
+
+	free(world); free(particles); free(gui);
+}
+
+int main()
+{
+	__glewUseProgram            = fake_UseProgram;
+	__glewBindVertexArray       = fake_BindVertexArray;
+	__glewActiveTexture         = fake_ActiveTexture;
+	__glewDrawElementsInstanced = fake_DrawElementsInstanced;
+
+	Render_Queue* queue = Alloc(Render_Queue, 1);
+
+	game_frame(queue, 0);
+	game_frame(queue, -48); // chunk coordinates are stored unsigned, the depth has to see them as negative
+
+	// a full queue, submitted with shaders, textures & vertex arrays interleaved
+	Shader a = { 1 }, b = { 2 };
+	reset(queue, vec3(0));
+	for (uint i = 0; i < MAX_DRAW_PACKETS; i++)
+		set_texture(submit(queue, PASS_GEOMETRY, (i & 1) ? a : b, 100 + (i % 4), 6, 1, vec3(i, 0, 0)), 0, (i & 2) ? 20 : 21);
+	expect(submit(queue, PASS_GEOMETRY, a, 1, 6, 1) == NULL); // full
+
+	uint shaders, textures, VAOs;
+	unsorted_changes(queue, &shaders, &textures, &VAOs);
+	draw(queue, PASS_GEOMETRY);
+
+	Render_Stats stats = queue->stats;
+	print("%u interleaved packets : %u shaders, %u textures, %u vertex arrays (unsorted : %u, %u, %u)\n",
+		MAX_DRAW_PACKETS, stats.shaders, stats.textures, stats.vertex_arrays, shaders, textures, VAOs);
+	expect(stats.draws == MAX_DRAW_PACKETS);
+	expect(stats.shaders == 2);
+	expect(stats.textures == 4); // 2 per shader
+	expect(stats.vertex_arrays == 4); // each shader & texture pair only uses one
+
+	// the radix sort against std::sort, with keys that share most of their bytes too
+	uint sizes[5] = { 0, 1, 2, 1000, MAX_DRAW_PACKETS };
+	uint64 mask[2] = { ~0ull, 0xFF0000FF000000FFull };
+	for (uint s = 0; s < 5; s++) {
+	for (uint m = 0; m < 2; m++)
+	{
+		uint n = sizes[s];
+		uint64 sorted[MAX_DRAW_PACKETS];
+		for (uint i = 0; i < n; i++)
+			sorted[i] = queue->keys[i] = (((uint64)random_uint(i, s) << 32) | random_uint(i, s + 10)) & mask[m];
+
+		radix_sort(queue->keys, queue->scratch, n);
+		std::sort(sorted, sorted + n);
+		expect(memcmp(queue->keys, sorted, n * sizeof(uint64)) == 0);
+	} }
+
+	// cost of a full queue : submitting, making the keys & sorting
+	Timestamp start = get_timestamp();
+	for (uint r = 0; r < 1000; r++)
+	{
+		clear(queue, vec3(0));
+		for (uint i = 0; i < MAX_DRAW_PACKETS; i++)
+			set_texture(submit(queue, PASS_GEOMETRY, (i & 1) ? a : b, 100 + (i % 4), 6, 1, vec3(i, 0, 0)), 0, 20 + (i & 2));
+
+		for (uint i = 0; i < queue->num_packets; i++) queue->keys[i] = draw_key(queue->packets + i, i);
+		radix_sort(queue->keys, queue->scratch, queue->num_packets);
+	}
+	print("submit & sort %u packets : %.1f us\n", MAX_DRAW_PACKETS, microseconds_since(start) / 1000);
+
+	return finish("render_queue");
+}
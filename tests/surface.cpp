@@ -0,0 +1,127 @@
+#include "chunk.h"
+#include "test.h"
+
+// surface heights : the heightmap & surface blocks kept in Chunk_Loader have to match a scan down every loaded
+// column after generation, after the player moves, after 100k random set_block() calls & after a few hundred
+// batched edits. times get_surface_height() against scanning down with get_block() like it had to be done
+// before, & what keeping the heightmap adds to a block change (set_block() also relights & wakes up fluids,
+// that part is timed separately)
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+#define LOADED_WIDTH (LOADED_CHUNKS_WIDTH * CHUNK_X) // blocks
+#define NUM_QUERIES  1000000
+#define NUM_SCANS    100000
+#define NUM_CHANGES  100000
+
+uint scan_down(Chunk_Loader* chunks, int x, int z, u16* surface) // what finding the surface used to take
+{
+	for (int y = CHUNK_Y - 1; y >= 0; y--)
+	{
+		u16 block = get_block(&chunks->lookup, chunks->blocks, ivec3(x, y, z));
+		if (is_solid(block)) { *surface = block; return y + 1; }
+	}
+
+	*surface = BLOCK_AIR;
+	return 0;
+}
+uint wrong_columns(Chunk_Loader* chunks)
+{
+	uint wrong = 0;
+	for (int x = chunks->lookup.x; x < (int)chunks->lookup.x + LOADED_WIDTH; x++) {
+	for (int z = chunks->lookup.z; z < (int)chunks->lookup.z + LOADED_WIDTH; z++)
+	{
+		u16 surface;
+		uint height = scan_down(chunks, x, z, &surface);
+		wrong += height != get_surface_height(chunks, x, z) || surface != get_surface_block(chunks, x, z);
+	} }
+
+	return wrong;
+}
+ivec3 random_block(uint i, uint seed, int max_y)
+{
+	return ivec3(random_uint(i, seed) % LOADED_WIDTH, random_uint(i, seed + 1) % max_y, random_uint(i, seed + 2) % LOADED_WIDTH);
+}
+
+int main()
+{
+	Chunk_Loader* chunks = Alloc(Chunk_Loader, 1);
+	for (uint i = 0; i < NUM_CHUNKS; i++) chunks->loaded_chunks[i].blocks_index = i;
+	chunks->seed = SCENE_SEED;
+	update_chunks(chunks, SCENE_CENTER);
+
+	uint generated = wrong_columns(chunks);
+	update_chunks(chunks, SCENE_CENTER + vec3(40, 0, 0)); // some chunks unloaded, some new ones
+	uint moved = wrong_columns(chunks);
+
+	ivec3 corner = ivec3(chunks->lookup.x, 0, chunks->lookup.z);
+
+	// single blocks, placed & removed around the surface
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < NUM_CHANGES; i++)
+		set_block(chunks, corner + random_block(i, 10, 80), (random_uint(i, 13) & 1) ? BLOCK_AIR : BLOCK_STONE);
+	float set_block_us = microseconds_since(start) / NUM_CHANGES;
+	uint changed = wrong_columns(chunks);
+
+	// batched edits
+	for (uint i = 0; i < 200; i++)
+	{
+		Edit_Batch batch = {};
+		add_sphere(&batch, vec3(corner + random_block(i, 20, 90)), 1 + (random_uint(i, 23) % 6), (i & 1) ? BLOCK_AIR : BLOCK_DIRT);
+		ivec3 min = corner + ivec3(10 + (i % 50), 70, 10 + (i % 30));
+		add_box(&batch, min, min + ivec3(4, 2, 2), (i % 3) ? BLOCK_AIR : BLOCK_BRICK);
+		apply(&batch, chunks);
+	}
+	uint edited = wrong_columns(chunks);
+
+	print("columns wrong : %u after generating, %u after moving, %u after %u set_block(), %u after 200 batches\n", generated, moved, changed, NUM_CHANGES, edited);
+	expect(generated == 0 && moved == 0 && changed == 0 && edited == 0);
+
+	// queries
+	volatile uint sum = 0;
+	start = get_timestamp();
+	for (uint i = 0; i < NUM_QUERIES; i++) sum += get_surface_height(chunks, corner.x + ((i * 7) % LOADED_WIDTH), corner.z + ((i * 13) % LOADED_WIDTH));
+	float query_ns = (microseconds_since(start) * 1000) / NUM_QUERIES;
+
+	u16 surface;
+	start = get_timestamp();
+	for (uint i = 0; i < NUM_SCANS; i++) sum += scan_down(chunks, corner.x + ((i * 7) % LOADED_WIDTH), corner.z + ((i * 13) % LOADED_WIDTH), &surface);
+	float scan_ns = (microseconds_since(start) * 1000) / NUM_SCANS;
+
+	print("get_surface_height() : %.1f ns, scanning down : %.1f ns\n", query_ns, scan_ns);
+	expect(query_ns < scan_ns);
+
+	// what a block change costs with & without keeping the heightmap (the same changes every run, the best run counts)
+	uint* indices = Alloc(uint, NUM_CHANGES);
+	u16* new_blocks = Alloc(u16, NUM_CHANGES);
+	for (uint i = 0; i < NUM_CHANGES; i++)
+	{
+		indices[i] = find_block(&chunks->lookup, corner + random_block(i, 30, 80));
+		new_blocks[i] = (random_uint(i, 33) & 1) ? BLOCK_AIR : BLOCK_STONE;
+	}
+
+	Timestamp raw = ~0ull, with_heights = ~0ull;
+	for (uint run = 0; run < 10; run++)
+	{
+		start = get_timestamp();
+		for (uint i = 0; i < NUM_CHANGES; i++)
+		{
+			chunks->blocks[indices[i]] = new_blocks[i];
+			if (run & 1) update_column(chunks, indices[i], new_blocks[i]);
+		}
+		Timestamp time = get_timestamp() - start;
+		if (run & 1) with_heights = glm::min(with_heights, time); else raw = glm::min(raw, time);
+	}
+
+	float raw_ns = (calculate_microseconds_elapsed(0, raw) * 1000.f) / NUM_CHANGES;
+	float heights_ns = (calculate_microseconds_elapsed(0, with_heights) * 1000.f) / NUM_CHANGES;
+	print("a block change : %.1f ns writing the block, %.1f ns with the heightmap (+%.1f ns), set_block() %.2f us\n",
+		raw_ns, heights_ns, heights_ns - raw_ns, set_block_us);
+
+	start = get_timestamp();
+	for (uint i = 0; i < NUM_CHUNKS; i++) update_columns(chunks, i); // the runs without update_column() left them stale
+	print("update_columns() : %.1f us per chunk\n", microseconds_since(start) / NUM_CHUNKS);
+	expect(wrong_columns(chunks) == 0);
+
+	return finish("surface");
+}
@@ -0,0 +1,33 @@
+// shared by the tests. every .cpp in this folder is a program of its own that includes the part of the game it
+// tests (see build.bat). they print what they checked & how long things took, & return 1 if a check failed.
+// nothing here opens a window, anything that would call gl gets fake gl functions from the test itself
+
+uint num_checks, num_failed;
+
+#define expect(condition) expect_(condition, #condition, __LINE__)
+
+void expect_(bool passed, const char* condition, int line)
+{
+	num_checks++;
+	if (passed) return;
+
+	num_failed++;
+	print("  FAILED (line %d) : %s\n", line, condition);
+}
+int finish(const char* test_name) // return this from main()
+{
+	print("%s : %u checks, %u failed\n", test_name, num_checks, num_failed);
+	return num_failed ? 1 : 0;
+}
+
+float microseconds_since(Timestamp start)
+{
+	return (float)calculate_microseconds_elapsed(start, get_timestamp());
+}
+
+uint64 hash_bytes(const void* data, uint64 size, uint64 hash = 14695981039346656037ull) // fnv-1a
+{
+	const byte* bytes = (const byte*)data;
+	for (uint64 i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
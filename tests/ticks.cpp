@@ -0,0 +1,91 @@
+#include "world.h"
+#include "test.h"
+
+// simulation tiers : a pit is dug across the active & border chunks of a generated world & a sheet of water is
+// let into it, then the world is ticked 400 times. every active chunk has to get a tick every tick & every border
+// chunk one every 4th, primed chunks are never touched, & no tick may go over its budget. grass has to spread or
+// die somewhere. prints what each tier cost per tick, how many chunk ticks & fluid cells that was, & the worst tick
+
+#define SCENE_SEED   11
+#define SCENE_CENTER vec3(116, 48, 116)
+#define NUM_TICKS    400
+
+uint count_grass(Chunk_Loader* chunks)
+{
+	uint grass = 0;
+	for (uint i = 0; i < NUM_CHUNKS * NUM_CHUNK_BLOCKS; i++) grass += chunks->blocks[i] == BLOCK_GRASS;
+	return grass;
+}
+uint64 hash_tier(Chunk_Loader* chunks, u8 tier) // the blocks of every chunk in 'tier'
+{
+	uint64 hash = hash_bytes(0, 0);
+	for (uint i = 0; i < NUM_CHUNKS; i++)
+	{
+		u16 blocks_index = chunks->loaded_chunks[i].blocks_index;
+		if (chunks->lookup.tiers[blocks_index] == tier)
+			hash = hash_bytes(chunks->blocks + (blocks_index * NUM_CHUNK_BLOCKS), NUM_CHUNK_BLOCKS * sizeof(u16), hash);
+	}
+
+	return hash;
+}
+
+int main()
+{
+	World* world = Alloc(World, 1);
+	init(world, SCENE_CENTER, SCENE_SEED);
+	Chunk_Loader* chunks = &world->chunks;
+	update_chunks(chunks, SCENE_CENTER);
+
+	// a 31 x 31 pit with a sheet of water over it, a wall through the middle is taken out to get the water going
+	ivec3 corner = ivec3(chunks->lookup.x, 0, chunks->lookup.z);
+	Edit_Batch batch = {};
+	add_box(&batch, corner + ivec3(40, 30, 40), corner + ivec3(70, 45, 70), BLOCK_AIR);
+	add_box(&batch, corner + ivec3(40, 46, 40), corner + ivec3(70, 46, 70), BLOCK_WATER);
+	add_box(&batch, corner + ivec3(40, 29, 40), corner + ivec3(70, 29, 70), BLOCK_STONE);
+	add_box(&batch, corner + ivec3(55, 45, 40), corner + ivec3(55, 45, 70), BLOCK_STONE);
+	apply(&batch, chunks);
+	for (int z = 40; z <= 70; z++) set_block(chunks, corner + ivec3(55, 45, z), BLOCK_AIR);
+
+	uint grass_before = count_grass(chunks);
+	uint64 primed_before = hash_tier(chunks, TIER_PRIMED);
+
+	const char* names[NUM_TIERS] = { "active", "border", "primed" };
+	uint chunk_ticks[NUM_TIERS] = {}, fluid_cells[NUM_TIERS] = {};
+	Timestamp tier_time[NUM_TIERS] = {}, total = 0, worst = 0;
+
+	for (uint t = 0; t < NUM_TICKS; t++)
+	{
+		Timestamp start = get_timestamp();
+		tick(&world->ticks, chunks, &world->entities);
+		Timestamp time = get_timestamp() - start;
+
+		total += time;
+		worst = glm::max(worst, time);
+		for (uint tier = 0; tier < NUM_TIERS; tier++)
+		{
+			Tick_Stats stats = world->ticks.stats[tier];
+			chunk_ticks[tier] += stats.chunk_ticks;
+			fluid_cells[tier] += stats.fluid_cells;
+			tier_time[tier]   += stats.time;
+		}
+	}
+
+	for (uint tier = 0; tier < NUM_TIERS; tier++)
+		print("%s : %5.1f us per tick, %5.2f chunk ticks & %6.1f fluid cells per tick\n", names[tier],
+			calculate_microseconds_elapsed(0, tier_time[tier]) / (float)NUM_TICKS, chunk_ticks[tier] / (float)NUM_TICKS, fluid_cells[tier] / (float)NUM_TICKS);
+
+	float worst_us = (float)calculate_microseconds_elapsed(0, worst);
+	uint grass_after = count_grass(chunks);
+	print("a tick : %.1f us on average, the worst %.0f us (the budget is %u us), grass %u -> %u\n",
+		calculate_microseconds_elapsed(0, total) / (float)NUM_TICKS, worst_us, TICK_BUDGET, grass_before, grass_after);
+
+	expect(chunk_ticks[TIER_ACTIVE] == NUM_ACTIVE_CHUNKS * NUM_TICKS);
+	expect(chunk_ticks[TIER_BORDER] == NUM_BORDER_CHUNKS * (NUM_TICKS / TIER_TICK_RATE[TIER_BORDER]));
+	expect(chunk_ticks[TIER_PRIMED] == 0 && fluid_cells[TIER_PRIMED] == 0);
+	expect(fluid_cells[TIER_ACTIVE] > 0 && fluid_cells[TIER_BORDER] > 0);
+	expect(hash_tier(chunks, TIER_PRIMED) == primed_before);
+	expect(grass_after != grass_before);
+	expect(worst_us < TICK_BUDGET);
+
+	return finish("ticks");
+}
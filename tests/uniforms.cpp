@@ -0,0 +1,127 @@
+#include "renderer.h"
+#include "test.h"
+
+// shader reflection : reflect() runs against fake gl programs (a list of active uniforms & whether there is a
+// 'Frame' block). every UNIFORM_NAMES entry has to end up at its location, arrays are matched without their [0],
+// anything else stays at -1, & the frame block is tied to FRAME_UNIFORM_BINDING. drawing never looks a name up
+
+struct Fake_Uniform
+{
+	const char* name; // as glGetActiveUniform() gives it
+	GLint location;
+};
+
+struct Fake_Program
+{
+	const Fake_Uniform* uniforms;
+	GLint num_uniforms;
+	GLuint frame_block; // GL_INVALID_INDEX = none
+};
+
+Fake_Program program;
+uint num_gl_calls, num_lookups, num_bindings;
+char looked_up[64]; // the last name glGetUniformLocation() was given
+GLuint bound_block, bound_binding;
+GLint set_location;
+
+void APIENTRY fake_GetProgramiv(GLuint, GLenum, GLint* value) { num_gl_calls++; *value = program.num_uniforms; }
+void APIENTRY fake_GetActiveUniform(GLuint, GLuint index, GLsizei max_length, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+	num_gl_calls++;
+	strncpy(name, program.uniforms[index].name, max_length - 1);
+	*length = (GLsizei)strlen(name);
+	*size = 1;
+	*type = GL_FLOAT;
+}
+GLint APIENTRY fake_GetUniformLocation(GLuint, const GLchar* name)
+{
+	num_gl_calls++;
+	num_lookups++;
+	strncpy(looked_up, name, sizeof(looked_up) - 1);
+
+	for (GLint i = 0; i < program.num_uniforms; i++)
+	{
+		const char* active = program.uniforms[i].name;
+		uint length = (uint)strlen(name);
+		if (strncmp(active, name, length) == 0 && (active[length] == 0 || strcmp(active + length, "[0]") == 0))
+			return program.uniforms[i].location;
+	}
+
+	return -1;
+}
+GLuint APIENTRY fake_GetUniformBlockIndex(GLuint, const GLchar* name)
+{
+	num_gl_calls++;
+	return (strcmp(name, "Frame") == 0) ? program.frame_block : GL_INVALID_INDEX;
+}
+void APIENTRY fake_UniformBlockBinding(GLuint, GLuint block, GLuint binding)
+{
+	num_gl_calls++;
+	num_bindings++;
+	bound_block = block;
+	bound_binding = binding;
+}
+void APIENTRY fake_UniformMatrix3fv(GLint location, GLsizei, GLboolean, const GLfloat*) { set_location = location; }
+
+Shader reflect_fake(GLuint id, const Fake_Uniform* uniforms, GLint num_uniforms, GLuint frame_block)
+{
+	program = { uniforms, num_uniforms, frame_block };
+	num_gl_calls = num_lookups = num_bindings = 0;
+	looked_up[0] = 0;
+
+	Shader shader = { id };
+	for (uint u = 0; u < NUM_UNIFORMS; u++) shader.uniforms[u] = 1234; // reflect() has to overwrite all of them
+	reflect(&shader);
+	return shader;
+}
+
+int main()
+{
+	__glewGetProgramiv         = fake_GetProgramiv;
+	__glewGetActiveUniform     = fake_GetActiveUniform;
+	__glewGetUniformLocation   = fake_GetUniformLocation;
+	__glewGetUniformBlockIndex = fake_GetUniformBlockIndex;
+	__glewUniformBlockBinding  = fake_UniformBlockBinding;
+	__glewUniformMatrix3fv     = fake_UniformMatrix3fv;
+
+	// an item shader : samplers, the transform & the frame block's members (which have no location)
+	Fake_Uniform item[] = { { "texture_sampler", 0 }, { "transform", 5 }, { "material_sampler", 1 }, { "proj_view", -1 }, { "view_pos", -1 }, { "time", -1 } };
+	Shader shader = reflect_fake(1, item, 6, 3);
+	print("item shader   : transform at %d, frame block %u bound to %u, %u lookups\n", shader.uniforms[UNIFORM_TRANSFORM], bound_block, bound_binding, num_lookups);
+	expect(shader.uniforms[UNIFORM_TRANSFORM] == 5);
+	expect(num_lookups == NUM_UNIFORMS); // only names that are used get looked up
+	expect(num_bindings == 1 && bound_block == 3 && bound_binding == FRAME_UNIFORM_BINDING);
+
+	num_lookups = 0;
+	set_mat3(shader, UNIFORM_TRANSFORM, mat3(1)); // drawing uses the location, never the name
+	expect(set_location == 5);
+	expect(num_lookups == 0);
+
+	// arrays are listed as 'name[0]' & looked up without it
+	Fake_Uniform array[] = { { "transform[0]", 9 } };
+	shader = reflect_fake(2, array, 1, GL_INVALID_INDEX);
+	print("array         : transform at %d, looked up as '%s'\n", shader.uniforms[UNIFORM_TRANSFORM], looked_up);
+	expect(shader.uniforms[UNIFORM_TRANSFORM] == 9);
+	expect(strcmp(looked_up, "transform") == 0);
+	expect(num_bindings == 0); // no frame block, nothing to bind
+
+	// names that only look like one that is used
+	Fake_Uniform unknown[] = { { "transforms", 1 }, { "transform_2", 2 }, { "Transform", 3 }, { "model[0]", 4 }, { "[0]", 5 } };
+	shader = reflect_fake(3, unknown, 5, GL_INVALID_INDEX);
+	print("unknown names : transform at %d, %u lookups\n", shader.uniforms[UNIFORM_TRANSFORM], num_lookups);
+	for (uint u = 0; u < NUM_UNIFORMS; u++) expect(shader.uniforms[u] == -1);
+	expect(num_lookups == 0);
+
+	// a shader that didn't compile doesn't touch gl at all
+	shader = reflect_fake(0, item, 6, 3);
+	for (uint u = 0; u < NUM_UNIFORMS; u++) expect(shader.uniforms[u] == -1);
+	expect(num_gl_calls == 0);
+
+	// the frame block has to match the glsl std140 layout
+	print("Frame_Uniforms: %u bytes, view_pos at %u, time at %u\n", (uint)sizeof(Frame_Uniforms), (uint)offsetof(Frame_Uniforms, view_pos), (uint)offsetof(Frame_Uniforms, time));
+	expect(sizeof(Frame_Uniforms) == 80);
+	expect(offsetof(Frame_Uniforms, view_pos) == 64);
+	expect(offsetof(Frame_Uniforms, time) == 76);
+
+	return finish("uniforms");
+}
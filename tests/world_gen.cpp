@@ -0,0 +1,129 @@
+#include "world.h"
+#include "test.h"
+
+// world generation : a chunk only depends on the seed & where it is, never on which chunks were generated
+// before it or on which thread. a 16 x 16 chunk area is generated one chunk after another, then again in
+// shuffled orders spread over several threads, & every chunk has to come out the same.
+// then every stage of the pipeline is timed on its own over chunks spread far apart (so all biomes show
+// up), & seas have to be water from the sea floor all the way up to WATER_LEVEL
+
+#define AREA_SIZE   16 // chunks per side
+#define AREA_CHUNKS (AREA_SIZE * AREA_SIZE)
+
+Chunk area_chunk(uint i)
+{
+	Chunk chunk = {};
+	chunk.x = ((i % AREA_SIZE) * CHUNK_X) + 64;
+	chunk.z = ((i / AREA_SIZE) * CHUNK_Z) + 64;
+	return chunk;
+}
+
+// generates the area with 'num_threads' threads taking chunks in a shuffled order, & hashes every chunk
+void generate_area(uint seed, uint num_threads, uint shuffle, uint64* hashes)
+{
+	uint order[AREA_CHUNKS];
+	for (uint i = 0; i < AREA_CHUNKS; i++) order[i] = i;
+
+	for (uint i = AREA_CHUNKS - 1; shuffle && i > 0; i--) // fisher-yates
+	{
+		uint j = random_uint(i, shuffle) % (i + 1);
+		uint temp = order[i]; order[i] = order[j]; order[j] = temp;
+	}
+
+	auto run = [&](uint thread) {
+		u16* blocks = Alloc(u16, NUM_CHUNK_BLOCKS);
+		for (uint n = thread; n < AREA_CHUNKS; n += num_threads)
+		{
+			uint i = order[n];
+			generate(area_chunk(i), blocks, seed);
+			hashes[i] = hash_bytes(blocks, NUM_CHUNK_BLOCKS * sizeof(u16));
+		}
+		free(blocks);
+	};
+
+	std::thread threads[8];
+	for (uint t = 1; t < num_threads; t++) threads[t] = std::thread(run, t);
+	run(0);
+	for (uint t = 1; t < num_threads; t++) threads[t].join();
+}
+
+void bench_stages()
+{
+	const char* names[5] = { "heightmap", "biomes", "caves", "ores", "decorations" };
+	Timestamp times[5] = {};
+
+	Chunk_Generator* gen = Alloc(Chunk_Generator, 1);
+	u16* blocks = Alloc(u16, NUM_CHUNK_BLOCKS);
+	uint sea_columns = 0, dry_sea_blocks = 0;
+
+	for (uint i = 0; i < AREA_CHUNKS; i++)
+	{
+		*gen = {};
+		gen->chunk.x = ((i % AREA_SIZE) * 160) + 64;
+		gen->chunk.z = ((i / AREA_SIZE) * 160) + 64;
+		gen->seed    = 1;
+		gen->blocks  = blocks;
+
+		Timestamp start = get_timestamp();
+		generate_heightmap  (gen); Timestamp t0 = get_timestamp();
+		generate_biomes     (gen); Timestamp t1 = get_timestamp();
+		carve_caves         (gen); Timestamp t2 = get_timestamp();
+		generate_ores       (gen); Timestamp t3 = get_timestamp();
+		generate_decorations(gen); Timestamp t4 = get_timestamp();
+
+		times[0] += t0 - start; times[1] += t1 - t0; times[2] += t2 - t1; times[3] += t3 - t2; times[4] += t4 - t3;
+
+		for (uint c = 0; c < CHUNK_X * CHUNK_Z; c++)
+		{
+			uint height = gen->heights[c];
+			if (height >= WATER_LEVEL) continue;
+
+			sea_columns++;
+			for (uint y = height + 1; y <= WATER_LEVEL; y++)
+				dry_sea_blocks += blocks[BLOCK_INDEX(c % CHUNK_X, y, c / CHUNK_X, 0)] != BLOCK_WATER;
+		}
+	}
+
+	Timestamp total = 0;
+	for (uint s = 0; s < 5; s++)
+	{
+		total += times[s];
+		print("%-12s : %8.0f chunks/s\n", names[s], AREA_CHUNKS / (calculate_microseconds_elapsed(0, times[s]) / 1000000.f));
+	}
+	print("%-12s : %8.0f chunks/s (1 thread)\n", "all stages", AREA_CHUNKS / (calculate_microseconds_elapsed(0, total) / 1000000.f));
+	print("%u sea columns, %u blocks between their floor & WATER_LEVEL that aren't water\n", sea_columns, dry_sea_blocks);
+
+	expect(sea_columns > 0);
+	expect(dry_sea_blocks == 0);
+
+	free(blocks);
+	free(gen);
+}
+
+int main()
+{
+	uint64 serial[AREA_CHUNKS], shuffled[AREA_CHUNKS];
+
+	generate_area(7, 1, 0, serial);
+
+	uint runs[3][2] = { { 8, 1 }, { 3, 2 }, { 4, 3 } }; // threads, shuffle
+	for (uint r = 0; r < 3; r++)
+	{
+		generate_area(7, runs[r][0], runs[r][1], shuffled);
+
+		uint different = 0;
+		for (uint i = 0; i < AREA_CHUNKS; i++) different += shuffled[i] != serial[i];
+
+		print("seed 7, %u threads, shuffle %u : %u / %u chunks differ from the serial run\n", runs[r][0], runs[r][1], different, AREA_CHUNKS);
+		expect(different == 0);
+	}
+
+	generate_area(8, 4, 1, shuffled); // another seed has to give another world
+	uint same = 0;
+	for (uint i = 0; i < AREA_CHUNKS; i++) same += shuffled[i] == serial[i];
+	expect(same < AREA_CHUNKS / 16);
+
+	bench_stages();
+
+	return finish("world_gen");
+}
@@ -0,0 +1,78 @@
+#include "world.h"
+#include "test.h"
+
+// dropped items : an explosion (a radius 12 sphere of air) is blown into generated terrain & 10k items are
+// thrown out of the crater in every direction, then the world is updated at 60 fps for 10 seconds with the
+// camera too far up to pick anything up. no item may end up inside a block or fall out of the world, they
+// have to come to rest, nothing may be lost when identical stacks merge, & the merging has to leave fewer
+// stacks. times a frame while they fly & once they have settled, against a frame with no items at all
+
+#define SCENE_SEED     11
+#define SCENE_CENTER   vec3(116, 48, 116)
+#define NUM_DROPPED    10000
+#define BLAST_RADIUS   12
+#define FRAME_TIME     (1 / 60.f)
+#define NUM_FRAMES     600
+#define TIMED_FRAMES   60 // at the start & at the end
+
+World* world;
+Camera camera;
+Inventory inventory;
+Item player_items[MAX_INVENTORY_SLOTS];
+Audio pops[4];
+
+Timestamp run(uint frames)
+{
+	Timestamp start = get_timestamp();
+	for (uint i = 0; i < frames; i++) update(world, camera, Mouse{}, FRAME_TIME, &inventory, player_items, pops);
+	return get_timestamp() - start;
+}
+
+int main()
+{
+	world = Alloc(World, 1);
+	init(world, SCENE_CENTER, SCENE_SEED, 2 * NUM_DROPPED);
+	init(&inventory, player_items, MAX_INVENTORY_SLOTS);
+	camera.position = SCENE_CENTER + vec3(0, 200, 0); // loads the same chunks, out of reach of the items
+	update_chunks(&world->chunks, SCENE_CENTER);
+
+	float empty_us = calculate_microseconds_elapsed(0, run(TIMED_FRAMES)) / (float)TIMED_FRAMES;
+
+	vec3 blast = vec3(SCENE_CENTER.x, get_surface_height(&world->chunks, (int)SCENE_CENTER.x, (int)SCENE_CENTER.z), SCENE_CENTER.z);
+	fill_sphere(&world->chunks, blast, BLAST_RADIUS);
+
+	uint total = 0;
+	for (uint i = 0; i < NUM_DROPPED; i++) // 4 kinds of blocks, thrown up & out of the crater
+	{
+		Item item = Item{ ITEM_BLOCK, 1 + (i % 4), 1 + (i % 3) };
+		vec3 offset = vec3(randfns(i, 1), randfn(i, 2), randfns(i, 3)) * (BLAST_RADIUS * .8f);
+		spawn(&world->items, item, blast + offset);
+		world->items.items[world->items.count - 1].velocity = vec3(randfns(i, 4) * 6, 4 + (randfn(i, 5) * 8), randfns(i, 6) * 6);
+		total += item.count;
+	}
+	expect(world->items.count == NUM_DROPPED);
+
+	float flying_us = calculate_microseconds_elapsed(0, run(TIMED_FRAMES)) / (float)TIMED_FRAMES;
+	run(NUM_FRAMES - (2 * TIMED_FRAMES));
+	float settled_us = calculate_microseconds_elapsed(0, run(TIMED_FRAMES)) / (float)TIMED_FRAMES;
+
+	uint inside = 0, moving = 0, fallen = 0, count = 0;
+	for (uint i = 0; i < world->items.count; i++)
+	{
+		World_Item item = world->items.items[i];
+		inside += box_hits_blocks(&world->chunks.lookup, world->chunks.blocks, item.position + ITEM_MIN, item.position + ITEM_MAX);
+		moving += item.velocity != vec3(0);
+		fallen += item.position.y < 0;
+		count  += item.item.count;
+	}
+
+	print("%u items thrown, %u stacks after merging, %u inside a block, %u still moving, %u fell out\n", NUM_DROPPED, world->items.count, inside, moving, fallen);
+	print("world update : %.0f us with no items, %.0f us while they fly, %.0f us once they settled\n", empty_us, flying_us, settled_us);
+	expect(count == total);
+	expect(world->items.count < NUM_DROPPED);
+	expect(inside == 0);
+	expect(moving == 0);
+	expect(fallen == 0);
+
+	return finish("world_items");
+}